@@ -0,0 +1,165 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/*
+ * Benchmarks for cosmic ray detection and defect interpolation
+ */
+#include <cmath>
+
+#include "boost/random.hpp"
+
+#include "lsst/pex/policy/Policy.h"
+#include "lsst/afw/image/MaskedImage.h"
+#include "lsst/meas/algorithms/CR.h"
+#include "lsst/meas/algorithms/Interp.h"
+#include "lsst/meas/algorithms/DoubleGaussianPsf.h"
+#include "benchmark.h"
+
+namespace afwGeom = lsst::afw::geom;
+namespace afwImage = lsst::afw::image;
+namespace algorithms = lsst::meas::algorithms;
+namespace benchmarks = lsst::meas::algorithms::benchmarks;
+
+typedef afwImage::MaskedImage<float> MaskedImageT;
+
+namespace {
+
+double const SKY = 1000.0;
+
+/// A flat sky with Poisson-like noise and a given number of cosmic rays per pixel
+PTR(MaskedImageT) makeSkyImage(int size, double crDensity, boost::random::mt19937 & rng) {
+    PTR(MaskedImageT) mi(new MaskedImageT(afwGeom::Extent2I(size, size)));
+    boost::random::normal_distribution<> noise(0.0, std::sqrt(SKY));
+    for (int y = 0; y < size; ++y) {
+        MaskedImageT::x_iterator ptr = mi->row_begin(y);
+        for (int x = 0; x < size; ++x, ++ptr) {
+            ptr.image() = SKY + noise(rng);
+            ptr.mask() = 0;
+            ptr.variance() = SKY;
+        }
+    }
+    // cosmic rays are short tracks of up to 5 pixels, a few thousand DN each
+    boost::random::uniform_int_distribution<> position(2, size - 8);
+    boost::random::uniform_int_distribution<> length(1, 5);
+    boost::random::uniform_real_distribution<> amplitude(2000.0, 10000.0);
+    int const nCr = static_cast<int>(crDensity*size*size + 0.5);
+    for (int i = 0; i < nCr; ++i) {
+        int const x0 = position(rng), y0 = position(rng), n = length(rng);
+        double const amp = amplitude(rng);
+        for (int j = 0; j < n; ++j) {
+            (*mi->getImage())(x0 + j, y0 + j/2) += amp;
+        }
+    }
+    return mi;
+}
+
+class FindCosmicRays {
+public:
+    FindCosmicRays(int size, double crDensity) :
+        _psf(21, 21, 1.5, 3.0, 0.1), _rng(1), _original(makeSkyImage(size, crDensity, _rng)),
+        _image(new MaskedImageT(*_original, true))
+    {
+        _policy.set("minSigma", 6.0);
+        _policy.set("min_DN", 150.0);
+        _policy.set("cond3_fac", 2.5);
+        _policy.set("cond3_fac2", 0.6);
+        _policy.set("niteration", 3);
+        _policy.set("nCrPixelMax", 1000000);
+    }
+
+    // Restoring the input is a plain copy, negligible next to the detection itself
+    void operator()() {
+        *_image <<= *_original;
+        algorithms::findCosmicRays(*_image, _psf, SKY, _policy, false);
+    }
+
+private:
+    algorithms::DoubleGaussianPsf _psf;
+    boost::random::mt19937 _rng;
+    PTR(MaskedImageT) _original;
+    PTR(MaskedImageT) _image;
+    lsst::pex::policy::Policy _policy;
+};
+
+class InterpolateOverDefects {
+public:
+    InterpolateOverDefects(int size, int nDefect) :
+        _psf(21, 21, 1.5, 3.0, 0.1), _rng(2), _original(makeSkyImage(size, 0.0, _rng)),
+        _image(new MaskedImageT(*_original, true))
+    {
+        // a mix of bad columns and small blobs
+        boost::random::uniform_int_distribution<> position(10, size - 40);
+        boost::random::uniform_int_distribution<> extent(1, 30);
+        for (int i = 0; i < nDefect; ++i) {
+            int const x0 = position(_rng), y0 = position(_rng);
+            afwGeom::Extent2I dims(3, 3);
+            if (i % 2 == 0) {
+                // draw in turn, so the defects don't depend on the order arguments are evaluated in
+                int const width = 1 + extent(_rng)/10;
+                int const height = extent(_rng);
+                dims = afwGeom::Extent2I(width, height);
+            }
+            _defects.push_back(algorithms::Defect::Ptr(
+                new algorithms::Defect(afwGeom::Box2I(afwGeom::Point2I(x0, y0), dims))));
+        }
+    }
+
+    void operator()() {
+        *_image <<= *_original;
+        algorithms::interpolateOverDefects(*_image, _psf, _defects, SKY);
+    }
+
+private:
+    algorithms::DoubleGaussianPsf _psf;
+    boost::random::mt19937 _rng;
+    PTR(MaskedImageT) _original;
+    PTR(MaskedImageT) _image;
+    std::vector<algorithms::Defect::Ptr> _defects;
+};
+
+} // anonymous namespace
+
+int main() {
+    int const sizes[] = {512, 1024, 2048};
+    double const crDensities[] = {1e-5, 1e-4, 1e-3};
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            FindCosmicRays benchCase(sizes[i], crDensities[j]);
+            benchmarks::runBenchmark("findCosmicRays",
+                                     benchmarks::Params().add("size", sizes[i]).add("crDensity", crDensities[j]),
+                                     benchCase);
+        }
+    }
+
+    int const nDefects[] = {10, 100, 1000};
+    for (int i = 0; i < 3; ++i) {
+        for (int j = 0; j < 3; ++j) {
+            InterpolateOverDefects benchCase(sizes[i], nDefects[j]);
+            benchmarks::runBenchmark("interpolateOverDefects",
+                                     benchmarks::Params().add("size", sizes[i]).add("nDefect", nDefects[j]),
+                                     benchCase);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,186 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/*
+ * Benchmarks for realising coadd and warped PSFs and evaluating CoaddBoundedField
+ */
+#include <vector>
+
+#include "boost/make_shared.hpp"
+#include "boost/random.hpp"
+
+#include "lsst/afw/coord/Coord.h"
+#include "lsst/afw/geom/XYTransform.h"
+#include "lsst/afw/geom/polygon/Polygon.h"
+#include "lsst/afw/image/Wcs.h"
+#include "lsst/afw/math/ChebyshevBoundedField.h"
+#include "lsst/afw/table/Exposure.h"
+#include "lsst/meas/algorithms/CoaddBoundedField.h"
+#include "lsst/meas/algorithms/CoaddPsf.h"
+#include "lsst/meas/algorithms/DoubleGaussianPsf.h"
+#include "lsst/meas/algorithms/WarpedPsf.h"
+#include "benchmark.h"
+
+namespace afwCoord = lsst::afw::coord;
+namespace afwDet = lsst::afw::detection;
+namespace afwGeom = lsst::afw::geom;
+namespace afwImage = lsst::afw::image;
+namespace afwMath = lsst::afw::math;
+namespace afwTable = lsst::afw::table;
+namespace algorithms = lsst::meas::algorithms;
+namespace benchmarks = lsst::meas::algorithms::benchmarks;
+
+namespace {
+
+int const CCD_SIZE = 2000;
+
+/// A TAN Wcs with 0.2 arcsec pixels, rotated and offset slightly according to the seed
+PTR(afwImage::Wcs) makeWcs(boost::random::mt19937 & rng) {
+    boost::random::uniform_real_distribution<> offset(-100.0, 100.0);
+    boost::random::uniform_real_distribution<> rotation(-0.01, 0.01);
+    double const scale = 0.2/3600.0;
+    double const theta = rotation(rng);
+    return afwImage::makeWcs(afwCoord::IcrsCoord(45.0*afwGeom::degrees, 30.0*afwGeom::degrees),
+                             afwGeom::Point2D(offset(rng), offset(rng)),
+                             scale*std::cos(theta), -scale*std::sin(theta),
+                             scale*std::sin(theta), scale*std::cos(theta));
+}
+
+/*
+ * Positions are stepped each iteration so that the PSF's single-position image cache never hits
+ */
+afwGeom::Point2D nextPosition(int & count) {
+    ++count;
+    return afwGeom::Point2D(-200.0 + 400.0*((count*37) % 101)/101.0, -200.0 + 400.0*((count*59) % 103)/103.0);
+}
+
+class CoaddPsfKernelImage {
+public:
+    explicit CoaddPsfKernelImage(int nComponent) : _rng(3), _count(0) {
+        afwTable::Schema schema = afwTable::ExposureTable::makeMinimalSchema();
+        afwTable::Key<double> weightKey = schema.addField<double>("weight", "Coadd weight");
+        afwTable::ExposureCatalog catalog(schema);
+        boost::random::uniform_real_distribution<> sigma(1.2, 2.5);
+        for (int i = 0; i < nComponent; ++i) {
+            PTR(afwTable::ExposureRecord) record = catalog.addNew();
+            record->setId(i);
+            record->setPsf(boost::make_shared<algorithms::DoubleGaussianPsf>(25, 25, sigma(_rng), 4.0, 0.1));
+            record->setWcs(makeWcs(_rng));
+            record->setBBox(afwGeom::Box2I(afwGeom::Point2I(-CCD_SIZE/2, -CCD_SIZE/2),
+                                           afwGeom::Extent2I(CCD_SIZE, CCD_SIZE)));
+            record->set(weightKey, 1.0 + i);
+        }
+        _psf = boost::make_shared<algorithms::CoaddPsf>(catalog, *makeWcs(_rng));
+    }
+
+    void operator()() { _psf->computeKernelImage(nextPosition(_count)); }
+
+private:
+    boost::random::mt19937 _rng;
+    int _count;
+    PTR(algorithms::CoaddPsf) _psf;
+};
+
+class WarpedPsfImage {
+public:
+    explicit WarpedPsfImage(int kernelSize) : _count(0) {
+        std::vector<double> coeffs;
+        coeffs.push_back(0.0);
+        coeffs.push_back(1.0);
+        coeffs.push_back(0.0);
+        coeffs.push_back(1e-9);
+        _psf = boost::make_shared<algorithms::WarpedPsf>(
+            boost::make_shared<algorithms::DoubleGaussianPsf>(kernelSize, kernelSize, 1.5, 4.0, 0.1),
+            boost::make_shared<afwGeom::RadialXYTransform>(coeffs));
+    }
+
+    void operator()() { _psf->computeImage(nextPosition(_count)); }
+
+private:
+    int _count;
+    PTR(algorithms::WarpedPsf) _psf;
+};
+
+class CoaddBoundedFieldEvaluate {
+public:
+    explicit CoaddBoundedFieldEvaluate(int nElement) : _rng(4), _count(0) {
+        afwGeom::Box2I const bbox(afwGeom::Point2I(-CCD_SIZE/2, -CCD_SIZE/2),
+                                  afwGeom::Extent2I(CCD_SIZE, CCD_SIZE));
+        algorithms::CoaddBoundedField::ElementVector elements;
+        boost::random::uniform_real_distribution<> coefficient(-0.1, 0.1);
+        for (int i = 0; i < nElement; ++i) {
+            ndarray::Array<double, 2, 2> coefficients = ndarray::allocate(3, 3);
+            for (int j = 0; j < 3; ++j) {
+                for (int k = 0; k < 3; ++k) {
+                    coefficients[j][k] = (j == 0 && k == 0) ? 1.0 : coefficient(_rng);
+                }
+            }
+            elements.push_back(algorithms::CoaddBoundedField::Element(
+                boost::make_shared<afwMath::ChebyshevBoundedField>(bbox, coefficients),
+                makeWcs(_rng),
+                boost::make_shared<afwGeom::polygon::Polygon>(afwGeom::Box2D(bbox)),
+                1.0 + i));
+        }
+        _field = boost::make_shared<algorithms::CoaddBoundedField>(bbox, makeWcs(_rng), elements);
+    }
+
+    void operator()() {
+        // evaluate at enough points that the timing is not dominated by the timer itself
+        for (int i = 0; i < 1000; ++i) {
+            _field->evaluate(nextPosition(_count));
+        }
+    }
+
+private:
+    boost::random::mt19937 _rng;
+    int _count;
+    PTR(algorithms::CoaddBoundedField) _field;
+};
+
+} // anonymous namespace
+
+int main() {
+    int const nComponents[] = {1, 4, 16, 64};
+    for (int i = 0; i < 4; ++i) {
+        CoaddPsfKernelImage benchCase(nComponents[i]);
+        benchmarks::runBenchmark("CoaddPsf.computeKernelImage",
+                                 benchmarks::Params().add("nComponent", nComponents[i]), benchCase);
+    }
+
+    int const kernelSizes[] = {15, 25, 41};
+    for (int i = 0; i < 3; ++i) {
+        WarpedPsfImage benchCase(kernelSizes[i]);
+        benchmarks::runBenchmark("WarpedPsf.computeImage",
+                                 benchmarks::Params().add("kernelSize", kernelSizes[i]), benchCase);
+    }
+
+    int const nElements[] = {1, 8, 64};
+    for (int i = 0; i < 3; ++i) {
+        CoaddBoundedFieldEvaluate benchCase(nElements[i]);
+        benchmarks::runBenchmark("CoaddBoundedField.evaluate",
+                                 benchmarks::Params().add("nElement", nElements[i]).add("nPoint", 1000),
+                                 benchCase);
+    }
+    return 0;
+}
@@ -0,0 +1,224 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+/*
+ * Benchmarks for PSF determination: candidate extraction, the PCA basis, the spatial fit,
+ * and shapelet measurement of the stars
+ */
+#include <cmath>
+#include <vector>
+
+#include "boost/make_shared.hpp"
+#include "boost/random.hpp"
+
+#include "lsst/afw/coord/Coord.h"
+#include "lsst/afw/detection/Footprint.h"
+#include "lsst/afw/image/Exposure.h"
+#include "lsst/afw/image/Wcs.h"
+#include "lsst/afw/math/SpatialCell.h"
+#include "lsst/afw/table/Source.h"
+#include "lsst/meas/algorithms/PsfCandidate.h"
+#include "lsst/meas/algorithms/Shapelet.h"
+#include "lsst/meas/algorithms/SpatialModelPsf.h"
+#include "benchmark.h"
+
+namespace afwCoord = lsst::afw::coord;
+namespace afwDet = lsst::afw::detection;
+namespace afwGeom = lsst::afw::geom;
+namespace afwImage = lsst::afw::image;
+namespace afwMath = lsst::afw::math;
+namespace afwTable = lsst::afw::table;
+namespace algorithms = lsst::meas::algorithms;
+namespace benchmarks = lsst::meas::algorithms::benchmarks;
+
+typedef float PixelT;
+typedef afwImage::Exposure<PixelT> ExposureT;
+
+namespace {
+
+int const IMAGE_SIZE = 2048;
+int const KERNEL_SIZE = 21;
+double const SKY_VARIANCE = 100.0;
+
+/// An exposure of nStar Gaussian stars whose width varies linearly across the image, with their sources
+struct StarField {
+    StarField(int nStar) : exposure(boost::make_shared<ExposureT>(afwGeom::Extent2I(IMAGE_SIZE, IMAGE_SIZE))) {
+        boost::random::mt19937 rng(5);
+        boost::random::normal_distribution<> noise(0.0, std::sqrt(SKY_VARIANCE));
+        boost::random::uniform_real_distribution<> position(30.0, IMAGE_SIZE - 30.0);
+
+        afwTable::Schema schema = afwTable::SourceTable::makeMinimalSchema();
+        afwTable::Point2DKey::addFields(schema, "centroid", "centroid", "pixel");
+        schema.addField<afwTable::Flag>("centroid_flag", "centroid failed");
+        afwTable::QuadrupoleKey::addFields(schema, "shape", "shape", afwTable::PIXEL);
+        schema.addField<afwTable::Flag>("shape_flag", "shape failed");
+        PTR(afwTable::SourceTable) table = afwTable::SourceTable::make(schema);
+        table->defineCentroid("centroid");
+        table->defineShape("shape");
+        sources = afwTable::SourceCatalog(table);
+
+        afwImage::MaskedImage<PixelT> mi = exposure->getMaskedImage();
+        for (int y = 0; y < IMAGE_SIZE; ++y) {
+            afwImage::MaskedImage<PixelT>::x_iterator ptr = mi.row_begin(y);
+            for (int x = 0; x < IMAGE_SIZE; ++x, ++ptr) {
+                ptr.image() = noise(rng);
+                ptr.mask() = 0;
+                ptr.variance() = SKY_VARIANCE;
+            }
+        }
+        afwImage::MaskPixel const detected = afwImage::Mask<>::getPlaneBitMask("DETECTED");
+        int const hw = 12;
+        for (int i = 0; i < nStar; ++i) {
+            double const xc = position(rng), yc = position(rng);
+            double const sigma = 1.5 + 0.5*(xc + yc)/(2*IMAGE_SIZE);
+            double const flux = 1e5;
+            int const ix = static_cast<int>(xc), iy = static_cast<int>(yc);
+            for (int y = iy - hw; y <= iy + hw; ++y) {
+                for (int x = ix - hw; x <= ix + hw; ++x) {
+                    double const r2 = (x - xc)*(x - xc) + (y - yc)*(y - yc);
+                    (*mi.getImage())(x, y) += flux/(2*M_PI*sigma*sigma)*std::exp(-0.5*r2/(sigma*sigma));
+                    (*mi.getMask())(x, y) |= detected;
+                }
+            }
+            PTR(afwTable::SourceRecord) source = sources.addNew();
+            source->set(table->getCentroidKey(), afwGeom::Point2D(xc, yc));
+            source->set(table->getShapeKey(), afwGeom::ellipses::Quadrupole(sigma*sigma, sigma*sigma, 0.0));
+            PTR(afwDet::Footprint) foot = boost::make_shared<afwDet::Footprint>(afwGeom::Point2I(ix, iy), hw);
+            foot->addPeak(xc, yc, flux);
+            source->setFootprint(foot);
+        }
+        // 0.2 arcsec pixels, as the shapelet code works in sky units
+        double const scale = 0.2/3600.0;
+        exposure->setWcs(afwImage::makeWcs(afwCoord::IcrsCoord(45.0*afwGeom::degrees, 30.0*afwGeom::degrees),
+                                           afwGeom::Point2D(IMAGE_SIZE/2, IMAGE_SIZE/2),
+                                           scale, 0.0, 0.0, scale));
+    }
+
+    /// A cell set holding a fresh PsfCandidate for each star
+    PTR(afwMath::SpatialCellSet) makeCellSet() const {
+        PTR(afwMath::SpatialCellSet) cellSet = boost::make_shared<afwMath::SpatialCellSet>(
+            afwGeom::Box2I(afwGeom::Point2I(0, 0), afwGeom::Extent2I(IMAGE_SIZE, IMAGE_SIZE)), 256, 256);
+        for (afwTable::SourceCatalog::const_iterator iter = sources.begin(); iter != sources.end(); ++iter) {
+            cellSet->insertCandidate(algorithms::makePsfCandidate<PixelT>(iter, exposure));
+        }
+        return cellSet;
+    }
+
+    PTR(ExposureT) exposure;
+    afwTable::SourceCatalog sources;
+};
+
+class ExtractPsfCandidates {
+public:
+    explicit ExtractPsfCandidates(StarField const & stars) : _stars(stars) {}
+
+    // The candidates cache their stamps, so make new ones every iteration
+    void operator()() {
+        for (afwTable::SourceCatalog::const_iterator iter = _stars.sources.begin();
+             iter != _stars.sources.end(); ++iter) {
+            algorithms::makePsfCandidate<PixelT>(iter, _stars.exposure)->getMaskedImage(KERNEL_SIZE, KERNEL_SIZE);
+        }
+    }
+
+private:
+    StarField const & _stars;
+};
+
+class CreateKernel {
+public:
+    explicit CreateKernel(StarField const & stars) : _cellSet(stars.makeCellSet()) {}
+
+    void operator()() {
+        algorithms::createKernelFromPsfCandidates<PixelT>(
+            *_cellSet, afwGeom::Extent2I(IMAGE_SIZE, IMAGE_SIZE), afwGeom::Point2I(0, 0),
+            4, 2, KERNEL_SIZE, 3);
+    }
+
+private:
+    PTR(afwMath::SpatialCellSet) _cellSet;
+};
+
+class FitSpatialKernel {
+public:
+    explicit FitSpatialKernel(StarField const & stars) : _cellSet(stars.makeCellSet()) {
+        _kernel = algorithms::createKernelFromPsfCandidates<PixelT>(
+            *_cellSet, afwGeom::Extent2I(IMAGE_SIZE, IMAGE_SIZE), afwGeom::Point2I(0, 0),
+            4, 2, KERNEL_SIZE, 3).first;
+    }
+
+    void operator()() {
+        algorithms::fitSpatialKernelFromPsfCandidates<PixelT>(_kernel.get(), *_cellSet, 3);
+    }
+
+private:
+    PTR(afwMath::SpatialCellSet) _cellSet;
+    afwMath::LinearCombinationKernel::Ptr _kernel;
+};
+
+class MeasureShapelets {
+public:
+    MeasureShapelets(StarField const & stars, int order) : _stars(stars), _order(order) {}
+
+    void operator()() {
+        for (afwTable::SourceCatalog::const_iterator iter = _stars.sources.begin();
+             iter != _stars.sources.end(); ++iter) {
+            algorithms::Shapelet shapelet(_order, 0.35);
+            shapelet.measureFromImage(*iter, iter->getCentroid(), false, false, 2.0, *_stars.exposure);
+        }
+    }
+
+private:
+    StarField const & _stars;
+    int _order;
+};
+
+} // anonymous namespace
+
+int main() {
+    algorithms::PsfCandidate<PixelT>::setBorderWidth(3);
+    int const nStars[] = {50, 200, 800};
+    for (int i = 0; i < 3; ++i) {
+        StarField const stars(nStars[i]);
+        benchmarks::Params const params = benchmarks::Params().add("nStar", nStars[i]);
+        {
+            ExtractPsfCandidates benchCase(stars);
+            benchmarks::runBenchmark("PsfCandidate.getMaskedImage", params, benchCase);
+        }
+        {
+            CreateKernel benchCase(stars);
+            benchmarks::runBenchmark("createKernelFromPsfCandidates", params, benchCase);
+        }
+        {
+            FitSpatialKernel benchCase(stars);
+            benchmarks::runBenchmark("fitSpatialKernelFromPsfCandidates", params, benchCase);
+        }
+        for (int order = 2; order <= 8; order += 3) {
+            MeasureShapelets benchCase(stars, order);
+            benchmarks::runBenchmark("Shapelet.measureFromImage",
+                                     benchmarks::Params().add("nStar", nStars[i]).add("order", order),
+                                     benchCase);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,116 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#if !defined(LSST_MEAS_ALGORITHMS_BENCHMARKS_BENCHMARK_H)
+#define LSST_MEAS_ALGORITHMS_BENCHMARKS_BENCHMARK_H
+
+/**
+ * @file
+ *
+ * @brief A minimal harness for the meas_algorithms microbenchmarks
+ *
+ * A benchmark case is a functor whose operator() performs one iteration of the operation being
+ * timed; any setup belongs in its constructor.  runBenchmark() calls it until both a minimum
+ * number of iterations and a minimum elapsed time are reached, and writes one line of JSON:
+ *
+ *     {"benchmark": "findCosmicRays", "params": {"size": 1024, "crDensity": 0.0001},
+ *      "iterations": 12, "min": 0.0213, "median": 0.0218, "mean": 0.0220}
+ *
+ * Times are in seconds per iteration.  The minimum time per case may be set with the
+ * environment variable MEAS_ALGORITHMS_BENCHMARK_MIN_TIME (seconds; default 0.5).
+ *
+ * All random numbers come from generators with fixed seeds, so every run of a benchmark
+ * sees the same data.
+ */
+#include <sys/time.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+namespace benchmarks {
+
+/// Wall-clock time in seconds
+inline double now() {
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return tv.tv_sec + 1e-6*tv.tv_usec;
+}
+
+/// Named numeric parameters describing one benchmark case
+class Params {
+public:
+    Params & add(std::string const & name, double value) {
+        _params.push_back(std::make_pair(name, value));
+        return *this;
+    }
+
+    std::string toJson() const {
+        std::ostringstream os;
+        os << "{";
+        for (std::size_t i = 0; i < _params.size(); ++i) {
+            os << (i == 0 ? "" : ", ") << "\"" << _params[i].first << "\": " << _params[i].second;
+        }
+        os << "}";
+        return os.str();
+    }
+
+private:
+    std::vector<std::pair<std::string, double> > _params;
+};
+
+/// Time a benchmark case and write its result to stdout as a line of JSON
+template <typename Case>
+void runBenchmark(std::string const & name, Params const & params, Case & benchCase, int minIterations=3) {
+    char const * minTimeStr = std::getenv("MEAS_ALGORITHMS_BENCHMARK_MIN_TIME");
+    double const minTime = minTimeStr ? std::atof(minTimeStr) : 0.5;
+
+    benchCase();                        // warm up caches and lazy initialisation
+    std::vector<double> times;
+    double total = 0.0;
+    while (static_cast<int>(times.size()) < minIterations || total < minTime) {
+        double const start = now();
+        benchCase();
+        times.push_back(now() - start);
+        total += times.back();
+    }
+    std::sort(times.begin(), times.end());
+
+    std::cout << "{\"benchmark\": \"" << name << "\", \"params\": " << params.toJson()
+              << ", \"iterations\": " << times.size()
+              << ", \"min\": " << times.front()
+              << ", \"median\": " << times[times.size()/2]
+              << ", \"mean\": " << total/times.size() << "}" << std::endl;
+}
+
+}}}} // namespace lsst::meas::algorithms::benchmarks
+
+#endif // !LSST_MEAS_ALGORITHMS_BENCHMARKS_BENCHMARK_H
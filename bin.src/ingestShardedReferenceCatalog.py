@@ -0,0 +1,43 @@
+#!/usr/bin/env python
+#
+# LSST Data Management System
+#
+# Copyright 2008-2016 AURA/LSST.
+#
+# This product includes software developed by the
+# LSST Project (http://www.lsst.org/).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the LSST License Statement and
+# the GNU General Public License along with this program.  If not,
+# see <https://www.lsstcorp.org/LegalNotices/>.
+#
+"""Build a sharded reference catalog from FITS reference catalogs"""
+import argparse
+
+from lsst.meas.algorithms import IngestShardedReferenceCatalogTask
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument("outputDir", help="directory to write the sharded catalog to")
+    parser.add_argument("inputFiles", nargs="+", help="FITS files containing reference catalogs")
+    parser.add_argument("--shardDepth", type=int, help="HTM depth of the shards")
+    parser.add_argument("--indexDepth", type=int, help="HTM depth of the per-shard index")
+    args = parser.parse_args()
+
+    config = IngestShardedReferenceCatalogTask.ConfigClass()
+    if args.shardDepth is not None:
+        config.description.shardDepth = args.shardDepth
+    if args.indexDepth is not None:
+        config.description.indexDepth = args.indexDepth
+    task = IngestShardedReferenceCatalogTask(config=config)
+    task.run(inputFiles=args.inputFiles, outputDir=args.outputDir)
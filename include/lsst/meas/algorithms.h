@@ -22,6 +22,10 @@
  
 #include "lsst/meas/algorithms/CR.h"
 #include "lsst/meas/algorithms/Interp.h"
+#include "lsst/meas/algorithms/MaskedImageAccumulator.h"
+#include "lsst/meas/algorithms/DetectionMask.h"
+#include "lsst/meas/algorithms/Instrumentation.h"
+#include "lsst/meas/algorithms/ThreadPool.h"
 #include "lsst/meas/algorithms/PSF.h"
 #include "lsst/meas/algorithms/PsfCandidate.h"
 #include "lsst/meas/algorithms/SpatialModelPsf.h"
@@ -34,6 +38,10 @@
 #include "lsst/meas/algorithms/SingleGaussianPsf.h"
 #include "lsst/meas/algorithms/DoubleGaussianPsf.h"
 #include "lsst/meas/algorithms/PcaPsf.h"
+#include "lsst/meas/algorithms/OversampledPcaPsf.h"
+#include "lsst/meas/algorithms/TabulatedPsf.h"
+#include "lsst/meas/algorithms/PcaPsfConvolver.h"
+#include "lsst/meas/algorithms/PsfRendering.h"
 #include "lsst/meas/algorithms/CoaddPsf.h"
 #include "lsst/meas/algorithms/WarpedPsf.h"
 #include "lsst/meas/algorithms/CoaddBoundedField.h"
@@ -27,6 +27,7 @@
 //!
 // Handle cosmic rays in a MaskedImage
 //
+#include <utility>
 #include <vector>
 #include "lsst/base.h"
 #include "lsst/afw/image/MaskedImage.h"
@@ -41,6 +42,14 @@ namespace lsst {
 namespace meas {
 namespace algorithms {
 
+/// Summary of the cosmic rays found by findCosmicRaysMaskOnly
+struct CosmicRayStatistics {
+    CosmicRayStatistics() : nCr(0), nPixel(0) {}
+
+    int nCr;                            ///< number of cosmic rays
+    int nPixel;                         ///< number of pixels in all the cosmic rays
+};
+
 template <typename MaskedImageT>
 std::vector<boost::shared_ptr<lsst::afw::detection::Footprint> >
 findCosmicRays(MaskedImageT& image,
@@ -50,6 +59,26 @@ findCosmicRays(MaskedImageT& image,
                bool const keep = false
               );
 
+template <typename MaskedImageT>
+CosmicRayStatistics
+findCosmicRaysMaskOnly(MaskedImageT& image,
+                       lsst::afw::detection::Psf const &psf,
+                       double const bkgd,
+                       lsst::pex::policy::Policy const& policy,
+                       bool const keep = false
+                      );
+
+template <typename MaskedImageT>
+std::pair<std::vector<boost::shared_ptr<lsst::afw::detection::Footprint> >,
+          std::vector<boost::shared_ptr<lsst::afw::detection::Footprint> > >
+findCosmicRaysInSnaps(MaskedImageT& snap0,
+                      MaskedImageT& snap1,
+                      lsst::afw::detection::Psf const &psf,
+                      double const bkgd,
+                      lsst::pex::policy::Policy const& policy,
+                      bool const keep = false
+                     );
+
 }}}
 
 #endif
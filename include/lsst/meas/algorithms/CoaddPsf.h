@@ -24,6 +24,8 @@
 #if !defined(LSST_MEAS_ALGORITHMS_COADDPSF_H)
 #define LSST_MEAS_ALGORITHMS_COADDPSF_H
 
+#include <map>
+#include <utility>
 #include <boost/make_shared.hpp>
 #include "lsst/base.h"
 #include "lsst/meas/algorithms/ImagePsf.h"
@@ -36,11 +38,17 @@
 
 namespace lsst { namespace meas { namespace algorithms {
 
+class WarpedPsf;
+
 /**
  *  @brief CoaddPsf is the Psf derived to be used for non-PSF-matched Coadd images.
  *
  *  It incorporates the logic of James Jee's Stackfit algorithm for estimating the
  *  Psf of coadd by coadding the images of the Psf models of each input exposure.
+ *
+ *  The input Psfs warped to the coadd are cached as they are first used, so computing images is not
+ *  thread-safe: don't use one CoaddPsf from several threads at once, but give each thread a clone(),
+ *  which starts with an empty cache of its own.
  */
 class CoaddPsf : public afw::table::io::PersistableFacade<CoaddPsf>, public ImagePsf {
 public:
@@ -68,6 +76,9 @@ public:
         int cacheSize=10000
     );
 
+    /// Copy constructor; the copy doesn't share (or copy) the cache of warped input Psfs
+    CoaddPsf(CoaddPsf const & other);
+
     /// Polymorphic deep copy.  Usually unnecessary, as Psfs are immutable.
     virtual PTR(afw::detection::Psf) clone() const;
 
@@ -85,6 +96,33 @@ public:
     /// Return the number of component Psfs in this CoaddPsf
     int getComponentCount() const;
 
+    /**
+     *  @brief Return a copy of this CoaddPsf that omits its least-weighted components
+     *
+     *  When computing an image, the components containing the position are sorted by weight, and the
+     *  lightest are omitted for as long as their total weight is no more than maxTruncatedWeightFraction
+     *  of the total; the images of the rest are averaged as usual, i.e. normalized by the weight
+     *  actually used.  This trades accuracy for speed in deep coadds, where many inputs each
+     *  contribute a tiny fraction of the weight.
+     *
+     *  The fraction is not persisted: a truncated CoaddPsf is written, and read back, as an exact one.
+     *
+     *  @param[in] maxTruncatedWeightFraction  Fraction of the weight that may be omitted; 0 for none
+     *  @throws     InvalidParameterError  maxTruncatedWeightFraction is not in [0, 1).
+     */
+    PTR(CoaddPsf) truncate(double maxTruncatedWeightFraction) const;
+
+    /// Return the fraction of the weight that may be omitted when computing images; see truncate()
+    double getMaxTruncatedWeightFraction() const { return _maxTruncatedWeightFraction; }
+
+    /**
+     * Return the fraction of the weight at a point omitted when computing images there; see truncate()
+     *
+     * @param[in]   ccdXY       Position in the coadd.
+     * @throws      InvalidParameterError  No input images contain the position.
+     */
+    double computeTruncatedWeightFraction(afw::geom::Point2D const & ccdXY) const;
+
     /**
      * Get the Psf of the component image at index.
      *
@@ -186,6 +224,13 @@ private:
     afw::geom::Point2D _averagePosition;
     std::string _warpingKernelName;   // could be removed if we could get this from _warpingControl (#2949)
     CONST_PTR(afw::math::WarpingControl) _warpingControl;
+    double _maxTruncatedWeightFraction;    // fraction of the weight that may be omitted; not persisted
+
+    // Each component's Psf warped to the coadd, keyed by the component's Psf and Wcs, made when first used.
+    // Filled in by the const doComputeKernelImage without locking, and not copied by the copy constructor
+    typedef std::map<std::pair<afw::detection::Psf const *, afw::image::Wcs const *>, PTR(WarpedPsf)>
+        WarpedPsfMap;
+    mutable WarpedPsfMap _warpedPsfs;
 };
 
 }}} // namespace lsst::meas::algorithms
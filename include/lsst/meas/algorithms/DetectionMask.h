@@ -0,0 +1,85 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#if !defined(LSST_MEAS_ALGORITHMS_DETECTIONMASK_H)
+#define LSST_MEAS_ALGORITHMS_DETECTIONMASK_H
+
+/**
+ * @file
+ *
+ * @brief Set mask bits for detections and image edges without building intermediate footprints
+ *
+ * @ingroup algorithms
+ */
+#include "lsst/afw/geom/Box.h"
+#include "lsst/afw/image/Mask.h"
+#include "lsst/afw/detection/FootprintSet.h"
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+
+/**
+ * @brief OR a bitmask into every pixel of a mask covered by the grown footprints of a FootprintSet
+ *
+ * The mask bits set are the same as those set by
+ * afw::detection::FootprintSet(footprints, nGrow, isotropic).setMask(mask, ...), but the grown
+ * footprints are never built: each span is dilated by the structuring element and written straight
+ * into the mask, one merged run of pixels per row.
+ *
+ * @param[in,out] mask  mask to modify; pixels of grown footprints outside it are ignored
+ * @param[in] footprints  footprints to grow
+ * @param[in] nGrow  number of pixels to grow by; 0 masks the footprints as they are
+ * @param[in] isotropic  if true grow by a disk of radius nGrow, else by a diamond
+ *                       (all pixels within a Manhattan distance of nGrow)
+ * @param[in] bitmask  bits to OR into the mask
+ *
+ * @throw lsst::pex::exceptions::InvalidParameterError if nGrow < 0
+ */
+template <typename MaskPixelT>
+void setMaskFromGrownFootprints(
+    afw::image::Mask<MaskPixelT> & mask,
+    afw::detection::FootprintSet const & footprints,
+    int nGrow,
+    bool isotropic,
+    MaskPixelT bitmask
+);
+
+/**
+ * @brief OR a bitmask into every pixel of a mask that lies outside a box
+ *
+ * @param[in,out] mask  mask to modify
+ * @param[in] box  box, in PARENT coordinates, whose pixels are not modified
+ * @param[in] bitmask  bits to OR into the mask
+ */
+template <typename MaskPixelT>
+void setMaskOutsideBox(
+    afw::image::Mask<MaskPixelT> & mask,
+    afw::geom::Box2I const & box,
+    MaskPixelT bitmask
+);
+
+}}} // namespace lsst::meas::algorithms
+
+#endif // !LSST_MEAS_ALGORITHMS_DETECTIONMASK_H
@@ -31,7 +31,13 @@
 
 namespace lsst { namespace meas { namespace algorithms {
 
-/// Represent a Psf as a circularly symmetrical double Gaussian
+/**
+ *  @brief Represent a Psf as a circularly symmetrical double Gaussian
+ *
+ *  The normalized kernel image is computed once, at construction; images shifted by a fraction of a
+ *  pixel are evaluated directly as a sum of outer products of 1-D Gaussians rather than by resampling
+ *  the kernel image.
+ */
 class DoubleGaussianPsf : public afw::table::io::PersistableFacade<DoubleGaussianPsf>, public KernelPsf {
 public:
 
@@ -68,9 +74,20 @@ protected:
     virtual void write(OutputArchiveHandle & handle) const;
 
 private:
+    virtual PTR(Image) doComputeKernelImage(
+        afw::geom::Point2D const & position,
+        afw::image::Color const & color
+    ) const;
+
+    virtual PTR(Image) doComputeImage(
+        afw::geom::Point2D const & position,
+        afw::image::Color const & color
+    ) const;
+
     double _sigma1;
     double _sigma2;
     double _b;
+    PTR(Image) _kernelImage;            // normalized kernel image; never modified after construction
 
     friend class boost::serialization::access;
     template <class Archive>
@@ -35,6 +35,7 @@
 #include <vector>
 
 #include "boost/shared_ptr.hpp"
+#include "Eigen/Core"
 
 #include "lsst/afw.h"
 
@@ -47,15 +48,32 @@ class PsfImagePca : public afw::image::ImagePca<ImageT> {
     typedef typename afw::image::ImagePca<ImageT> Super; ///< Base class
 public:
     /// Ctor
-    explicit PsfImagePca(bool constantWeight=true, int border=3) : Super(constantWeight), _border(border) {}
+    explicit PsfImagePca(bool constantWeight=true, int border=3) :
+        Super(constantWeight), _border(border), _badPixels(), _badPixelMask(0) {}
 
     /// Generate eigenimages that are normalised and background-subtracted
     ///
     /// The background subtraction ensures PSF variation doesn't couple with small background errors.
     virtual void analyze();
 
+    /// Replace the pixels that have any bit of mask set with a model, returning the largest change
+    ///
+    /// The model is that of afw::image::ImagePca::updateBadPixels: if ncomp == 0 it is the (flux-scaled)
+    /// inverse-variance weighted mean of all the images' good pixels, otherwise it is the least-squares
+    /// fit of the first ncomp eigen images to the whole image.  The bad pixels of each image are listed
+    /// on the first call and the list reused while the mask and the number of images are unchanged, so
+    /// only those pixels are updated, and the eigen images' normal equations are only built by analyze().
+    /// Images without a mask plane have no bad pixels.
+    ///
+    /// @throw lsst::pex::exceptions::LengthError if there are no images, or fewer than ncomp eigen images
+    virtual double updateBadPixels(unsigned long mask, int const ncomp);
+
 private:
     int const _border;                  ///< Border width for background subtraction
+    std::vector<std::vector<int> > _badPixels; ///< Indices (x + y*width) of each image's bad pixels
+    unsigned long _badPixelMask;               ///< Mask used to find _badPixels
+    Eigen::MatrixXd _basis;             ///< The eigen images as of the last analyze(), one per column
+    Eigen::MatrixXd _normal;            ///< _basis^T _basis
 };
 
 }}} // namespace
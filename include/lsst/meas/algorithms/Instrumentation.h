@@ -0,0 +1,193 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#if !defined(LSST_MEAS_ALGORITHMS_INSTRUMENTATION_H)
+#define LSST_MEAS_ALGORITHMS_INSTRUMENTATION_H
+
+/**
+ * @file
+ *
+ * @brief Lightweight timers and counters for the hot paths of meas_algorithms
+ *
+ * Probes are always compiled in, but do nothing beyond testing a flag unless instrumentation
+ * is enabled, either with setInstrumentationEnabled() or by setting the environment variable
+ * MEAS_ALGORITHMS_INSTRUMENTATION to a non-empty value.  Probes accumulate process-wide until
+ * resetInstrumentation() is called; collectInstrumentation() copies them into a PropertySet
+ * such as a task's metadata.
+ *
+ * Since probes are shared by the whole process, code that wants the values due to its own work should
+ * take an InstrumentationSnapshot before starting it, rather than calling resetInstrumentation().
+ *
+ * Probes are declared where they are used:
+ * @code
+ * LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "findCosmicRays.candidates");
+ * ...
+ * timer.stop();                         // or let it go out of scope
+ * LSST_MEAS_ALGORITHMS_COUNT("findCosmicRays.crPixels", crpixels.size());
+ * @endcode
+ *
+ * @ingroup algorithms
+ */
+#include <map>
+#include <string>
+
+#include "boost/cstdint.hpp"
+#include "boost/preprocessor/cat.hpp"
+
+#include "lsst/daf/base/PropertySet.h"
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+
+/// Is instrumentation enabled?
+bool isInstrumentationEnabled();
+
+/// Enable or disable instrumentation; disabling does not discard what has been accumulated
+void setInstrumentationEnabled(bool enabled);
+
+/// Zero all timers and counters
+void resetInstrumentation();
+
+/**
+ * @brief Copy all timers and counters that have fired into a PropertySet
+ *
+ * A timer "name" sets "<prefix>name.seconds" (double) and "<prefix>name.calls" (int64);
+ * a counter sets "<prefix>name.count" (int64).  In a hierarchical PropertySet (unlike a
+ * PropertyList) dotted names therefore produce nested PropertySets.
+ *
+ * @param[in,out] metadata  where to put the results; existing values are replaced
+ * @param[in] prefix  prepended to the name of each probe
+ * @param[in] reset  if true, zero the timers and counters once collected
+ */
+void collectInstrumentation(daf::base::PropertySet & metadata, std::string const & prefix="",
+                            bool reset=false);
+
+/**
+ * @brief The values of all timers and counters at one moment
+ *
+ * Lets a caller find how much its own work added to the probes without resetting them,
+ * which would lose the values for anyone else collecting them.
+ */
+class InstrumentationSnapshot {
+public:
+    /// Record the current values of all probes
+    InstrumentationSnapshot();
+
+    /**
+     * @brief Copy how much each probe has changed since the snapshot into a PropertySet
+     *
+     * The names and values are as for collectInstrumentation; probes that haven't changed are skipped.
+     *
+     * @param[in,out] metadata  where to put the results; existing values are replaced
+     * @param[in] prefix  prepended to the name of each probe
+     * @param[in] probePrefix  only copy probes whose names start with this
+     */
+    void collect(daf::base::PropertySet & metadata, std::string const & prefix="",
+                 std::string const & probePrefix="") const;
+
+private:
+    std::map<std::string, std::pair<boost::int64_t, boost::int64_t> > _values; // (count, nanoseconds)
+};
+
+namespace instrumentation {
+
+/// Accumulated values of one named probe, shared by all probes with that name
+struct ProbeData;
+
+/// Process-wide flag; read inline so that disabled probes cost a single test
+extern volatile bool enabled;
+
+/// A named, monotonically increasing count
+class Counter {
+public:
+    explicit Counter(std::string const & name);
+
+    void add(boost::int64_t n=1) {
+        if (enabled) {
+            _add(n);
+        }
+    }
+
+private:
+    void _add(boost::int64_t n);
+
+    ProbeData * _data;
+};
+
+/// A named accumulator of elapsed time and number of calls
+class Timer {
+public:
+    explicit Timer(std::string const & name);
+
+    /// Add one call of the given duration
+    void record(boost::int64_t nanoseconds);
+
+private:
+    ProbeData * _data;
+};
+
+/// Times from construction until stop() or destruction, if instrumentation was enabled at construction
+class ScopedTimer {
+public:
+    explicit ScopedTimer(Timer & timer) : _timer(enabled ? &timer : 0), _start(_timer ? now() : 0) {}
+
+    ~ScopedTimer() { stop(); }
+
+    /// Stop the timer and record its duration; later calls do nothing
+    void stop() {
+        if (_timer) {
+            _timer->record(now() - _start);
+            _timer = 0;
+        }
+    }
+
+    /// Monotonic time in nanoseconds
+    static boost::int64_t now();
+
+private:
+    ScopedTimer(ScopedTimer const &);
+    ScopedTimer & operator=(ScopedTimer const &);
+
+    Timer * _timer;
+    boost::int64_t _start;
+};
+
+} // namespace instrumentation
+
+}}} // namespace lsst::meas::algorithms
+
+/// Declare a ScopedTimer VAR timing the probe NAME (a string literal)
+#define LSST_MEAS_ALGORITHMS_SCOPED_TIMER(VAR, NAME) \
+    static ::lsst::meas::algorithms::instrumentation::Timer BOOST_PP_CAT(VAR, _probe)(NAME); \
+    ::lsst::meas::algorithms::instrumentation::ScopedTimer VAR(BOOST_PP_CAT(VAR, _probe))
+
+/// Add N to the counter NAME (a string literal)
+#define LSST_MEAS_ALGORITHMS_COUNT(NAME, N) \
+    do { \
+        static ::lsst::meas::algorithms::instrumentation::Counter lsstMeasAlgorithmsCounter(NAME); \
+        lsstMeasAlgorithmsCounter.add(N); \
+    } while (false)
+
+#endif // !LSST_MEAS_ALGORITHMS_INSTRUMENTATION_H
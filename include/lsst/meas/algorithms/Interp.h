@@ -27,6 +27,7 @@
 //!
 // Interpolate over defects in a MaskedImage
 //
+#include <cmath>
 #include <limits>
 #include <vector>
 #include "lsst/afw/image/Defect.h"
@@ -59,6 +60,38 @@ namespace interp {
      */
     double const min2GaussianBias = -0.5641895835; ///< Mean value of the minimum of two N(0,1) variates
 
+    /**
+     * @brief Arithmetic used when estimating the values of pixels of type PixelT
+     *
+     * Estimates are made in the pixel type itself for floating-point images.  For integer images they
+     * are made in double (so means of neighbouring pixels aren't truncated, and negative intermediate
+     * values don't wrap), and rounded and clamped to the range of the type when they're written back.
+     */
+    template <typename PixelT, bool isInteger = std::numeric_limits<PixelT>::is_integer>
+    struct PixelArithmetic {
+        typedef PixelT Working;         ///< type in which to compute estimates
+
+        /// The smallest value that a pixel may take
+        static PixelT lowest() { return -std::numeric_limits<PixelT>::max(); }
+        /// Convert an estimate to a pixel value
+        static PixelT convert(double value) { return static_cast<PixelT>(value); }
+    };
+
+    template <typename PixelT>
+    struct PixelArithmetic<PixelT, true> {
+        typedef double Working;
+
+        static PixelT lowest() { return std::numeric_limits<PixelT>::min(); }
+        static PixelT convert(double value) {
+            if (!(value > std::numeric_limits<PixelT>::min())) { // n.b. NaN sets the pixel to the minimum
+                return std::numeric_limits<PixelT>::min();
+            } else if (value >= std::numeric_limits<PixelT>::max()) {
+                return std::numeric_limits<PixelT>::max();
+            }
+            return static_cast<PixelT>(std::floor(value + 0.5));
+        }
+    };
+
     template <typename MaskedImageT>
     std::pair<bool, typename MaskedImageT::Image::Pixel> singlePixel(int x, int y, MaskedImageT const &image,
                                                                      bool horizontal, double minval);
@@ -23,12 +23,21 @@
 #ifndef LSST_MEAS_ALGORITHMS_KernelPsf_h_INCLUDED
 #define LSST_MEAS_ALGORITHMS_KernelPsf_h_INCLUDED
 
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "lsst/afw/math/Kernel.h"
 #include "lsst/meas/algorithms/ImagePsf.h"
 
 namespace lsst { namespace meas { namespace algorithms {
 
 /**
  *  @brief A Psf defined by a Kernel
+ *
+ *  If the Kernel is an afw::math::SeparableKernel, images of the Psf shifted by a fraction of a pixel
+ *  are made by evaluating its 1-D functions at the shifted positions (rather than by resampling the
+ *  kernel image), and the 1-D factors of the kernel image are available from computeKernelVectors.
  */
 class KernelPsf : public afw::table::io::PersistableFacade<KernelPsf>, public ImagePsf {
 public:
@@ -60,6 +69,23 @@ public:
     /// Whether this object is persistable; just delegates to the kernel.
     virtual bool isPersistable() const;
 
+    /// Is the Kernel separable, i.e. an afw::math::SeparableKernel?
+    bool isSeparable() const { return static_cast<bool>(_separableKernel); }
+
+    /**
+     *  @brief Return the 1-D factors (column, row) of the normalized kernel image at a point
+     *
+     *  The kernel image is their outer product, image(x, y) = first[x]*second[y], with pixel indices
+     *  relative to the image's corner; each factor sums to one.  Useful for separable convolution.
+     *
+     *  @param[in] position  Position at which to evaluate the kernel; NaN means getAveragePosition().
+     *
+     *  @throw lsst::pex::exceptions::LogicError if the Kernel is not separable
+     */
+    std::pair<std::vector<double>, std::vector<double> > computeKernelVectors(
+        afw::geom::Point2D position=afw::geom::Point2D(std::numeric_limits<double>::quiet_NaN())
+    ) const;
+
 protected:
 
     /// Construct a KernelPsf with the given kernel; it should not be modified afterwards.
@@ -68,6 +94,15 @@ protected:
         afw::geom::Point2D const & averagePosition=afw::geom::Point2D()
     );
 
+    /**
+     *  @brief Sample a 1-D kernel function at pixels 0..n-1, relative to a centre at centre + offset
+     *
+     *  Used to evaluate separable Psfs shifted by a fraction (offset) of a pixel.
+     */
+    static std::vector<double> sampleKernelFunction(
+        afw::math::SeparableKernel::KernelFunction const & func, int n, int centre, double offset
+    );
+
     // Name to use persist this object as (should be overridden by derived classes).
     virtual std::string getPersistenceName() const;
 
@@ -87,7 +122,13 @@ private:
         afw::image::Color const & color
     ) const;
 
+    virtual PTR(Image) doComputeImage(
+        afw::geom::Point2D const & position,
+        afw::image::Color const & color
+    ) const;
+
     PTR(afw::math::Kernel) _kernel;
+    PTR(afw::math::SeparableKernel const) _separableKernel; // _kernel, if it is separable; else null
     afw::geom::Point2D _averagePosition;
 };
 
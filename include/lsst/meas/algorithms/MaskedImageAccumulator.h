@@ -0,0 +1,101 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#if !defined(LSST_MEAS_ALGORITHMS_MASKEDIMAGEACCUMULATOR_H)
+#define LSST_MEAS_ALGORITHMS_MASKEDIMAGEACCUMULATOR_H
+
+/**
+ * @file
+ *
+ * @brief Streaming sum of MaskedImages
+ *
+ * @ingroup algorithms
+ */
+#include "lsst/base.h"
+#include "lsst/afw/geom/Extent.h"
+#include "lsst/afw/geom/Point.h"
+#include "lsst/afw/image/MaskedImage.h"
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+
+/**
+ * @brief Accumulate the sum of a sequence of MaskedImages
+ *
+ * Inputs are added one at a time (or one band of rows at a time), so only the sum and the
+ * current input need be resident.  Each input is added in a single pass over its rows that
+ * sums the image and variance planes and ORs the mask plane.
+ *
+ * Independent accumulators (e.g. one per thread, each fed a subset of the inputs) may be
+ * combined with merge().
+ */
+template <typename PixelT>
+class MaskedImageAccumulator {
+public:
+    typedef afw::image::MaskedImage<PixelT> MaskedImageT;
+
+    /**
+     * @brief Construct an accumulator whose sum is zero, with no mask bits set
+     *
+     * @param[in] dimensions  dimensions of the sum (and of every input passed to add())
+     * @param[in] xy0  origin of the sum
+     */
+    explicit MaskedImageAccumulator(
+        afw::geom::Extent2I const & dimensions,
+        afw::geom::Point2I const & xy0=afw::geom::Point2I()
+    );
+
+    /**
+     * @brief Add a MaskedImage to the sum
+     *
+     * The input's xy0 is ignored.
+     *
+     * @throw lsst::pex::exceptions::LengthError if the input's dimensions differ from the sum's
+     */
+    void add(MaskedImageT const & input);
+
+    /**
+     * @brief Add a band of rows to the sum
+     *
+     * The input's xy0 is ignored; its first row is added to row y (relative to the sum's xy0).
+     *
+     * @throw lsst::pex::exceptions::LengthError if the band's width differs from the sum's,
+     *        or if the band does not fit within the sum
+     */
+    void addRows(MaskedImageT const & band, int y);
+
+    /// Add the sum held by another accumulator of the same dimensions
+    void merge(MaskedImageAccumulator const & other);
+
+    /// Return the sum; the image is shared with the accumulator, not copied
+    PTR(MaskedImageT) getResult() const { return _sum; }
+
+private:
+    PTR(MaskedImageT) _sum;
+};
+
+}}} // namespace lsst::meas::algorithms
+
+#endif // !LSST_MEAS_ALGORITHMS_MASKEDIMAGEACCUMULATOR_H
@@ -0,0 +1,124 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_MEAS_ALGORITHMS_OversampledPcaPsf_h_INCLUDED
+#define LSST_MEAS_ALGORITHMS_OversampledPcaPsf_h_INCLUDED
+
+#include <vector>
+
+#include "lsst/afw/math/Function.h"
+#include "lsst/afw/math/Kernel.h"
+#include "lsst/meas/algorithms/ImagePsf.h"
+
+namespace lsst { namespace meas { namespace algorithms {
+
+/**
+ *  @brief A PCA PSF whose basis images are sampled on a grid finer than the pixels
+ *
+ *  Each basis image samples the pixel-integrated PSF (the "effective PSF") at intervals of
+ *  1/oversampling pixel, as made by PsfCandidate::getOversampledImage().  The PSF at a position is
+ *  the sum of the basis images weighted by their spatial functions; an image of it at any sub-pixel
+ *  phase is gathered from the basis by linear interpolation between the nearest samples, so neither
+ *  computeKernelImage nor computeImage needs to resample the image with a warping kernel.
+ *  Like those of other Psfs, the images are normalised to unit sum.
+ */
+class OversampledPcaPsf : public afw::table::io::PersistableFacade<OversampledPcaPsf>, public ImagePsf {
+public:
+
+    typedef afw::image::Image<double> BasisImage;
+
+    /**
+     *  @brief Construct an OversampledPcaPsf
+     *
+     *  @param[in] basis            Basis images; all must have dimensions oversampling*dimensions
+     *  @param[in] spatialFunctions Spatial variation of the weight of each basis image
+     *  @param[in] oversampling     Number of samples per pixel in each dimension
+     *  @param[in] dimensions       Dimensions of images of the PSF, in pixels
+     *  @param[in] averagePosition  Average position of stars used to construct the Psf.
+     *
+     *  @throw lsst::pex::exceptions::InvalidParameterError if the arguments are inconsistent
+     */
+    OversampledPcaPsf(
+        std::vector<PTR(BasisImage)> const & basis,
+        std::vector<afw::math::Kernel::SpatialFunctionPtr> const & spatialFunctions,
+        int oversampling,
+        afw::geom::Extent2I const & dimensions,
+        afw::geom::Point2D const & averagePosition = afw::geom::Point2D()
+    );
+
+    /// Polymorphic deep copy
+    virtual PTR(afw::detection::Psf) clone() const;
+
+    /// Return the number of samples per pixel in each dimension
+    int getOversampling() const { return _oversampling; }
+
+    /// Return the dimensions of images of the PSF, in pixels
+    afw::geom::Extent2I getDimensions() const { return _dimensions; }
+
+    /// Return the oversampled basis images
+    std::vector<PTR(BasisImage const)> getBasis() const;
+
+    /// Return the weights of the basis images at a point
+    std::vector<double> getWeights(afw::geom::Point2D const & position) const;
+
+    /// Return average position of stars; used as default position.
+    virtual afw::geom::Point2D getAveragePosition() const { return _averagePosition; }
+
+    /// Whether this object is persistable; it is if all its spatial functions are.
+    virtual bool isPersistable() const;
+
+protected:
+
+    virtual std::string getPersistenceName() const;
+
+    virtual std::string getPythonModule() const;
+
+    virtual void write(OutputArchiveHandle & handle) const;
+
+private:
+
+    virtual PTR(Image) doComputeKernelImage(
+        afw::geom::Point2D const & position,
+        afw::image::Color const & color
+    ) const;
+
+    virtual PTR(Image) doComputeImage(
+        afw::geom::Point2D const & position,
+        afw::image::Color const & color
+    ) const;
+
+    // Sum the basis images, weighted by their spatial functions at position, sampled with the centre of
+    // the PSF offset by (dx, dy) pixels from the centre of the central pixel; normalised to unit sum
+    PTR(Image) _render(afw::geom::Point2D const & position, double dx, double dy) const;
+
+    std::vector<PTR(BasisImage)> _basis;
+    std::vector<afw::math::Kernel::SpatialFunctionPtr> _spatialFunctions;
+    int _oversampling;
+    afw::geom::Extent2I _dimensions;
+    afw::geom::Point2D _averagePosition;
+};
+
+}}} // namespace lsst::meas::algorithms
+
+#endif // !LSST_MEAS_ALGORITHMS_OversampledPcaPsf_h_INCLUDED
@@ -51,10 +51,37 @@ public:
     /// PcaPsf always has a LinearCombinationKernel, so we can override getKernel to make it more useful.
     PTR(afw::math::LinearCombinationKernel const) getKernel() const;
 
+    /**
+     *  @brief Set whether PcaPsfs are written to table archives in the compact format
+     *
+     *  The standard format stores each basis image as a nested FixedKernel and each spatial
+     *  function as a nested object.  The compact format instead stores all the basis images,
+     *  in single precision, as one array in a single record, together with the coefficients of
+     *  all the spatial functions, so reading a PcaPsf is a single contiguous read.
+     *
+     *  The compact format is used only for PcaPsfs whose basis kernels are all FixedKernels, and
+     *  whose kernels are either not spatially varying or have spatial functions that are all
+     *  PolynomialFunction2s or all Chebyshev1Function2s of the same order and range (as made
+     *  by PcaPsfDeterminer); other PcaPsfs are always written in the standard format.
+     *  Both formats can always be read.
+     *
+     *  The setting is process-wide; the default is the standard format.
+     */
+    static void setCompactPersistence(bool compact);
+
+    /// Are PcaPsfs written in the compact format where possible?  See setCompactPersistence.
+    static bool getCompactPersistence();
+
 private:
 
-    // Name used in table persistence; the rest of is implemented by KernelPsf.
-    virtual std::string getPersistenceName() const { return "PcaPsf"; }
+    // Whether this PcaPsf is written in the compact format
+    bool _isWrittenCompact() const;
+
+    // Name used in table persistence; depends on whether the compact format is used.
+    virtual std::string getPersistenceName() const;
+
+    // Table persistence; the standard format is implemented by KernelPsf.
+    virtual void write(OutputArchiveHandle & handle) const;
 
     friend class boost::serialization::access;
 
@@ -0,0 +1,114 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#ifndef LSST_MEAS_ALGORITHMS_PcaPsfConvolver_h_INCLUDED
+#define LSST_MEAS_ALGORITHMS_PcaPsfConvolver_h_INCLUDED
+
+#include <complex>
+#include <vector>
+
+#include "lsst/afw/image/Image.h"
+#include "lsst/afw/math/ConvolveImage.h"
+#include "lsst/afw/math/Kernel.h"
+#include "lsst/meas/algorithms/PcaPsf.h"
+
+namespace lsst { namespace meas { namespace algorithms {
+
+/**
+ *  @brief Convolve images with the spatially varying kernel of a PcaPsf
+ *
+ *  The kernel of a PcaPsf is a LinearCombinationKernel, K(x, y) = sum_k c_k(x, y) B_k, so convolving
+ *  an image with it is the same as convolving the image with each basis image B_k and summing the
+ *  results weighted by c_k evaluated at each output pixel.  This is done tile by tile with FFTs
+ *  (overlap-save): each tile of the input is transformed once, multiplied by the precomputed transform
+ *  of each basis image, and transformed back, two basis images per inverse transform.  The cost per
+ *  pixel therefore grows with the number of basis images rather than with the area of the kernel,
+ *  and the spatial functions are evaluated once per pixel rather than the kernel image being
+ *  recomputed.
+ *
+ *  The results are those of afw::math::convolve with the PcaPsf's kernel and a maxInterpolationDistance
+ *  of 0 (i.e. no interpolation of the kernel between pixels), to within rounding.  Tiles are
+ *  convolved concurrently on the shared thread pool (see ThreadPool.h); the results do not depend on
+ *  the number of threads.
+ */
+class PcaPsfConvolver {
+public:
+
+    /**
+     *  @brief Prepare to convolve images with a PcaPsf's kernel
+     *
+     *  @param[in] psf      PSF whose kernel to convolve with
+     *  @param[in] fftSize  Width and height of the FFTs; each tile yields an output region
+     *                      (fftSize - kernel width + 1) by (fftSize - kernel height + 1) pixels.
+     *                      Products of small primes (2, 3, 5) are fastest.
+     *
+     *  @throw lsst::pex::exceptions::InvalidParameterError if fftSize is smaller than the kernel
+     */
+    explicit PcaPsfConvolver(PcaPsf const & psf, int fftSize=256);
+
+    /// Return the width and height of the FFTs
+    int getFftSize() const { return _fftSize; }
+
+    /// Return the kernel convolved with
+    PTR(afw::math::LinearCombinationKernel const) getKernel() const { return _kernel; }
+
+    /**
+     *  @brief Convolve an image with the kernel
+     *
+     *  As for afw::math::convolve, the output and input images must have the same dimensions, the
+     *  spatial functions are evaluated at the position (including xy0) of each output pixel, and the
+     *  edge pixels (for which the kernel extends off the image) are copied from the input if
+     *  control.getDoCopyEdge() is set, and otherwise set to the standard edge pixel (see
+     *  afw::math::edgePixel; NaN for floating-point images).
+     *
+     *  @param[out] convolvedImage  convolved image
+     *  @param[in]  inImage         image to convolve
+     *  @param[in]  control         whether to normalize the kernel and to copy the edge pixels;
+     *                              maxInterpolationDistance is ignored
+     *
+     *  @throw lsst::pex::exceptions::InvalidParameterError if the images' dimensions differ or are
+     *         smaller than the kernel
+     *  @throw lsst::pex::exceptions::OverflowError if doNormalize is set and the kernel sums to zero
+     *         (as a RuntimeError if the thread pool is in use)
+     */
+    template <typename OutPixelT, typename InPixelT>
+    void convolve(
+        afw::image::Image<OutPixelT> & convolvedImage,
+        afw::image::Image<InPixelT> const & inImage,
+        afw::math::ConvolutionControl const & control=afw::math::ConvolutionControl()
+    ) const;
+
+private:
+
+    typedef std::complex<double> Complex;
+
+    PTR(afw::math::LinearCombinationKernel const) _kernel;
+    int _fftSize;
+    std::vector<double> _basisSums;                 // sum of each basis image
+    std::vector<std::vector<Complex> > _spectra;    // conjugated transform of each zero-padded basis image
+};
+
+}}} // namespace lsst::meas::algorithms
+
+#endif // !LSST_MEAS_ALGORITHMS_PcaPsfConvolver_h_INCLUDED
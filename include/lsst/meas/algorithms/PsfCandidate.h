@@ -131,6 +131,9 @@ namespace algorithms {
         CONST_PTR(afw::image::MaskedImage<PixelT>) getMaskedImage(int width, int height) const;
         PTR(afw::image::MaskedImage<PixelT>) getOffsetImage(std::string const algorithm,
                                                             unsigned int buffer) const;
+        PTR(afw::image::MaskedImage<PixelT>) getOversampledImage(int oversampling,
+                                                                 std::string const algorithm,
+                                                                 unsigned int buffer) const;
 
         /// Return the number of pixels being ignored around the candidate image's edge
         static int getBorderWidth() { return _border; }
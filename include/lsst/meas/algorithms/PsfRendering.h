@@ -0,0 +1,91 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#if !defined(LSST_MEAS_ALGORITHMS_PSFRENDERING_H)
+#define LSST_MEAS_ALGORITHMS_PSFRENDERING_H
+
+/**
+ * @file
+ *
+ * @brief Add many images of a PSF to an image, e.g. to inject fake sources or subtract models
+ *
+ * @ingroup algorithms
+ */
+#include <vector>
+
+#include "lsst/afw/detection/Psf.h"
+#include "lsst/afw/image/MaskedImage.h"
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+
+/**
+ * @brief Add scaled images of a PSF at a list of positions to a MaskedImage
+ *
+ * Source i adds flux[i]*psf.computeImage((x[i], y[i])) to the image, clipped to its bounding box.
+ *
+ * If subpixelTolerance > 0, PSF images are reused rather than computed for each source: the image is
+ * divided into cells of cellSize x cellSize pixels, positions are rounded to a grid of spacing
+ * 1/ceil(1/subpixelTolerance) pixels, and all the sources in a cell that round to the same sub-pixel
+ * phase share one image, computed at the centre of the cell with that phase and shifted by a whole
+ * number of pixels.  Each source is therefore drawn with the PSF at most cellSize/sqrt(2) pixels
+ * away, displaced by at most subpixelTolerance/2 pixels in each direction.  If subpixelTolerance
+ * is <= 0 every source's image is computed at its exact position, and cellSize only sets the
+ * size of the bands of rows into which the work is divided.
+ *
+ * The PSF images are all computed before any are added (Psfs need not be thread-safe); they are then
+ * added in parallel on the shared thread pool (see ThreadPool.h), each thread adding all the sources
+ * that touch one band of cellSize rows to the pixels of that band.  The results do not depend on the
+ * number of threads.
+ *
+ * @param[in,out] image  image to which to add the PSF images
+ * @param[in] psf  PSF to add
+ * @param[in] x, y  positions of the sources, in the image's parent coordinates
+ * @param[in] flux  flux of each source
+ * @param[in] subpixelTolerance  largest sub-pixel step between positions at which PSF images are reused;
+ *                               <= 0 to compute an image at each position
+ * @param[in] cellSize  size of the cells within which images are reused
+ * @param[in] gain  if > 0, also add each source's image divided by gain to the variance plane
+ *
+ * @return the number of PSF images computed
+ *
+ * @throw lsst::pex::exceptions::LengthError if x, y and flux have different lengths
+ * @throw lsst::pex::exceptions::InvalidParameterError if cellSize < 1
+ */
+template <typename PixelT>
+int addPsfImages(
+    afw::image::MaskedImage<PixelT> & image,
+    afw::detection::Psf const & psf,
+    std::vector<double> const & x,
+    std::vector<double> const & y,
+    std::vector<double> const & flux,
+    double subpixelTolerance=0.0,
+    int cellSize=256,
+    double gain=0.0
+);
+
+}}} // namespace lsst::meas::algorithms
+
+#endif // !LSST_MEAS_ALGORITHMS_PSFRENDERING_H
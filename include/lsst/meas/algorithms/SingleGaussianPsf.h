@@ -33,6 +33,10 @@ namespace lsst { namespace meas { namespace algorithms {
 
 /*!
  * @brief Represent a PSF as a circularly symmetrical Gaussian
+ *
+ * The normalized kernel image is computed once, at construction; as the kernel is separable, images
+ * shifted by a fraction of a pixel are evaluated by KernelPsf as the outer product of two 1-D Gaussians
+ * rather than by resampling the kernel image.
  */
 class SingleGaussianPsf : public afw::table::io::PersistableFacade<SingleGaussianPsf>, public KernelPsf {
 public:
@@ -64,7 +68,13 @@ protected:
     virtual void write(OutputArchiveHandle & handle) const;
 
 private:
+    virtual PTR(Image) doComputeKernelImage(
+        afw::geom::Point2D const & position,
+        afw::image::Color const & color
+    ) const;
+
     double _sigma;                     ///< Width of Gaussian
+    PTR(Image) _kernelImage;           ///< Normalized kernel image; never modified after construction
 
 private:
     friend class boost::serialization::access;
@@ -31,6 +31,7 @@
  *
  * @ingroup algorithms
  */
+#include <string>
 #include <utility>
 #include <vector>
 
@@ -41,7 +42,9 @@
 #include "lsst/afw/detection/Psf.h"
 #include "lsst/afw/math/Kernel.h"
 #include "lsst/afw/math/SpatialCell.h"
+#include "lsst/afw/geom/Box.h"
 #include "lsst/afw/geom/Extent.h"
+#include "lsst/meas/algorithms/OversampledPcaPsf.h"
 
 namespace lsst {
 namespace meas {
@@ -60,6 +63,22 @@ createKernelFromPsfCandidates(lsst::afw::math::SpatialCellSet const& psfCells,
                               int const border=3
                              );
 
+template<typename PixelT>
+std::pair<PTR(OversampledPcaPsf), std::vector<double> >
+createOversampledPsfFromPsfCandidates(lsst::afw::math::SpatialCellSet const& psfCells,
+                                      lsst::afw::geom::Extent2I const& dims,
+                                      lsst::afw::geom::Point2I const& xy0,
+                                      int const nEigenComponents,
+                                      int const spatialOrder,
+                                      int const ksize,
+                                      int const oversampling,
+                                      int const nStarPerCell=-1,
+                                      bool const constantWeight=true,
+                                      int const border=3,
+                                      lsst::afw::geom::Point2D const& averagePosition=
+                                          lsst::afw::geom::Point2D()
+                                     );
+
 template<typename PixelT>
 int countPsfCandidates(lsst::afw::math::SpatialCellSet const& psfCells, int const nStarPerCell=-1);
     
@@ -79,6 +98,38 @@ fitSpatialKernelFromPsfCandidates(lsst::afw::math::Kernel *kernel,
                                   double const tolerance = 1e-5, 
                                   double const lambda = 0.0);
    
+/**
+ * @brief The result of fitPsfsFromPsfCandidates for one exposure
+ */
+struct PsfFitResult {
+    PsfFitResult() : kernel(), eigenValues(), nEigenComponents(0), nCandidates(0), spatialFitStatus(false),
+                     spatialFitChi2(0.0), warnings(), error() {}
+
+    lsst::afw::math::LinearCombinationKernel::Ptr kernel; ///< the spatially-fit kernel; null on failure
+    std::vector<double> eigenValues;    ///< the PCA's eigenvalues, as from createKernelFromPsfCandidates
+    int nEigenComponents;               ///< number of eigen components actually used
+    int nCandidates;                    ///< countPsfCandidates(psfCells, nStarPerCell) after the PCA
+    bool spatialFitStatus;              ///< status returned by fitSpatialKernelFromPsfCandidates
+    double spatialFitChi2;              ///< chi^2 returned by fitSpatialKernelFromPsfCandidates
+    std::vector<std::string> warnings;  ///< why the number of eigen components was reduced, if it was
+    std::string error;                  ///< why no kernel could be fit; empty on success
+};
+
+template<typename PixelT>
+std::vector<PsfFitResult>
+fitPsfsFromPsfCandidates(std::vector<PTR(lsst::afw::math::SpatialCellSet)> const& psfCellSets,
+                         std::vector<lsst::afw::geom::Box2I> const& bboxes,
+                         std::vector<int> const& nEigenComponents,
+                         std::vector<int> const& ksizes,
+                         int const spatialOrder,
+                         int const nStarPerCell=-1,
+                         bool const constantWeight=true,
+                         bool const doNonLinearFit=false,
+                         int const nStarPerCellSpatialFit=-1,
+                         double const tolerance=1e-5,
+                         double const lambda=0.0
+                        );
+
 template<typename ImageT>
 double subtractPsf(lsst::afw::detection::Psf const& psf, ImageT *data, double x, double y,
                    double psfFlux=std::numeric_limits<double>::quiet_NaN());
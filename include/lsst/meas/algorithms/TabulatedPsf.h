@@ -0,0 +1,133 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#ifndef LSST_MEAS_ALGORITHMS_TabulatedPsf_h_INCLUDED
+#define LSST_MEAS_ALGORITHMS_TabulatedPsf_h_INCLUDED
+
+#include <vector>
+
+#include "lsst/afw/geom/Box.h"
+#include "lsst/meas/algorithms/ImagePsf.h"
+
+namespace lsst { namespace meas { namespace algorithms {
+
+/**
+ *  @brief A Psf that interpolates between images of another Psf computed on a grid of positions
+ *
+ *  The bounding box is divided into gridDimensions cells, and the kernel image of the Psf is computed
+ *  at the centre of each (a "node").  The kernel image at any other position is the bilinear
+ *  interpolation of those at the four nearest nodes (positions beyond the outermost nodes use the
+ *  nearest of them); images at sub-pixel positions are made from it as usual by ImagePsf.
+ *
+ *  Evaluating a TabulatedPsf is cheap whatever the cost of the Psf it was made from (e.g. a CoaddPsf),
+ *  and it is always persistable: the node images are stored in a single record, in single precision.
+ *  The node images all have the same bounding box, the union of those of the Psf's kernel images.
+ */
+class TabulatedPsf : public afw::table::io::PersistableFacade<TabulatedPsf>, public ImagePsf {
+public:
+
+    /**
+     *  @brief Tabulate a Psf
+     *
+     *  @param[in] psf             Psf to tabulate
+     *  @param[in] bbox            Region over which to tabulate it, usually the image's bounding box
+     *  @param[in] gridDimensions  Number of nodes in each dimension
+     *  @param[in] color           Color at which to evaluate the Psf; the TabulatedPsf ignores colors
+     *
+     *  @throw lsst::pex::exceptions::InvalidParameterError if bbox is empty or gridDimensions < 1
+     */
+    TabulatedPsf(
+        afw::detection::Psf const & psf,
+        afw::geom::Box2I const & bbox,
+        afw::geom::Extent2I const & gridDimensions,
+        afw::image::Color const & color=afw::image::Color()
+    );
+
+    /**
+     *  @brief Construct a TabulatedPsf from its node images
+     *
+     *  @param[in] images          Kernel images at the nodes, in row-major order (x varying fastest);
+     *                             all must have the same bounding box
+     *  @param[in] bbox            Region over which the Psf was tabulated
+     *  @param[in] gridDimensions  Number of nodes in each dimension
+     *  @param[in] averagePosition Average position of stars used to construct the Psf
+     *
+     *  @throw lsst::pex::exceptions::InvalidParameterError if the arguments are inconsistent
+     */
+    TabulatedPsf(
+        std::vector<PTR(Image)> const & images,
+        afw::geom::Box2I const & bbox,
+        afw::geom::Extent2I const & gridDimensions,
+        afw::geom::Point2D const & averagePosition=afw::geom::Point2D()
+    );
+
+    /// Polymorphic deep copy
+    virtual PTR(afw::detection::Psf) clone() const;
+
+    /// Return the region over which the Psf was tabulated
+    afw::geom::Box2I getBBox() const { return _bbox; }
+
+    /// Return the number of nodes in each dimension
+    afw::geom::Extent2I getGridDimensions() const { return _gridDimensions; }
+
+    /// Return the position of node (ix, iy)
+    afw::geom::Point2D getNodePosition(int ix, int iy) const;
+
+    /// Return the kernel image at node (ix, iy)
+    PTR(Image const) getNodeImage(int ix, int iy) const;
+
+    /// Return average position of stars; used as default position.
+    virtual afw::geom::Point2D getAveragePosition() const { return _averagePosition; }
+
+    /// Whether this object is persistable; always true.
+    virtual bool isPersistable() const { return true; }
+
+protected:
+
+    virtual std::string getPersistenceName() const;
+
+    virtual std::string getPythonModule() const;
+
+    virtual void write(OutputArchiveHandle & handle) const;
+
+private:
+
+    virtual PTR(Image) doComputeKernelImage(
+        afw::geom::Point2D const & position,
+        afw::image::Color const & color
+    ) const;
+
+    // Return the index of the node at (ix, iy)
+    int _index(int ix, int iy) const;
+
+    std::vector<PTR(Image)> _images;
+    afw::geom::Box2I _bbox;
+    afw::geom::Extent2I _gridDimensions;
+    afw::geom::Point2D _averagePosition;
+};
+
+}}} // namespace lsst::meas::algorithms
+
+#endif // !LSST_MEAS_ALGORITHMS_TabulatedPsf_h_INCLUDED
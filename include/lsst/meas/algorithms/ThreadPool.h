@@ -0,0 +1,97 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#if !defined(LSST_MEAS_ALGORITHMS_THREADPOOL_H)
+#define LSST_MEAS_ALGORITHMS_THREADPOOL_H
+
+/**
+ * @file
+ *
+ * @brief A process-wide pool of threads shared by the parallel loops of meas_algorithms
+ *
+ * All parallel code in this package submits its work through parallelFor(), so the number of
+ * threads used is set in one place: by setNumThreads() (e.g. from ThreadPoolConfig in Python)
+ * or, initially, by the environment variable MEAS_ALGORITHMS_NUM_THREADS.  The default is one
+ * thread, i.e. serial execution in the calling thread, as most pipelines already run one
+ * process per core.
+ *
+ * A loop is split into chunks whose boundaries depend only on the loop length and grain size,
+ * never on the number of threads, so code that writes each chunk's results to its own storage
+ * and combines them in chunk order gives bit-identical results for any number of threads.
+ *
+ * @ingroup algorithms
+ */
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+
+/// Return the number of threads used by parallelFor(); 1 means serial execution
+int getNumThreads();
+
+/**
+ * @brief Set the number of threads used by parallelFor()
+ *
+ * @param[in] numThreads  number of threads, including the calling thread; 1 for serial
+ *                        execution, 0 for one thread per online processor
+ *
+ * @throw lsst::pex::exceptions::InvalidParameterError if numThreads < 0
+ */
+void setNumThreads(int numThreads);
+
+/// Is the calling thread executing a chunk of a parallelFor()?
+bool isInParallelRegion();
+
+/// A loop body for parallelFor()
+class ParallelTask {
+public:
+    virtual ~ParallelTask() {}
+
+    /// Process iterations [begin, end)
+    virtual void operator()(int begin, int end) = 0;
+};
+
+/**
+ * @brief Call task(begin, end) for consecutive chunks of [0, n), each of at most grainSize iterations
+ *
+ * Chunks are run concurrently, in no particular order, by the pool's worker threads and the
+ * calling thread, which returns once all chunks are done.  In serial mode, and when called from
+ * within a chunk (nested parallelism) or while another thread's loop occupies the pool, chunks
+ * are run in order in the calling thread.
+ *
+ * If a chunk throws, the remaining chunks are skipped.  In serial execution the exception
+ * propagates unchanged; otherwise it is rethrown as an lsst::pex::exceptions::RuntimeError
+ * carrying the original message.
+ *
+ * @param[in] n  number of iterations
+ * @param[in,out] task  loop body; must be safe to call concurrently on disjoint ranges
+ * @param[in] grainSize  maximum number of iterations per chunk
+ *
+ * @throw lsst::pex::exceptions::InvalidParameterError if grainSize < 1
+ */
+void parallelFor(int n, ParallelTask & task, int grainSize=1);
+
+}}} // namespace lsst::meas::algorithms
+
+#endif // !LSST_MEAS_ALGORITHMS_THREADPOOL_H
@@ -45,6 +45,10 @@ namespace lsst { namespace meas { namespace algorithms {
  * PSF is computed.  The definition (*) does not include the Jacobian of the
  * transformation, since the afw convention is that PSF's are normalized to
  * have integral 1 anyway.
+ *
+ * If the unwarped PSF is spatially constant (a KernelPsf whose Kernel is not spatially varying, or
+ * whose spatial functions are all polynomials of order 0) its image is computed once, on construction,
+ * and only warped thereafter.
  */
 class WarpedPsf : public ImagePsf {
 public:
@@ -77,6 +81,9 @@ public:
     /// Polymorphic deep copy.  Usually unnecessary, as Psfs are immutable.
     virtual PTR(afw::detection::Psf) clone() const;
 
+    /// Is the unwarped PSF spatially constant, so that its image is computed only once?
+    bool isUndistortedPsfConstant() const { return static_cast<bool>(_undistortedImage); }
+
 protected:
 
     virtual PTR(afw::detection::Psf::Image) doComputeKernelImage(
@@ -90,6 +97,7 @@ protected:
 private:
     void _init();
     CONST_PTR(afw::math::WarpingControl) _warpingControl;
+    PTR(afw::detection::Psf::Image) _undistortedImage; // image of the unwarped PSF, if constant; else null
 };
 
 }}} // namespace lsst::meas::algorithms
@@ -25,9 +25,14 @@ from .defects import *
 from .psfDeterminerRegistry import *
 from .starSelectorRegistry import *
 from .findCosmicRaysConfig import *
+from .threadPoolConfig import *
 from .detection import *
 from .gaussianPsfFactory import *
 from .loadReferenceObjects import *
+from .htmIndexer import *
+from .shardedReferenceCatalog import *
+from .loadShardedReferenceObjects import *
+from .ingestShardedReferenceCatalog import *
 from . import objectSizeStarSelector  # don't need names, just registration
 from .makeCoaddApCorrMap import *
 
@@ -115,6 +115,42 @@ namespace lsst { namespace meas { namespace algorithms { namespace interp {} nam
 
 /************************************************************************************************************/
 
+%include "lsst/meas/algorithms/MaskedImageAccumulator.h"
+%template(MaskedImageAccumulatorF) lsst::meas::algorithms::MaskedImageAccumulator<float>;
+%template(MaskedImageAccumulatorD) lsst::meas::algorithms::MaskedImageAccumulator<double>;
+
+%include "lsst/meas/algorithms/DetectionMask.h"
+%template(setMaskFromGrownFootprints)
+    lsst::meas::algorithms::setMaskFromGrownFootprints<lsst::afw::image::MaskPixel>;
+%template(setMaskOutsideBox) lsst::meas::algorithms::setMaskOutsideBox<lsst::afw::image::MaskPixel>;
+
+/************************************************************************************************************/
+// Only the functions controlling instrumentation are wrapped; the probes are C++-only
+
+namespace lsst { namespace meas { namespace algorithms {
+bool isInstrumentationEnabled();
+void setInstrumentationEnabled(bool enabled);
+void resetInstrumentation();
+void collectInstrumentation(lsst::daf::base::PropertySet & metadata, std::string const & prefix="",
+                            bool reset=false);
+class InstrumentationSnapshot {
+public:
+    InstrumentationSnapshot();
+    void collect(lsst::daf::base::PropertySet & metadata, std::string const & prefix="",
+                 std::string const & probePrefix="") const;
+};
+}}}
+
+/************************************************************************************************************/
+// Only the thread pool's size is controllable from Python; ParallelTask is C++-only
+
+namespace lsst { namespace meas { namespace algorithms {
+int getNumThreads();
+void setNumThreads(int numThreads);
+}}}
+
+/************************************************************************************************************/
+
 %define %Exposure(PIXTYPE)
     lsst::afw::image::Exposure<PIXTYPE, lsst::afw::image::MaskPixel, lsst::afw::image::VariancePixel>
 %enddef
@@ -145,13 +181,26 @@ namespace lsst { namespace meas { namespace algorithms { namespace interp {} nam
                                   lsst::afw::image::MaskedImage<PIXTYPE,
                                                                 lsst::afw::image::MaskPixel,
                                                                 lsst::afw::image::VariancePixel> >;
+    %template(findCosmicRaysMaskOnly) lsst::meas::algorithms::findCosmicRaysMaskOnly<
+                                          lsst::afw::image::MaskedImage<PIXTYPE,
+                                                                        lsst::afw::image::MaskPixel,
+                                                                        lsst::afw::image::VariancePixel> >;
+    %template(findCosmicRaysInSnaps) lsst::meas::algorithms::findCosmicRaysInSnaps<
+                                         lsst::afw::image::MaskedImage<PIXTYPE,
+                                                                       lsst::afw::image::MaskPixel,
+                                                                       lsst::afw::image::VariancePixel> >;
     %template(interpolateOverDefects) lsst::meas::algorithms::interpolateOverDefects<
                                           lsst::afw::image::MaskedImage<PIXTYPE,
                                                                         lsst::afw::image::MaskPixel,
                                                                         lsst::afw::image::VariancePixel> >;
 %enddef
 
+%template(FootprintListPair) std::pair<std::vector<PTR(lsst::afw::detection::Footprint)>,
+                                      std::vector<PTR(lsst::afw::detection::Footprint)> >;
+
 %instantiate_templates(F, float)
+%instantiate_templates(U, boost::uint16_t)
+%instantiate_templates(I, int)
 
 %template(DefectListT) std::vector<lsst::meas::algorithms::Defect::Ptr>;
 
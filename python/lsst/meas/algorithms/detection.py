@@ -31,6 +31,7 @@ import lsst.afw.table as afwTable
 import lsst.pex.config as pexConfig
 import lsst.pex.logging as pexLogging
 import lsst.pipe.base as pipeBase
+from . import algorithmsLib
 
 __all__ = ("SourceDetectionConfig", "SourceDetectionTask", "getBackground",
            "estimateBackground", "BackgroundConfig", "addExposures")
@@ -446,21 +447,32 @@ into your debug.py file and run measAlgTasks.py with the \c --debug flag.
         if self.config.reEstimateBackground or self.config.thresholdPolarity != "positive":
             fpSets.negative = self.thresholdImage(middle, "negative")
 
+        nGrow = 0
+        if self.config.nSigmaToGrow > 0:
+            nGrow = int((self.config.nSigmaToGrow * sigma) + 0.5)
+            self.metadata.set("nGrow", nGrow)
+        mask = maskedImage.getMask()
         for polarity, maskName in (("positive", "DETECTED"), ("negative", "DETECTED_NEGATIVE")):
             fpSet = getattr(fpSets, polarity)
             if fpSet is None:
                 continue
             fpSet.setRegion(region)
-            if self.config.nSigmaToGrow > 0:
-                nGrow = int((self.config.nSigmaToGrow * sigma) + 0.5)
-                self.metadata.set("nGrow", nGrow)
+            # Only build the grown FootprintSet if it is to be returned; otherwise set the mask
+            # bits for the grown footprints directly
+            returnGrown = not self.config.returnOriginalFootprints and \
+                (polarity == "positive" or self.config.thresholdPolarity != "positive")
+            if returnGrown and nGrow > 0:
                 fpSet = afwDet.FootprintSet(fpSet, nGrow, self.config.isotropicGrow)
-            fpSet.setMask(maskedImage.getMask(), maskName)
-            if not self.config.returnOriginalFootprints:
+                fpSet.setMask(mask, maskName)
                 setattr(fpSets, polarity, fpSet)
+            else:
+                algorithmsLib.setMaskFromGrownFootprints(mask, fpSet, nGrow, self.config.isotropicGrow,
+                                                         mask.getPlaneBitMask(maskName))
+        del mask
 
         fpSets.numPos = len(fpSets.positive.getFootprints()) if fpSets.positive is not None else 0
-        fpSets.numNeg = len(fpSets.negative.getFootprints()) if fpSets.negative is not None else 0
+        fpSets.numNeg = len(fpSets.negative.getFootprints()) \
+            if fpSets.negative is not None and self.config.thresholdPolarity != "positive" else 0
 
         if self.config.thresholdPolarity != "negative":
             self.log.log(self.log.INFO, "Detected %d positive sources to %g sigma." %
@@ -544,24 +556,15 @@ into your debug.py file and run measAlgTasks.py with the \c --debug flag.
         """!Set the edgeBitmask bits for all of maskedImage outside goodBBox
 
         \param[in,out] maskedImage  image on which to set edge bits in the mask
-        \param[in] goodBBox  bounding box of good pixels, in LOCAL coordinates
+        \param[in] goodBBox  bounding box of good pixels, in PARENT coordinates
         \param[in] edgeBitmask  bit mask to OR with the existing mask bits in the region outside goodBBox
         """
-        msk = maskedImage.getMask()
-
-        mx0, my0 = maskedImage.getXY0()
-        for x0, y0, w, h in ([0, 0,
-                              msk.getWidth(), goodBBox.getBeginY() - my0],
-                             [0, goodBBox.getEndY() - my0, msk.getWidth(),
-                              maskedImage.getHeight() - (goodBBox.getEndY() - my0)],
-                             [0, 0,
-                              goodBBox.getBeginX() - mx0, msk.getHeight()],
-                             [goodBBox.getEndX() - mx0, 0,
-                              maskedImage.getWidth() - (goodBBox.getEndX() - mx0), msk.getHeight()],
-                             ):
-            edgeMask = msk.Factory(msk, afwGeom.BoxI(afwGeom.PointI(x0, y0),
-                                                     afwGeom.ExtentI(w, h)), afwImage.LOCAL)
-            edgeMask |= edgeBitmask
+        algorithmsLib.setMaskOutsideBox(maskedImage.getMask(), goodBBox, edgeBitmask)
+
+_accumulatorClasses = {
+    afwImage.MaskedImageF: algorithmsLib.MaskedImageAccumulatorF,
+    afwImage.MaskedImageD: algorithmsLib.MaskedImageAccumulatorD,
+}
 
 def addExposures(exposureList):
     """!Add a set of exposures together.
@@ -577,12 +580,17 @@ def addExposures(exposureList):
     exposure0 = exposureList[0]
     image0 = exposure0.getMaskedImage()
 
-    addedImage = image0.Factory(image0, True)
-    addedImage.setXY0(image0.getXY0())
-
-    for exposure in exposureList[1:]:
-        image = exposure.getMaskedImage()
-        addedImage += image
+    accumulatorClass = _accumulatorClasses.get(type(image0))
+    if accumulatorClass is None:
+        addedImage = image0.Factory(image0, True)
+        addedImage.setXY0(image0.getXY0())
+        for exposure in exposureList[1:]:
+            addedImage += exposure.getMaskedImage()
+    else:
+        accumulator = accumulatorClass(image0.getDimensions(), image0.getXY0())
+        for exposure in exposureList:
+            accumulator.add(exposure.getMaskedImage())
+        addedImage = accumulator.getResult()
 
     addedExposure = exposure0.Factory(addedImage, exposure0.getWcs())
     return addedExposure
@@ -0,0 +1,176 @@
+from __future__ import absolute_import, division, print_function
+#
+# LSST Data Management System
+#
+# Copyright 2008-2016 AURA/LSST.
+#
+# This product includes software developed by the
+# LSST Project (http://www.lsst.org/).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the LSST License Statement and
+# the GNU General Public License along with this program.  If not,
+# see <https://www.lsstcorp.org/LegalNotices/>.
+#
+import numpy
+
+__all__ = ["HtmIndexer", "raDecToVector"]
+
+def raDecToVector(ra, dec):
+    """!Convert ICRS RA, Dec (radians) to unit vectors
+
+    @param[in] ra  right ascension (radians); a scalar or numpy array
+    @param[in] dec  declination (radians); a scalar or numpy array of the same shape as ra
+    @return an array of shape (N, 3) of unit vectors
+    """
+    ra = numpy.atleast_1d(numpy.asarray(ra, dtype=numpy.float64))
+    dec = numpy.atleast_1d(numpy.asarray(dec, dtype=numpy.float64))
+    cosDec = numpy.cos(dec)
+    return numpy.column_stack((cosDec*numpy.cos(ra), cosDec*numpy.sin(ra), numpy.sin(dec)))
+
+def _normalize(v):
+    return v/numpy.sqrt((v*v).sum(axis=-1))[..., numpy.newaxis]
+
+# The eight root trixels of the Hierarchical Triangular Mesh (Kunszt, Szalay & Thakar 2001),
+# with vertices in counter-clockwise order as seen from outside the sphere; IDs are 8-15.
+_V = numpy.array([[0.0, 0.0, 1.0], [1.0, 0.0, 0.0], [0.0, 1.0, 0.0],
+                  [-1.0, 0.0, 0.0], [0.0, -1.0, 0.0], [0.0, 0.0, -1.0]])
+_ROOT_TRIXELS = numpy.array([
+    [_V[1], _V[5], _V[2]],              # S0
+    [_V[2], _V[5], _V[3]],              # S1
+    [_V[3], _V[5], _V[4]],              # S2
+    [_V[4], _V[5], _V[1]],              # S3
+    [_V[1], _V[0], _V[4]],              # N0
+    [_V[4], _V[0], _V[3]],              # N1
+    [_V[3], _V[0], _V[2]],              # N2
+    [_V[2], _V[0], _V[1]],              # N3
+])
+
+def _children(tri):
+    """!Return the four children of trixels with vertices tri (shape (..., 3, 3)), in HTM ID order"""
+    v0, v1, v2 = tri[..., 0, :], tri[..., 1, :], tri[..., 2, :]
+    w0 = _normalize(v1 + v2)
+    w1 = _normalize(v0 + v2)
+    w2 = _normalize(v0 + v1)
+    return [numpy.stack((a, b, c), axis=-2) for a, b, c in
+            ((v0, w2, w1), (v1, w0, w2), (v2, w1, w0), (w0, w1, w2))]
+
+def _contains(tri, vec):
+    """!Return a boolean array: is each vector in vec inside the corresponding trixel in tri?"""
+    v0, v1, v2 = tri[..., 0, :], tri[..., 1, :], tri[..., 2, :]
+    return ((numpy.cross(v0, v1)*vec).sum(axis=-1) >= 0) & \
+           ((numpy.cross(v1, v2)*vec).sum(axis=-1) >= 0) & \
+           ((numpy.cross(v2, v0)*vec).sum(axis=-1) >= 0)
+
+class HtmIndexer(object):
+    """!Index positions on the sky with a Hierarchical Triangular Mesh
+
+    Trixel IDs follow the usual HTM convention: the root trixels are numbered 8-15
+    and the children of trixel n are 4n, 4n + 1, 4n + 2 and 4n + 3.  Consequently all
+    the descendants of a trixel at a finer depth form a contiguous range of IDs, which
+    is what lets a sorted column of fine IDs act as a spatial index.
+    """
+    def __init__(self, depth):
+        """!Construct an indexer
+
+        @param[in] depth  depth of the mesh; there are 8*4**depth trixels
+        """
+        if depth < 0:
+            raise ValueError("HTM depth must be non-negative: %s" % (depth,))
+        self.depth = depth
+
+    def indexPoints(self, ra, dec):
+        """!Return the IDs of the trixels containing the given points
+
+        @param[in] ra  right ascension (radians); numpy array
+        @param[in] dec  declination (radians); numpy array
+        @return numpy array of int64 trixel IDs at this indexer's depth
+        """
+        vec = raDecToVector(ra, dec)
+        ids = numpy.zeros(len(vec), dtype=numpy.int64)
+        tri = numpy.empty((len(vec), 3, 3))
+        found = numpy.zeros(len(vec), dtype=bool)
+        for i, root in enumerate(_ROOT_TRIXELS):
+            inRoot = ~found & _contains(root, vec)
+            ids[inRoot] = 8 + i
+            tri[inRoot] = root
+            found |= inRoot
+        if not found.all():
+            raise RuntimeError("Failed to find the root trixel of %d points" % (numpy.sum(~found),))
+
+        for level in range(self.depth):
+            children = _children(tri)
+            child = numpy.full(len(vec), 3, dtype=numpy.int64)
+            for k in (2, 1, 0):         # the first child containing a point wins
+                child[_contains(children[k], vec)] = k
+            ids = 4*ids + child
+            for k in range(4):
+                isChild = child == k
+                tri[isChild] = children[k][isChild]
+        return ids
+
+    def getShardIds(self, ids, shardDepth):
+        """!Return the IDs of the ancestors at depth shardDepth of the given trixel IDs
+
+        @param[in] ids  trixel IDs at this indexer's depth
+        @param[in] shardDepth  depth of the ancestors; must not exceed this indexer's depth
+        """
+        if shardDepth > self.depth:
+            raise ValueError("shardDepth=%s exceeds indexer depth=%s" % (shardDepth, self.depth))
+        return numpy.right_shift(ids, 2*(self.depth - shardDepth))
+
+    def getIntersectingRanges(self, ctrRa, ctrDec, radius):
+        """!Return the trixels that may intersect a circle on the sky
+
+        The result is conservative: every trixel that intersects the circle is included,
+        but so may be a few that lie just outside it.
+
+        @param[in] ctrRa  right ascension of the centre of the circle (radians)
+        @param[in] ctrDec  declination of the centre of the circle (radians)
+        @param[in] radius  radius of the circle (radians)
+        @return a list of (begin, end) half-open ranges of trixel IDs at this indexer's depth,
+            sorted and non-overlapping
+        """
+        ctr = raDecToVector(ctrRa, ctrDec)[0]
+        cosRadius = numpy.cos(min(radius, numpy.pi))
+        ranges = []
+        ids = numpy.arange(8, 16, dtype=numpy.int64)
+        tri = _ROOT_TRIXELS.copy()
+        for level in range(self.depth + 1):
+            # bounding circle of each trixel, centred on its normalised centroid
+            centre = _normalize(tri.sum(axis=-2))
+            cosVertex = (tri*centre[:, numpy.newaxis, :]).sum(axis=-1).min(axis=-1)
+            bound = numpy.arccos(numpy.clip(cosVertex, -1.0, 1.0))
+            sep = numpy.arccos(numpy.clip(centre.dot(ctr), -1.0, 1.0))
+            overlaps = sep <= radius + bound
+            inside = ((tri*ctr).sum(axis=-1) >= cosRadius).all(axis=-1) & (radius < 0.5*numpy.pi)
+
+            shift = 2*(self.depth - level)
+            done = overlaps & (inside | (level == self.depth))
+            for i in ids[done]:
+                ranges.append((int(i) << shift, (int(i) + 1) << shift))
+
+            partial = overlaps & ~done
+            if not partial.any():
+                break
+            children = _children(tri[partial])
+            ids = numpy.concatenate([4*ids[partial] + k for k in range(4)])
+            tri = numpy.concatenate(children)
+
+        ranges.sort()
+        merged = []
+        for begin, end in ranges:
+            if merged and merged[-1][1] == begin:
+                merged[-1] = (merged[-1][0], end)
+            else:
+                merged.append((begin, end))
+        return merged
@@ -0,0 +1,165 @@
+from __future__ import absolute_import, division, print_function
+#
+# LSST Data Management System
+#
+# Copyright 2008-2016 AURA/LSST.
+#
+# This product includes software developed by the
+# LSST Project (http://www.lsst.org/).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the LSST License Statement and
+# the GNU General Public License along with this program.  If not,
+# see <https://www.lsstcorp.org/LegalNotices/>.
+#
+import os
+
+import numpy
+
+import lsst.afw.table as afwTable
+import lsst.pex.config as pexConfig
+import lsst.pipe.base as pipeBase
+from .htmIndexer import HtmIndexer
+from .shardedReferenceCatalog import ShardedReferenceCatalog, ShardedReferenceCatalogDescription
+
+__all__ = ["IngestShardedReferenceCatalogConfig", "IngestShardedReferenceCatalogTask"]
+
+class IngestShardedReferenceCatalogConfig(pexConfig.Config):
+    """!Config for IngestShardedReferenceCatalogTask"""
+    description = pexConfig.ConfigField(
+        doc = "sharding parameters of the output catalog",
+        dtype = ShardedReferenceCatalogDescription,
+    )
+
+class IngestShardedReferenceCatalogTask(pipeBase.Task):
+    """!Build a sharded reference catalog from FITS reference catalogs
+
+    @anchor IngestShardedReferenceCatalogTask_
+
+    @section meas_algorithms_ingestShardedReferenceCatalog_Purpose  Description
+
+    Read one or more FITS files, each an lsst.afw.table.SimpleCatalog with the standard reference
+    object schema (see LoadReferenceObjectsTask), and write them as a sharded reference catalog
+    that can be read by LoadShardedReferenceObjectsTask.  All input files must share a schema.
+
+    Scalar numeric, Angle and Flag fields are supported; other field types (strings, arrays)
+    are rejected.
+
+    @section meas_algorithms_ingestShardedReferenceCatalog_IO  Invoking the Task
+
+    @copydoc run
+    """
+    ConfigClass = IngestShardedReferenceCatalogConfig
+    _DefaultName = "ingestShardedReferenceCatalog"
+
+    @pipeBase.timeMethod
+    def run(self, inputFiles, outputDir):
+        """!Ingest FITS reference catalogs
+
+        @param[in] inputFiles  list of paths of FITS files containing SimpleCatalogs
+        @param[in] outputDir  directory to write the sharded catalog to; created if necessary
+
+        @return a lsst.pipe.base.Struct with:
+        - numObjects: number of objects ingested
+        - numShards: number of shards written
+        """
+        if not inputFiles:
+            raise pipeBase.TaskError("No input files")
+        description = ShardedReferenceCatalogDescription()
+        description.shardDepth = self.config.description.shardDepth
+        description.indexDepth = self.config.description.indexDepth
+        description.validate()
+        indexer = HtmIndexer(description.indexDepth)
+
+        schema = None
+        columnLists = {}
+        indexList = []
+        for inputFile in inputFiles:
+            cat = afwTable.SimpleCatalog.readFits(inputFile)
+            if schema is None:
+                schema = cat.schema
+                columnNames, flagNames = self._getColumnNames(schema)
+                columnLists = dict((name, []) for name in columnNames)
+            elif cat.schema != schema:
+                raise pipeBase.TaskError("Schema of %s differs from that of %s" % (inputFile, inputFiles[0]))
+            if not cat.isContiguous():
+                cat = cat.copy(deep=True)
+            self.log.info("Read %d objects from %s" % (len(cat), inputFile))
+
+            columnView = cat.getColumnView()
+            for name in columnNames:
+                key = schema[name].asKey()
+                if name in flagNames:
+                    values = numpy.array([rec.get(key) for rec in cat], dtype=bool)
+                else:
+                    values = numpy.array(columnView[key])
+                columnLists[name].append(values)
+            indexList.append(indexer.indexPoints(columnLists["coord_ra"][-1], columnLists["coord_dec"][-1]))
+
+        htmIndex = numpy.concatenate(indexList)
+        order = numpy.argsort(htmIndex, kind="mergesort")
+        htmIndex = htmIndex[order]
+        columns = dict((name, numpy.concatenate(values)[order]) for name, values in columnLists.iteritems())
+        del columnLists
+
+        idOrder = numpy.argsort(columns["id"], kind="mergesort")
+        sortedIds = columns["id"][idOrder]
+        if numpy.any(sortedIds[1:] == sortedIds[:-1]):
+            raise pipeBase.TaskError("Reference object IDs are not unique")
+
+        if not os.path.isdir(outputDir):
+            os.makedirs(outputDir)
+        catalog = ShardedReferenceCatalog(outputDir)
+        shards = indexer.getShardIds(htmIndex, description.shardDepth)
+        shardIds, begins, shardIndex = numpy.unique(shards, return_index=True, return_inverse=True)
+        ends = numpy.append(begins[1:], len(shards))
+        rows = numpy.arange(len(shards)) - begins[shardIndex]
+        for shardId, begin, end in zip(shardIds, begins, ends):
+            shardColumns = dict((name, values[begin:end]) for name, values in columns.iteritems())
+            shardColumns[catalog.IndexColumn] = htmIndex[begin:end]
+            catalog.writeShard(shardId, shardColumns)
+
+        description.columns = columnNames
+        description.flagColumns = sorted(flagNames)
+        catalog.writeDescription(description)
+        catalog.writeSchema(schema)
+        catalog.writeShardIds(shardIds)
+        catalog.writeIdIndex(sortedIds, shards[idOrder], rows[idOrder])
+        self.log.info("Wrote %d objects in %d shards to %s" % (len(htmIndex), len(shardIds), outputDir))
+
+        return pipeBase.Struct(
+            numObjects = len(htmIndex),
+            numShards = len(shardIds),
+        )
+
+    @staticmethod
+    def _getColumnNames(schema):
+        """!Return the names of the fields to store, and the subset of those that are flags
+
+        @throw lsst.pipe.base.TaskError if the schema has a field of an unsupported type
+            or lacks coord_ra, coord_dec or id
+        """
+        columnNames = []
+        flagNames = set()
+        for item in schema:
+            field = item.field
+            name = field.getName()
+            typeStr = field.getTypeString()
+            if typeStr == "Flag":
+                flagNames.add(name)
+            elif typeStr not in ("I", "L", "F", "D", "Angle"):
+                raise pipeBase.TaskError("Field %s has unsupported type %s" % (name, typeStr))
+            columnNames.append(name)
+        for name in ("id", "coord_ra", "coord_dec"):
+            if name not in columnNames:
+                raise pipeBase.TaskError("Schema has no field %s" % (name,))
+        return columnNames, flagNames
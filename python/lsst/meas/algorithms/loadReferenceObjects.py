@@ -22,6 +22,8 @@ from __future__ import absolute_import, division, print_function
 # see <https://www.lsstcorp.org/LegalNotices/>.
 #
 import abc
+import collections
+import threading
 
 import numpy
 
@@ -31,7 +33,8 @@ import lsst.afw.table as afwTable
 import lsst.pex.config as pexConfig
 import lsst.pipe.base as pipeBase
 
-__all__ = ["getRefFluxField", "getRefFluxKeys", "LoadReferenceObjectsTask", "LoadReferenceObjectsConfig"]
+__all__ = ["getRefFluxField", "getRefFluxKeys", "LoadReferenceObjectsTask", "LoadReferenceObjectsConfig",
+           "ReferenceObjectCache"]
 
 def getRefFluxField(schema, filterName=None):
     """!Get name of flux field in schema
@@ -80,6 +83,94 @@ def getRefFluxKeys(schema, filterName=None):
         fluxErrKey = None
     return (fluxKey, fluxErrKey)
 
+class ReferenceObjectCache(object):
+    """!A bounded, thread-safe, least-recently-used cache of reference object sky tiles
+
+    A single instance, returned by getInstance(), is shared by every LoadReferenceObjectsTask
+    in the process, so adjacent CCDs of a visit (and repeated visits of a field) reuse tiles
+    loaded for each other.  What a tile holds is up to the loader; it should not depend on
+    the filter, as flux aliases are applied by the loader to each assembled catalog.
+
+    Each loader asks for the budget in its config.tileCacheMB with reserveBytes, which only ever
+    grows the budget, so loaders with different configs cannot shrink or disable the cache for
+    each other.  An application may still set the budget outright with setMaxBytes().
+    """
+    _instance = None
+    _instanceLock = threading.Lock()
+
+    def __init__(self, maxBytes=0):
+        """!Construct a cache
+
+        @param[in] maxBytes  memory budget (bytes); 0 disables caching
+        """
+        self._lock = threading.Lock()
+        self._tiles = collections.OrderedDict() # key: (value, nbytes); most recently used last
+        self._maxBytes = maxBytes
+        self._nBytes = 0
+
+    @classmethod
+    def getInstance(cls):
+        """!Return the process-wide cache"""
+        with cls._instanceLock:
+            if cls._instance is None:
+                cls._instance = cls()
+            return cls._instance
+
+    def getMaxBytes(self):
+        return self._maxBytes
+
+    def setMaxBytes(self, maxBytes):
+        """!Set the memory budget (bytes), evicting tiles as needed; 0 disables caching"""
+        with self._lock:
+            self._maxBytes = maxBytes
+            self._evict()
+
+    def reserveBytes(self, maxBytes):
+        """!Grow the memory budget (bytes) to at least maxBytes; the budget is never reduced"""
+        with self._lock:
+            self._maxBytes = max(self._maxBytes, maxBytes)
+
+    def getNBytes(self):
+        """!Return the memory used by the cached tiles (bytes)"""
+        return self._nBytes
+
+    def __len__(self):
+        return len(self._tiles)
+
+    def clear(self):
+        with self._lock:
+            self._tiles.clear()
+            self._nBytes = 0
+
+    def get(self, key):
+        """!Return the tile with the given key, or None if it is not cached"""
+        with self._lock:
+            item = self._tiles.pop(key, None)
+            if item is None:
+                return None
+            self._tiles[key] = item
+            return item[0]
+
+    def put(self, key, value, nbytes):
+        """!Add a tile to the cache, evicting the least recently used tiles to stay within budget
+
+        Tiles larger than the whole budget are not cached.
+        """
+        with self._lock:
+            old = self._tiles.pop(key, None)
+            if old is not None:
+                self._nBytes -= old[1]
+            if nbytes > self._maxBytes:
+                return
+            self._tiles[key] = (value, nbytes)
+            self._nBytes += nbytes
+            self._evict()
+
+    def _evict(self):
+        while self._nBytes > self._maxBytes and self._tiles:
+            value, nbytes = self._tiles.popitem(last=False)[1]
+            self._nBytes -= nbytes
+
 class LoadReferenceObjectsConfig(pexConfig.Config):
     pixelMargin = pexConfig.RangeField(
         doc = "Padding to add to 4 all edges of the bounding box (pixels)",
@@ -100,6 +191,14 @@ class LoadReferenceObjectsConfig(pexConfig.Config):
         itemtype = str,
         default = {},
     )
+    tileCacheMB = pexConfig.RangeField(
+        doc = "Memory budget this loader asks of the process-wide reference object tile cache (MB); " + \
+            "the cache's budget is the largest asked for by any loader. 0 means this loader doesn't " + \
+            "use the cache. Only loaders that read the catalog in sky tiles use it.",
+        dtype = float,
+        default = 128.0,
+        min = 0.0,
+    )
 
 class LoadReferenceObjectsTask(pipeBase.Task):
     """!Abstract base class to load objects from reference catalogs
@@ -158,11 +257,27 @@ class LoadReferenceObjectsTask(pipeBase.Task):
 
     See @ref LoadReferenceObjectsConfig for a base set of configuration parameters.
     Most subclasses will add configuration variables.
+
+    @section meas_algorithms_loadReferenceObjects_Cache       Tile cache
+
+    Subclasses that read their catalog in sky tiles may fetch those tiles through _getCachedTile,
+    which consults the process-wide ReferenceObjectCache.  Each loader grows the cache's budget to at
+    least config.tileCacheMB when it is constructed (but never shrinks it); a loader with a tileCacheMB
+    of 0 doesn't use the cache (see isTileCacheEnabled).
+    The numbers of cache hits and misses are recorded in the task metadata as tileCacheHits and
+    tileCacheMisses, and the memory used by the cache as tileCacheBytes.
     """
     __metaclass__ = abc.ABCMeta
     ConfigClass = LoadReferenceObjectsConfig
     _DefaultName = "LoadReferenceObjects"
 
+    def __init__(self, *args, **kwargs):
+        pipeBase.Task.__init__(self, *args, **kwargs)
+        self.tileCache = ReferenceObjectCache.getInstance()
+        self.tileCache.reserveBytes(int(self.config.tileCacheMB*1024**2))
+        self._tileCacheHits = 0
+        self._tileCacheMisses = 0
+
     @pipeBase.timeMethod
     def loadPixelBox(self, bbox, wcs, filterName=None, calib=None):
         """!Load reference objects that overlap a pixel-based rectangular region
@@ -223,6 +338,32 @@ class LoadReferenceObjectsTask(pipeBase.Task):
         """
         return
 
+    def _getCachedTile(self, key, loadTile):
+        """!Return a sky tile, from the process-wide tile cache if possible
+
+        @param[in] key  hashable key identifying the tile uniquely across all catalogs
+            (e.g. a catalog path and tile ID); must not depend on the filter
+        @param[in] loadTile  callable taking no arguments that loads the tile on a cache miss;
+            it must return a dict of numpy arrays (whose total size is charged to the cache)
+
+        @return the tile
+        """
+        tile = self.tileCache.get(key)
+        if tile is not None:
+            self._tileCacheHits += 1
+        else:
+            self._tileCacheMisses += 1
+            tile = loadTile()
+            self.tileCache.put(key, tile, sum(values.nbytes for values in tile.itervalues()))
+        self.metadata.set("tileCacheHits", self._tileCacheHits)
+        self.metadata.set("tileCacheMisses", self._tileCacheMisses)
+        self.metadata.set("tileCacheBytes", self.tileCache.getNBytes())
+        return tile
+
+    def isTileCacheEnabled(self):
+        """!Does this loader use the process-wide tile cache?"""
+        return self.config.tileCacheMB > 0 and self.tileCache.getMaxBytes() > 0
+
     @staticmethod
     def _trimToBBox(refCat, bbox, wcs):
         """!Remove objects outside a given pixel-based bbox and set centroid and hasCentroid fields
@@ -341,6 +482,20 @@ class LoadReferenceObjectsTask(pipeBase.Task):
             )
         return schema
 
+    def loadObjectsById(self, idList, filterName=None):
+        """!Load reference objects by ID
+
+        This is an optional capability; the default implementation returns None, meaning that
+        the backend does not support lookup by ID.
+
+        @param[in] idList  sequence of reference object IDs
+        @param[in] filterName  name of filter, or None for the default filter
+
+        @return None if lookup by ID is unsupported, else an lsst.pipe.base.Struct as returned
+            by loadSkyCircle, whose refCat contains those of the requested objects that exist
+        """
+        return None
+
     def joinMatchListWithCatalog(self, matchCat, sourceCat):
         """!Relink an unpersisted match list to sources and reference objects
 
@@ -350,11 +505,15 @@ class LoadReferenceObjectsTask(pipeBase.Task):
         into a match list (an lsst.afw.table.ReferenceMatchVector) with links to source
         records and reference object records.
 
+        If the backend supports loadObjectsById only the reference objects named in the match
+        list are loaded; otherwise the sky circle recorded in the match metadata is loaded.
+        Records are then looked up in hash tables keyed on ID, so neither catalog is sorted.
+        Matches whose source or reference object cannot be found are dropped with a warning.
+
         @param[in]     matchCat   Unperisted packed match list (an lsst.afw.table.BaseCatalog).
                                   matchCat.table.getMetadata() must contain match metadata,
                                   as returned by the astrometry tasks.
-        @param[in,out] sourceCat  Source catalog (an lsst.afw.table.SourceCatalog).
-                                  As a side effect, the catalog will be sorted by ID.
+        @param[in]     sourceCat  Source catalog (an lsst.afw.table.SourceCatalog); not modified.
 
         @return the match list (an lsst.afw.table.ReferenceMatchVector)
         """
@@ -363,12 +522,33 @@ class LoadReferenceObjectsTask(pipeBase.Task):
         if version != 1:
             raise ValueError('SourceMatchVector version number is %i, not 1.' % version)
         filterName = matchmeta.getString('FILTER').strip()
-        ctrCoord = afwCoord.IcrsCoord(
-            matchmeta.getDouble('RA') * afwGeom.degrees,
-            matchmeta.getDouble('DEC') * afwGeom.degrees,
-        )
-        rad = matchmeta.getDouble('RADIUS') * afwGeom.degrees
-        refCat = self.loadSkyCircle(ctrCoord, rad, filterName).refCat
-        refCat.sort()
-        sourceCat.sort()
-        return afwTable.unpackMatches(matchCat, refCat, sourceCat)
+
+        refIdKey = matchCat.schema["first"].asKey()
+        srcIdKey = matchCat.schema["second"].asKey()
+        distanceKey = matchCat.schema["distance"].asKey()
+        refIdList = [rec.get(refIdKey) for rec in matchCat]
+
+        loadRes = self.loadObjectsById(sorted(set(refIdList)), filterName)
+        if loadRes is None:
+            ctrCoord = afwCoord.IcrsCoord(
+                matchmeta.getDouble('RA') * afwGeom.degrees,
+                matchmeta.getDouble('DEC') * afwGeom.degrees,
+            )
+            rad = matchmeta.getDouble('RADIUS') * afwGeom.degrees
+            loadRes = self.loadSkyCircle(ctrCoord, rad, filterName)
+        refById = dict((refObj.getId(), refObj) for refObj in loadRes.refCat)
+        srcById = dict((src.getId(), src) for src in sourceCat)
+
+        matches = afwTable.ReferenceMatchVector()
+        numMissing = 0
+        for refId, rec in zip(refIdList, matchCat):
+            refObj = refById.get(refId)
+            src = srcById.get(rec.get(srcIdKey))
+            if refObj is None or src is None:
+                numMissing += 1
+                continue
+            matches.append(afwTable.ReferenceMatch(refObj, src, rec.get(distanceKey)))
+        if numMissing > 0:
+            self.log.warn("Dropped %d of %d matches whose source or reference object was not found" %
+                          (numMissing, len(matchCat)))
+        return matches
@@ -0,0 +1,244 @@
+from __future__ import absolute_import, division, print_function
+#
+# LSST Data Management System
+#
+# Copyright 2008-2016 AURA/LSST.
+#
+# This product includes software developed by the
+# LSST Project (http://www.lsst.org/).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the LSST License Statement and
+# the GNU General Public License along with this program.  If not,
+# see <https://www.lsstcorp.org/LegalNotices/>.
+#
+import os
+
+import numpy
+
+import lsst.pex.config as pexConfig
+import lsst.pipe.base as pipeBase
+import lsst.afw.table as afwTable
+from .htmIndexer import HtmIndexer, raDecToVector
+from .loadReferenceObjects import LoadReferenceObjectsConfig, LoadReferenceObjectsTask, getRefFluxField
+from .shardedReferenceCatalog import ShardedReferenceCatalog
+
+__all__ = ["LoadShardedReferenceObjectsConfig", "LoadShardedReferenceObjectsTask"]
+
+class LoadShardedReferenceObjectsConfig(LoadReferenceObjectsConfig):
+    """!Config for LoadShardedReferenceObjectsTask"""
+    catalogDir = pexConfig.Field(
+        doc = "directory containing the sharded reference catalog (see IngestShardedReferenceCatalogTask)",
+        dtype = str,
+        default = None,
+    )
+
+class LoadShardedReferenceObjectsTask(LoadReferenceObjectsTask):
+    """!Load reference objects from a local sharded reference catalog
+
+    @anchor LoadShardedReferenceObjectsTask_
+
+    @section meas_algorithms_loadShardedReferenceObjects_Purpose  Description
+
+    Load reference objects from a catalog written by IngestShardedReferenceCatalogTask.
+    The catalog is split into shards, each an HTM trixel, and each shard stores its columns
+    as memory-mapped arrays sorted by a finer HTM index.  A query for a circle on the sky
+    therefore reads only the overlapping shards and, within them, only the rows in trixels
+    that may overlap the circle; the remaining columns are gathered only for the rows that
+    pass the exact angular-separation test.
+
+    If the tile cache is enabled (config.tileCacheMB > 0) whole shards are read into memory
+    and kept in the process-wide ReferenceObjectCache, keyed on catalog directory and shard ID,
+    and circle queries are assembled from the cached shards.  Cached shards hold the raw columns,
+    so one cached shard serves queries for any filter.  Set config.tileCacheMB to 0 to only
+    memory-map the shards, e.g. if each shard is queried just once.
+
+    @section meas_algorithms_loadShardedReferenceObjects_Config  Configuration parameters
+
+    See @ref LoadShardedReferenceObjectsConfig
+    """
+    ConfigClass = LoadShardedReferenceObjectsConfig
+    _DefaultName = "LoadShardedReferenceObjects"
+
+    def __init__(self, *args, **kwargs):
+        LoadReferenceObjectsTask.__init__(self, *args, **kwargs)
+        self.catalog = ShardedReferenceCatalog(self.config.catalogDir)
+        self.description = self.catalog.readDescription()
+        self.schema = self.catalog.makeEmptyCatalog().schema
+        self.indexer = HtmIndexer(self.description.indexDepth)
+        self.shardIds = self.catalog.readShardIds()
+
+    @pipeBase.timeMethod
+    def loadSkyCircle(self, ctrCoord, radius, filterName=None):
+        """!Load reference objects that overlap a circular sky region
+
+        @param[in] ctrCoord  center of search region (an lsst.afw.geom.Coord)
+        @param[in] radius  radius of search region (an lsst.afw.geom.Angle)
+        @param[in] filterName  name of filter, or None for the default filter
+
+        @return an lsst.pipe.base.Struct containing:
+        - refCat a catalog of reference objects with the standard schema; hasCentroid is False
+        - fluxField = name of flux field for specified filterName
+        """
+        icrsCoord = ctrCoord.toIcrs()
+        ctrRa = icrsCoord.getRa().asRadians()
+        ctrDec = icrsCoord.getDec().asRadians()
+        ctrVec = raDecToVector(ctrRa, ctrDec)[0]
+        cosRadius = numpy.cos(radius.asRadians())
+
+        ranges = self.indexer.getIntersectingRanges(ctrRa, ctrDec, radius.asRadians())
+        pieces = dict((name, []) for name in self.description.columns)
+        numShards = 0
+        for shardId, shardRanges in self._groupRangesByShard(ranges):
+            shard = self._getShard(shardId)
+            rows = self._getRows(shard[self.catalog.IndexColumn], shardRanges)
+            if len(rows) == 0:
+                continue
+            numShards += 1
+            ra = shard["coord_ra"][rows]
+            dec = shard["coord_dec"][rows]
+            rows = rows[raDecToVector(ra, dec).dot(ctrVec) >= cosRadius]
+            for name, values in pieces.iteritems():
+                values.append(shard[name][rows])
+        self.log.logdebug("read %d of %d shards" % (numShards, len(self.shardIds)))
+
+        refCat = self._makeCatalog(pieces)
+        self._addFluxAliases(refCat.schema)
+        fluxField = getRefFluxField(schema=refCat.schema, filterName=filterName)
+        return pipeBase.Struct(
+            refCat = refCat,
+            fluxField = fluxField,
+        )
+
+    @pipeBase.timeMethod
+    def loadObjectsById(self, idList, filterName=None):
+        """!Load reference objects by ID
+
+        Uses the catalog's ID index to read only the requested rows of the shards holding them.
+
+        @param[in] idList  sequence of reference object IDs
+        @param[in] filterName  name of filter, or None for the default filter
+
+        @return None if the catalog has no ID index (it was ingested without one),
+            else an lsst.pipe.base.Struct as returned by loadSkyCircle
+        """
+        if not self.catalog.hasIdIndex():
+            return None
+        ids, idShards, idRows = self.catalog.readIdIndex()
+        wanted = numpy.unique(numpy.asarray(idList, dtype=ids.dtype))
+        pos = numpy.searchsorted(ids, wanted)
+        found = pos < len(ids)
+        found[found] = ids[pos[found]] == wanted[found]
+        pos = pos[found]
+        shards = numpy.array(idShards[pos])
+        rows = numpy.array(idRows[pos])
+
+        pieces = dict((name, []) for name in self.description.columns)
+        for shardId in numpy.unique(shards):
+            shard = self._getShard(int(shardId))
+            shardRows = numpy.sort(rows[shards == shardId])
+            for name, values in pieces.iteritems():
+                values.append(shard[name][shardRows])
+        refCat = self._makeCatalog(pieces)
+        self.log.logdebug("found %d of %d requested reference objects" % (len(refCat), len(wanted)))
+
+        self._addFluxAliases(refCat.schema)
+        fluxField = getRefFluxField(schema=refCat.schema, filterName=filterName)
+        return pipeBase.Struct(
+            refCat = refCat,
+            fluxField = fluxField,
+        )
+
+    def _groupRangesByShard(self, ranges):
+        """!Split ranges of trixel IDs at the index depth into per-shard lists
+
+        @param[in] ranges  sorted list of (begin, end) half-open ranges of trixel IDs at indexDepth
+        @return a list of (shardId, list of (begin, end)) for shards present in the catalog
+        """
+        shift = 2*(self.description.indexDepth - self.description.shardDepth)
+        shardRanges = {}
+        for begin, end in ranges:
+            while begin < end:
+                shardId = begin >> shift
+                shardEnd = min(end, (shardId + 1) << shift)
+                shardRanges.setdefault(shardId, []).append((begin, shardEnd))
+                begin = shardEnd
+        shardList = numpy.array(sorted(shardRanges), dtype=numpy.int64)
+        present = numpy.in1d(shardList, self.shardIds)
+        return [(int(shardId), shardRanges[shardId]) for shardId in shardList[present]]
+
+    def _getShard(self, shardId):
+        """!Return the columns of a shard as a dict of column name: numpy array
+
+        The columns are memory-mapped, unless the tile cache is enabled, in which case
+        the whole shard is read into memory and cached.
+        """
+        if not self.isTileCacheEnabled():
+            return _LazyShard(self.catalog, shardId)
+        columnNames = list(self.description.columns) + [self.catalog.IndexColumn]
+        return self._getCachedTile(
+            (os.path.abspath(self.config.catalogDir), shardId),
+            lambda: dict((name, numpy.array(self.catalog.openColumn(shardId, name))) for name in columnNames),
+        )
+
+    @staticmethod
+    def _getRows(htmIndex, ranges):
+        """!Return the indices of the rows of a shard whose index lies in any of the given ranges
+
+        @param[in] htmIndex  sorted index column of the shard
+        @param[in] ranges  list of (begin, end) half-open ranges of trixel IDs at indexDepth
+        """
+        bounds = numpy.searchsorted(htmIndex, numpy.array(ranges, dtype=numpy.int64).ravel())
+        return numpy.concatenate([numpy.arange(begin, end) for begin, end in bounds.reshape(-1, 2)])
+
+    def _makeCatalog(self, pieces):
+        """!Assemble a contiguous SimpleCatalog from per-shard column pieces
+
+        @param[in] pieces  dict of column name: list of numpy arrays, one per shard
+        """
+        columns = dict((name, numpy.concatenate(values) if values else numpy.empty(0))
+                       for name, values in pieces.iteritems())
+        numRows = len(columns["id"])
+        refCat = afwTable.SimpleCatalog(self.schema)
+        if numRows == 0:
+            return refCat
+        # Preallocate one contiguous block, then fill it by repeatedly doubling the catalog with
+        # deep copies of its own records; each extend is a single call that copies in C++
+        refCat.reserve(numRows)
+        refCat.addNew()
+        while len(refCat) < numRows:
+            refCat.extend(refCat[:min(len(refCat), numRows - len(refCat))], deep=True)
+
+        schema = refCat.schema
+        columnView = refCat.getColumnView()
+        flagColumns = set(self.description.flagColumns)
+        for name, values in columns.iteritems():
+            key = schema[name].asKey()
+            if name in flagColumns:
+                # flags have no writable column array; they start cleared, so only set the set ones
+                for i in numpy.flatnonzero(values):
+                    refCat[int(i)].set(key, True)
+            else:
+                columnView[key][:] = values
+        return refCat
+
+class _LazyShard(object):
+    """!Dict-like access to the memory-mapped columns of a shard, opening each column on first use"""
+    def __init__(self, catalog, shardId):
+        self._catalog = catalog
+        self._shardId = shardId
+        self._columns = {}
+
+    def __getitem__(self, name):
+        if name not in self._columns:
+            self._columns[name] = self._catalog.openColumn(self._shardId, name)
+        return self._columns[name]
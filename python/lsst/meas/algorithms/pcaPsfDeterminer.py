@@ -31,6 +31,7 @@ import lsst.afw.geom as afwGeom
 import lsst.afw.geom.ellipses as afwEll
 import lsst.afw.display.ds9 as ds9
 import lsst.afw.math as afwMath
+import lsst.pipe.base as pipeBase
 from . import algorithmsLib
 from . import utils as maUtils
 
@@ -64,6 +65,13 @@ class PcaPsfDeterminerConfig(pexConfig.Config):
 #        minValue = 10,
         check = lambda x: x >= 10,
     )
+    oversampling = pexConfig.RangeField(
+        doc = "Number of samples per pixel of the PSF model in each dimension; if > 1, the PSF is an "
+              "OversampledPcaPsf built from the candidates finally accepted, otherwise a PcaPsf",
+        dtype = int,
+        default = 1,
+        min = 1,
+    )
     nStarPerCell = pexConfig.Field(
         doc = "number of stars per psf cell for PSF kernel creation",
         dtype = int,
@@ -140,12 +148,26 @@ class PcaPsfDeterminerConfig(pexConfig.Config):
         default = True,
     )
 
+_noViableCandidates = "No viable PSF candidates survive"
+
+class _PsfFitRequest(object):
+    """!A request from PcaPsfDeterminer._determinePsf for the result of PcaPsfDeterminer._fitPsf"""
+    def __init__(self, exposure, psfCellSet, kernelSize, nEigenComponents):
+        self.exposure = exposure
+        self.psfCellSet = psfCellSet
+        self.kernelSize = kernelSize
+        self.nEigenComponents = nEigenComponents
+
 class PcaPsfDeterminer(object):
     """!
     A measurePsfTask psf estimator
     """
     ConfigClass = PcaPsfDeterminerConfig
 
+    # Names (or prefixes) of the instrumentation probes of the C++ code run by determinePsf
+    _instrumentationProbes = ("PsfImagePca.", "PsfCandidate.", "createKernelFromPsfCandidates",
+                              "createOversampledPsfFromPsfCandidates", "fitSpatialKernelFromPsfCandidates")
+
     def __init__(self, config):
         """!Construct a PCA PSF Fitter
 
@@ -174,17 +196,14 @@ class PcaPsfDeterminer(object):
                 break                   # OK, we can get nEigen components
             except pexExceptions.LengthError as e:
                 if nEigen == 1:         # can't go any lower
-                    raise IndexError("No viable PSF candidates survive")
+                    raise IndexError(_noViableCandidates)
 
                 self.warnLog.log(pexLog.Log.WARN, "%s: reducing number of eigen components" % e.what())
         #
         # We got our eigen decomposition so let's use it
         #
-        # Express eigenValues in units of reduced chi^2 per star
-        size = kernelSize + 2*self.config.borderWidth
-        nu = size*size - 1                  # number of degrees of freedom/star for chi^2    
-        eigenValues = [l/float(algorithmsLib.countPsfCandidates(psfCellSet, self.config.nStarPerCell)*nu)
-                       for l in eigenValues]
+        eigenValues = self._scaleEigenValues(
+            eigenValues, kernelSize, algorithmsLib.countPsfCandidates(psfCellSet, self.config.nStarPerCell))
 
         # Fit spatial model
         status, chi2 = algorithmsLib.fitSpatialKernelFromPsfCandidates(
@@ -195,6 +214,43 @@ class PcaPsfDeterminer(object):
 
         return psf, eigenValues, nEigen, chi2
 
+    def _fitPsfs(self, requests):
+        """!Fit PSFs to several sets of PSF candidates at once, concurrently
+
+        \param[in] requests  a sequence of _PsfFitRequest
+
+        \return a list with, for each request, what _fitPsf would have returned for it or the exception
+        that it would have raised
+        """
+        algorithmsLib.PsfCandidateF.setPixelThreshold(self.config.pixelThreshold)
+        algorithmsLib.PsfCandidateF.setMaskBlends(self.config.doMaskBlends)
+
+        fits = algorithmsLib.fitPsfsFromPsfCandidates(
+            [req.psfCellSet for req in requests],
+            [afwGeom.Box2I(req.exposure.getXY0(), req.exposure.getDimensions()) for req in requests],
+            [req.nEigenComponents for req in requests], [req.kernelSize for req in requests],
+            self.config.spatialOrder, self.config.nStarPerCell, bool(self.config.constantWeight),
+            bool(self.config.nonLinearSpatialFit), self.config.nStarPerCellSpatialFit,
+            self.config.tolerance, self.config.lam)
+
+        results = []
+        for req, fit in zip(requests, fits):
+            for warning in fit.warnings:
+                self.warnLog.log(pexLog.Log.WARN, "%s: reducing number of eigen components" % warning)
+            if fit.error:
+                results.append((IndexError if fit.error == _noViableCandidates else RuntimeError)(fit.error))
+                continue
+            eigenValues = self._scaleEigenValues(fit.eigenValues, req.kernelSize, fit.nCandidates)
+            results.append((algorithmsLib.PcaPsf(fit.kernel), eigenValues, fit.nEigenComponents,
+                            fit.spatialFitChi2))
+        return results
+
+    def _scaleEigenValues(self, eigenValues, kernelSize, nCandidates):
+        """!Express eigenValues in units of reduced chi^2 per star"""
+        size = kernelSize + 2*self.config.borderWidth
+        nu = size*size - 1                  # number of degrees of freedom/star for chi^2    
+        return [l/float(nCandidates*nu) for l in eigenValues]
+
 
     def determinePsf(self, exposure, psfCandidateList, metadata=None, flagKey=None):
         """!Determine a PCA PSF model for an exposure given a list of PSF candidates
@@ -202,13 +258,95 @@ class PcaPsfDeterminer(object):
         \param[in] exposure exposure containing the psf candidates (lsst.afw.image.Exposure)
         \param[in] psfCandidateList a sequence of PSF candidates (each an lsst.meas.algorithms.PsfCandidate);
             typically obtained by detecting sources and then running them through a star selector
-        \param[in,out] metadata  a home for interesting tidbits of information
+        \param[in,out] metadata  a home for interesting tidbits of information; if instrumentation
+            is enabled (see lsst.meas.algorithms.setInstrumentationEnabled) the timers and counters
+            of this call are added under "instrumentation"
         \param[in] flagKey schema key used to mark sources actually used in PSF determination
     
         \return a list of
-         - psf: the measured PSF, an lsst.meas.algorithms.PcaPsf
+         - psf: the measured PSF, an lsst.meas.algorithms.PcaPsf (or OversampledPcaPsf if
+           config.oversampling > 1)
          - cellSet: an lsst.afw.math.SpatialCellSet containing the PSF candidates
         """
+        steps = self._determinePsf(exposure, psfCandidateList, metadata, flagKey)
+        step = steps.next()
+        while isinstance(step, _PsfFitRequest):
+            step = steps.send(self._fitPsf(step.exposure, step.psfCellSet, step.kernelSize,
+                                           step.nEigenComponents))
+        return step
+
+    def determineVisitPsfs(self, exposureList, psfCandidateLists, metadataList=None, flagKey=None):
+        """!Determine PCA PSF models for several exposures, e.g. all the CCDs of a visit
+
+        The PSFs are identical to those that determinePsf would determine for each exposure in turn,
+        but on each iteration the kernels of all the exposures are fit by a single call to
+        fitPsfsFromPsfCandidates, which fits them concurrently on the shared thread pool (see
+        ThreadPoolConfig).  Instrumentation is not collected into the exposures' metadata.
+
+        \param[in] exposureList  a sequence of exposures (each an lsst.afw.image.Exposure)
+        \param[in] psfCandidateLists  a sequence of PSF candidates for each exposure
+        \param[in,out] metadataList  a home for each exposure's interesting tidbits of information, or None
+        \param[in] flagKey schema key used to mark sources actually used in PSF determination
+
+        \return a list with, for each exposure, an lsst.pipe.base.Struct containing:
+         - psf: the measured PSF, as returned by determinePsf, or None if it could not be determined
+         - cellSet: an lsst.afw.math.SpatialCellSet containing the PSF candidates, or None
+         - error: the exception that prevented the PSF from being determined, or None
+        """
+        nExposure = len(exposureList)
+        if len(psfCandidateLists) != nExposure:
+            raise ValueError("Saw %d exposures but %d lists of PSF candidates" %
+                             (nExposure, len(psfCandidateLists)))
+        if metadataList is None:
+            metadataList = [None]*nExposure
+        elif len(metadataList) != nExposure:
+            raise ValueError("Saw %d exposures but %d metadata" % (nExposure, len(metadataList)))
+
+        results = [pipeBase.Struct(psf=None, cellSet=None, error=None) for i in range(nExposure)]
+        steps = [self._determinePsf(exposure, psfCandidateList, metadata, flagKey, instrument=False)
+                 for exposure, psfCandidateList, metadata in
+                 zip(exposureList, psfCandidateLists, metadataList)]
+        requests = {}                   # pending _PsfFitRequests, indexed by exposure
+
+        def advance(i, resume, *args):
+            """Resume steps[i] until it next requests a fit or finishes"""
+            try:
+                step = resume(*args)
+            except Exception as e:
+                results[i].error = e
+                return
+            if isinstance(step, _PsfFitRequest):
+                requests[i] = step
+            else:
+                results[i].psf, results[i].cellSet = step
+
+        for i, step in enumerate(steps):
+            advance(i, step.next)
+        while requests:
+            indices = sorted(requests)
+            fits = self._fitPsfs([requests.pop(i) for i in indices])
+            for i, fit in zip(indices, fits):
+                if isinstance(fit, Exception):
+                    advance(i, steps[i].throw, fit)
+                else:
+                    advance(i, steps[i].send, fit)
+
+        return results
+
+    def _determinePsf(self, exposure, psfCandidateList, metadata=None, flagKey=None, instrument=True):
+        """!Determine a PCA PSF model; the body of determinePsf
+
+        A generator, so that the fits of several exposures' PSFs may be batched: it yields a
+        _PsfFitRequest whenever it needs _fitPsf's result, which must be sent back to it (or the
+        exception raised by _fitPsf thrown into it), and finally yields determinePsf's return value.
+
+        \param[in] instrument  collect instrumentation into metadata (if enabled)?
+        """
+        # Don't reset the probes, which are shared by the whole process; record what they were instead
+        instrumentation = None
+        if instrument and metadata is not None and algorithmsLib.isInstrumentationEnabled():
+            instrumentation = algorithmsLib.InstrumentationSnapshot()
+
         import lsstDebug
         display = lsstDebug.Info(__name__).display 
         displayExposure = lsstDebug.Info(__name__).displayExposure     # display the Exposure + spatialCells 
@@ -352,7 +490,7 @@ class PcaPsfDeterminer(object):
                 # First, estimate the PSF
                 #
                 psf, eigenValues, nEigenComponents, fitChi2 = \
-                    self._fitPsf(exposure, psfCellSet, actualKernelSize, nEigenComponents)
+                    (yield _PsfFitRequest(exposure, psfCellSet, actualKernelSize, nEigenComponents))
                 #
                 # In clipping, allow all candidates to be innocent until proven guilty on this iteration.
                 # Throw out any prima facie guilty candidates (naughty chi^2 values)
@@ -558,7 +696,7 @@ class PcaPsfDeterminer(object):
 
         # One last time, to take advantage of the last iteration
         psf, eigenValues, nEigenComponents, fitChi2 = \
-            self._fitPsf(exposure, psfCellSet, actualKernelSize, nEigenComponents)
+            (yield _PsfFitRequest(exposure, psfCellSet, actualKernelSize, nEigenComponents))
 
         #
         # Display code for debugging
@@ -620,9 +758,21 @@ class PcaPsfDeterminer(object):
             metadata.set("avgX", avgX)
             metadata.set("avgY", avgY)
 
-        psf = algorithmsLib.PcaPsf(psf.getKernel(), afwGeom.Point2D(avgX, avgY))
+        if self.config.oversampling > 1:
+            psf, eigenValues = algorithmsLib.createOversampledPsfFromPsfCandidates(
+                psfCellSet, exposure.getDimensions(), exposure.getXY0(),
+                psf.getKernel().getNBasisKernels(), self.config.spatialOrder, actualKernelSize,
+                self.config.oversampling, self.config.nStarPerCell, bool(self.config.constantWeight),
+                3,                      # background border, as createKernelFromPsfCandidates uses
+                afwGeom.Point2D(avgX, avgY))
+        else:
+            psf = algorithmsLib.PcaPsf(psf.getKernel(), afwGeom.Point2D(avgX, avgY))
+
+        if instrumentation is not None:
+            for probes in self._instrumentationProbes:
+                instrumentation.collect(metadata, "instrumentation.", probes)
 
-        return psf, psfCellSet
+        yield psf, psfCellSet
 
 
 def candidatesIter(psfCellSet, ignoreBad=True):
@@ -82,10 +82,15 @@ lsst::afw::image::MaskedImage<PIXTYPE, lsst::afw::image::MaskPixel, lsst::afw::i
 %template(pair_vector_double_KernelList) std::pair<std::vector<double>, lsst::afw::math::KernelList>;
 %template(pair_bool_double) std::pair<bool, double>;
 %template(pair_Kernel_double_double) std::pair<lsst::afw::math::Kernel::Ptr, std::pair<double, double> >;
+%template(pair_vector_double_vector_double) std::pair<std::vector<double>, std::vector<double> >;
 
 %template(createKernelFromPsfCandidates) lsst::meas::algorithms::createKernelFromPsfCandidates<float>;
 %template(fitSpatialKernelFromPsfCandidates) lsst::meas::algorithms::fitSpatialKernelFromPsfCandidates<float>;
 %template(countPsfCandidates) lsst::meas::algorithms::countPsfCandidates<float>;
+%template(SpatialCellSetList) std::vector<PTR(lsst::afw::math::SpatialCellSet)>;
+%template(Box2IList) std::vector<lsst::afw::geom::Box2I>;
+%template(PsfFitResultList) std::vector<lsst::meas::algorithms::PsfFitResult>;
+%template(fitPsfsFromPsfCandidates) lsst::meas::algorithms::fitPsfsFromPsfCandidates<float>;
 %template(subtractPsf) lsst::meas::algorithms::subtractPsf<%MASKEDIMAGE(float)>;
 %template(fitKernelParamsToImage) lsst::meas::algorithms::fitKernelParamsToImage<%MASKEDIMAGE(float)>;
 %template(fitKernelToImage) lsst::meas::algorithms::fitKernelToImage<%MASKEDIMAGE(float)>;
@@ -94,6 +99,10 @@ lsst::afw::image::MaskedImage<PIXTYPE, lsst::afw::image::MaskPixel, lsst::afw::i
 #include "boost/shared_ptr.hpp"
 #include "lsst/meas/algorithms/SingleGaussianPsf.h"
 #include "lsst/meas/algorithms/PcaPsf.h"
+#include "lsst/meas/algorithms/OversampledPcaPsf.h"
+#include "lsst/meas/algorithms/TabulatedPsf.h"
+#include "lsst/meas/algorithms/PcaPsfConvolver.h"
+#include "lsst/meas/algorithms/PsfRendering.h"
 %}
 
 %import "lsst/afw/table/io/ioLib.i"
@@ -103,23 +112,46 @@ lsst::afw::image::MaskedImage<PIXTYPE, lsst::afw::image::MaskPixel, lsst::afw::i
 %declareTablePersistable(SingleGaussianPsf, lsst::meas::algorithms::SingleGaussianPsf);
 %declareTablePersistable(DoubleGaussianPsf, lsst::meas::algorithms::DoubleGaussianPsf);
 %declareTablePersistable(PcaPsf, lsst::meas::algorithms::PcaPsf);
+%declareTablePersistable(OversampledPcaPsf, lsst::meas::algorithms::OversampledPcaPsf);
+%declareTablePersistable(TabulatedPsf, lsst::meas::algorithms::TabulatedPsf);
 
 %include "lsst/meas/algorithms/ImagePsf.h"
 %include "lsst/meas/algorithms/KernelPsf.h"
 %include "lsst/meas/algorithms/SingleGaussianPsf.h"
 %include "lsst/meas/algorithms/DoubleGaussianPsf.h"
 %include "lsst/meas/algorithms/PcaPsf.h"
+%include "lsst/meas/algorithms/OversampledPcaPsf.h"
+%include "lsst/meas/algorithms/TabulatedPsf.h"
 
 %lsst_persistable(lsst::meas::algorithms::ImagePsf);
 %lsst_persistable(lsst::meas::algorithms::KernelPsf);
 %lsst_persistable(lsst::meas::algorithms::SingleGaussianPsf);
 %lsst_persistable(lsst::meas::algorithms::DoubleGaussianPsf);
 %lsst_persistable(lsst::meas::algorithms::PcaPsf);
+%lsst_persistable(lsst::meas::algorithms::OversampledPcaPsf);
+%lsst_persistable(lsst::meas::algorithms::TabulatedPsf);
 
 %castShared(lsst::meas::algorithms::ImagePsf, lsst::afw::detection::Psf)
 %castShared(lsst::meas::algorithms::KernelPsf, lsst::afw::detection::Psf)
 %castShared(lsst::meas::algorithms::SingleGaussianPsf, lsst::afw::detection::Psf)
 %castShared(lsst::meas::algorithms::DoubleGaussianPsf, lsst::afw::detection::Psf)
 %castShared(lsst::meas::algorithms::PcaPsf, lsst::afw::detection::Psf)
+%castShared(lsst::meas::algorithms::OversampledPcaPsf, lsst::afw::detection::Psf)
+%castShared(lsst::meas::algorithms::TabulatedPsf, lsst::afw::detection::Psf)
+
+%include "lsst/meas/algorithms/PcaPsfConvolver.h"
+%template(convolve) lsst::meas::algorithms::PcaPsfConvolver::convolve<float, float>;
+%template(convolve) lsst::meas::algorithms::PcaPsfConvolver::convolve<double, double>;
+%template(convolve) lsst::meas::algorithms::PcaPsfConvolver::convolve<double, float>;
+
+%include "lsst/meas/algorithms/PsfRendering.h"
+%template(addPsfImages) lsst::meas::algorithms::addPsfImages<float>;
+%template(addPsfImages) lsst::meas::algorithms::addPsfImages<double>;
+
+// Declared in SpatialModelPsf.h, but needs OversampledPcaPsf to be wrapped first
+%template(pair_OversampledPcaPsf_vector_double)
+    std::pair<PTR(lsst::meas::algorithms::OversampledPcaPsf), std::vector<double> >;
+%template(createOversampledPsfFromPsfCandidates)
+    lsst::meas::algorithms::createOversampledPsfFromPsfCandidates<float>;
 
 %include "lsst/meas/algorithms/WarpedPsf.i"
@@ -0,0 +1,160 @@
+from __future__ import absolute_import, division, print_function
+#
+# LSST Data Management System
+#
+# Copyright 2008-2016 AURA/LSST.
+#
+# This product includes software developed by the
+# LSST Project (http://www.lsst.org/).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the LSST License Statement and
+# the GNU General Public License along with this program.  If not,
+# see <https://www.lsstcorp.org/LegalNotices/>.
+#
+"""!On-disk layout of a sharded reference catalog
+
+A sharded reference catalog is a directory containing:
+- description.py: a persisted ShardedReferenceCatalogDescription
+- schema.fits: an empty lsst.afw.table.SimpleCatalog carrying the catalog's schema
+- shards.npy: sorted IDs of the non-empty shards (HTM trixels at depth shardDepth)
+- idIndex_id.npy, idIndex_shard.npy, idIndex_row.npy: the reference object IDs, sorted,
+  with the shard and row holding each object; used to look objects up by ID
+- one subdirectory per shard, named by its ID, holding one .npy file per column
+  and a column "htmIndex" of trixel IDs at depth indexDepth; rows within a shard
+  are sorted by htmIndex so that any trixel at that depth maps to a contiguous row range
+
+Columns are plain .npy files so they can be memory-mapped; only the pages actually
+needed by a query are then read from disk.
+"""
+import os
+
+import numpy
+
+import lsst.afw.table as afwTable
+import lsst.pex.config as pexConfig
+
+__all__ = ["ShardedReferenceCatalogDescription", "ShardedReferenceCatalog"]
+
+class ShardedReferenceCatalogDescription(pexConfig.Config):
+    """!Description of a sharded reference catalog, persisted alongside the shards"""
+    shardDepth = pexConfig.RangeField(
+        doc = "HTM depth of the shards",
+        dtype = int,
+        default = 7,
+        min = 0,
+        max = 20,
+    )
+    indexDepth = pexConfig.RangeField(
+        doc = "HTM depth of the per-shard row index; must be at least shardDepth",
+        dtype = int,
+        default = 12,
+        min = 0,
+        max = 20,
+    )
+    columns = pexConfig.ListField(
+        doc = "names of the schema fields stored as columns",
+        dtype = str,
+        default = [],
+    )
+    flagColumns = pexConfig.ListField(
+        doc = "names of the columns holding Flag fields",
+        dtype = str,
+        default = [],
+    )
+
+    def validate(self):
+        pexConfig.Config.validate(self)
+        if self.indexDepth < self.shardDepth:
+            raise ValueError("indexDepth=%s < shardDepth=%s" % (self.indexDepth, self.shardDepth))
+
+class ShardedReferenceCatalog(object):
+    """!Read and write the files making up a sharded reference catalog"""
+    DescriptionFileName = "description.py"
+    SchemaFileName = "schema.fits"
+    ShardListFileName = "shards.npy"
+    IdIndexFileNames = ("idIndex_id.npy", "idIndex_shard.npy", "idIndex_row.npy")
+    IndexColumn = "htmIndex"
+
+    def __init__(self, catalogDir):
+        """!Construct a ShardedReferenceCatalog
+
+        @param[in] catalogDir  directory containing the catalog
+        """
+        self.catalogDir = catalogDir
+
+    def readDescription(self):
+        """!Read the catalog's ShardedReferenceCatalogDescription"""
+        description = ShardedReferenceCatalogDescription()
+        description.load(os.path.join(self.catalogDir, self.DescriptionFileName))
+        return description
+
+    def writeDescription(self, description):
+        """!Write the catalog's ShardedReferenceCatalogDescription"""
+        description.save(os.path.join(self.catalogDir, self.DescriptionFileName))
+
+    def makeEmptyCatalog(self):
+        """!Return a new, empty SimpleCatalog with the catalog's schema"""
+        return afwTable.SimpleCatalog.readFits(os.path.join(self.catalogDir, self.SchemaFileName))
+
+    def writeSchema(self, schema):
+        """!Write the catalog's schema"""
+        afwTable.SimpleCatalog(schema).writeFits(os.path.join(self.catalogDir, self.SchemaFileName))
+
+    def readShardIds(self):
+        """!Return a sorted numpy array of the IDs of the non-empty shards"""
+        return numpy.load(os.path.join(self.catalogDir, self.ShardListFileName))
+
+    def writeShardIds(self, shardIds):
+        numpy.save(os.path.join(self.catalogDir, self.ShardListFileName), numpy.asarray(shardIds))
+
+    def hasIdIndex(self):
+        """!Does the catalog have an index of object IDs?"""
+        return all(os.path.exists(os.path.join(self.catalogDir, fileName))
+                   for fileName in self.IdIndexFileNames)
+
+    def readIdIndex(self):
+        """!Return read-only memory maps of the ID index
+
+        @return three numpy arrays: sorted object IDs, and the shard and row holding each object
+        """
+        return [numpy.load(os.path.join(self.catalogDir, fileName), mmap_mode="r")
+                for fileName in self.IdIndexFileNames]
+
+    def writeIdIndex(self, ids, shardIds, rows):
+        """!Write the ID index
+
+        @param[in] ids  object IDs, sorted
+        @param[in] shardIds  ID of the shard holding each object
+        @param[in] rows  row within its shard of each object
+        """
+        for fileName, values in zip(self.IdIndexFileNames, (ids, shardIds, rows)):
+            numpy.save(os.path.join(self.catalogDir, fileName), values)
+
+    def _getColumnPath(self, shardId, name):
+        return os.path.join(self.catalogDir, "%d" % (shardId,), name + ".npy")
+
+    def openColumn(self, shardId, name):
+        """!Return a read-only memory map of one column of one shard"""
+        return numpy.load(self._getColumnPath(shardId, name), mmap_mode="r")
+
+    def writeShard(self, shardId, columns):
+        """!Write all the columns of one shard
+
+        @param[in] shardId  ID of the shard
+        @param[in] columns  dict of column name: numpy array, including IndexColumn
+        """
+        shardDir = os.path.dirname(self._getColumnPath(shardId, self.IndexColumn))
+        if not os.path.isdir(shardDir):
+            os.makedirs(shardDir)
+        for name, values in columns.iteritems():
+            numpy.save(self._getColumnPath(shardId, name), values)
@@ -0,0 +1,45 @@
+#
+# LSST Data Management System
+# Copyright 2008-2016 AURA/LSST.
+#
+# This product includes software developed by the
+# LSST Project (http://www.lsst.org/).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the LSST License Statement and
+# the GNU General Public License along with this program.  If not,
+# see <https://www.lsstcorp.org/LegalNotices/>.
+#
+import lsst.pex.config as pexConfig
+from . import algorithmsLib
+
+__all__ = ["ThreadPoolConfig"]
+
+class ThreadPoolConfig(pexConfig.Config):
+    """!Config for the thread pool shared by the C++ algorithms of meas_algorithms
+
+    The pool is process-wide, so apply() affects every task in the process.
+    """
+    numThreads = pexConfig.RangeField(
+        dtype = int,
+        doc = "Number of threads, including the calling thread: 1 for serial (and bit-identical) execution, "
+              "0 for one per processor, None to keep the current value (initially set from the "
+              "environment variable MEAS_ALGORITHMS_NUM_THREADS, else 1)",
+        default = None,
+        optional = True,
+        min = 0,
+    )
+
+    def apply(self):
+        """!Set the size of the thread pool, unless numThreads is None"""
+        if self.numThreads is not None:
+            algorithmsLib.setNumThreads(self.numThreads)
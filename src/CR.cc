@@ -34,10 +34,13 @@
 #include <cassert>
 #include <string>
 #include <typeinfo>
+#include <utility>
+#include <vector>
 
 #include <iostream>
 
 
+#include "boost/cstdint.hpp"
 #include "boost/format.hpp"
 
 #include "lsst/pex/exceptions.h"
@@ -50,7 +53,9 @@
 #include "lsst/afw/image/MaskedImage.h"
 #include "lsst/afw/math/Random.h"
 #include "lsst/meas/algorithms/CR.h"
+#include "lsst/meas/algorithms/Instrumentation.h"
 #include "lsst/meas/algorithms/Interp.h"
+#include "lsst/meas/algorithms/KernelPsf.h"
 
 /**
  * @todo These should go into afw --- actually, there're already there, but
@@ -119,8 +124,24 @@ namespace pexLogging = lsst::pex::logging;
 
 namespace {
 
+/*
+ * A run of pixels in a row of an image, in the image's local coordinates
+ */
+struct CrRun {
+    CrRun(int y_, int x0_, int x1_) : y(y_), x0(x0_), x1(x1_) {}
+
+    int y;                              // row
+    int x0, x1;                         // inclusive range of columns
+};
+/*
+ * A cosmic ray is a list of runs sorted by row and then column.  This costs far less than a Footprint
+ * (with a Span per run), so we only make Footprints if the caller wants them
+ */
+typedef std::vector<CrRun> CrRuns;
+typedef std::vector<CrRuns> CrRunList;  // a set of cosmic rays
+
 template<typename ImageT, typename MaskT>
-void removeCR(image::MaskedImage<ImageT, MaskT> & mi, std::vector<detection::Footprint::Ptr> & CRs,
+void removeCR(image::MaskedImage<ImageT, MaskT> & mi, CrRunList const & CRs,
               double const bkgd, MaskT const , MaskT const saturBit, MaskT const badMask,
               bool const debias, bool const grow);
 
@@ -174,6 +195,132 @@ struct Sort_CRPixel_by_id {
 };
 
 /*****************************************************************************/
+/*
+ * The noise used by conditions #2 and #3 for three consecutive rows of an image
+ *
+ * Each row's variance is copied, and its square root taken, once as the buffer is advanced down the
+ * image, so the tests read contiguous arrays rather than going back to the variance plane (and taking
+ * its square root) for every pixel that they examine.  The standard deviations of the means of pairs
+ * of neighbours are only needed for pixels that pass condition #2, so they're formed from the buffered
+ * variances on demand.
+ */
+template <typename MaskedImageT>
+class NoiseRows {
+public:
+    typedef typename MaskedImageT::Variance::Pixel VariancePixel;
+
+    // Buffer the columns needed to test pixels x0...x1 (inclusive)
+    NoiseRows(MaskedImageT const& mimage, int const x0, int const x1) :
+        _variance(*mimage.getVariance()), _x0(x0 - 1), _width(std::max(0, x1 - x0 + 3)), _y(0), _row(0) {
+        for (int k = 0; k != 3; ++k) {
+            _var[k].resize(_width);
+            _sigma[k].resize(_width);
+        }
+    }
+
+    // Load the rows around row y
+    void reset(int const y) {
+        _y = y;
+        _row = 0;
+        for (int k = 0; k != 3; ++k) {
+            _load(k, y - 1 + k);
+        }
+    }
+
+    // Move down to the next row, reading only the one row that is new
+    void advance() {
+        _row = (_row + 1)%3;
+        ++_y;
+        _load((_row + 2)%3, _y + 1);
+    }
+
+    // sqrt(variance) of pixel x in the current row
+    double sigma(int const x) const { return _sigma[(_row + 1)%3][x - _x0]; }
+
+    // standard deviations of the means of the pairs of pixels surrounding pixel x in the current row
+    double dmeanWe(int const x) const {
+        VariancePixel const *v0 = &_var[(_row + 1)%3][x - _x0];
+        return sqrt(v0[-1] + v0[1])/2;
+    }
+    double dmeanNs(int const x) const {
+        return sqrt(_var[(_row + 2)%3][x - _x0] + _var[_row][x - _x0])/2;
+    }
+    double dmeanSwne(int const x) const {
+        return sqrt(_var[_row][x - _x0 - 1] + _var[(_row + 2)%3][x - _x0 + 1])/2;
+    }
+    double dmeanNwse(int const x) const {
+        return sqrt(_var[(_row + 2)%3][x - _x0 - 1] + _var[_row][x - _x0 + 1])/2;
+    }
+
+private:
+    void _load(int const k, int const y) {
+        typename MaskedImageT::Variance::x_iterator ptr = _variance.row_begin(y) + _x0;
+        for (int i = 0; i != _width; ++i, ++ptr) {
+            _var[k][i] = *ptr;
+            _sigma[k][i] = sqrt(*ptr);
+        }
+    }
+
+    typename MaskedImageT::Variance const& _variance;
+    int const _x0;                      // column of the first buffered pixel
+    int const _width;                   // number of buffered pixels in each row
+    int _y;                             // current row
+    int _row;                           // index into _var and _sigma of row _y - 1
+    std::vector<VariancePixel> _var[3];
+    std::vector<double> _sigma[3];
+};
+
+/*
+ * Preliminary corrections to the CR-contaminated pixels found by a scan of an image
+ *
+ * The corrections are held in a sparse list per row rather than written into the image, but pixels
+ * tested later in the scan see the corrected values of their neighbours just as if they had been.
+ */
+template <typename PixelT>
+class CrOverlay {
+public:
+    typedef std::pair<int, PixelT> Entry;  // column, corrected value
+
+    explicit CrOverlay(int const nrow) : _rows(std::max(0, nrow)) {}
+
+    // Set pixel (x, y); pixels must be set in order of increasing x within each row
+    void set(int const x, int const y, PixelT const value) {
+        _rows[y].push_back(Entry(x, value));
+    }
+
+    // Return the value of pixel (x, y), whose value in the image is value
+    PixelT get(int const x, int const y, PixelT const value) const {
+        std::vector<Entry> const& row = _rows[y];
+        if (row.empty()) {
+            return value;
+        }
+        typename std::vector<Entry>::const_iterator ptr =
+            std::lower_bound(row.begin(), row.end(), x, ColumnLess());
+        return (ptr != row.end() && ptr->first == x) ? ptr->second : value;
+    }
+
+private:
+    struct ColumnLess {
+        bool operator()(Entry const& a, int const x) const { return a.first < x; }
+    };
+
+    std::vector<std::vector<Entry> > _rows;
+};
+
+/*
+ * Return the value of the pixel at (dx, dy) relative to loc, i.e. pixel (x + dx, y + dy), allowing for
+ * any correction in overlay
+ */
+template <typename MaskedImageT>
+inline typename MaskedImageT::Image::Pixel
+pixelValue(typename MaskedImageT::xy_locator const& loc,
+           CrOverlay<typename MaskedImageT::Image::Pixel> const* overlay,
+           int const x, int const y, int const dx, int const dy)
+{
+    typename MaskedImageT::Image::Pixel const value = loc.image(dx, dy);
+    return overlay ? overlay->get(x + dx, y + dy, value) : value;
+}
+
 /*
  * This is the code to see if a given pixel is bad
  *
@@ -182,6 +329,9 @@ struct Sort_CRPixel_by_id {
 template <typename MaskedImageT>
 bool is_cr_pixel(typename MaskedImageT::Image::Pixel *corr,      // corrected value
                  typename MaskedImageT::xy_locator loc,          // locator for this pixel
+                 NoiseRows<MaskedImageT> const& noise,           // noise in the rows around this pixel
+                 CrOverlay<typename MaskedImageT::Image::Pixel> const* overlay, // corrections, or NULL
+                 int const x, int const y,                       // position of this pixel
                  double const minSigma, // minSigma, or -threshold if negative
                  double const thresH, double const thresV, double const thresD, // for condition #3
                  double const bkgd,     // unsubtracted background level
@@ -189,6 +339,7 @@ bool is_cr_pixel(typename MaskedImageT::Image::Pixel *corr,      // corrected va
                 )
 {
     typedef typename MaskedImageT::Image::Pixel ImagePixel;
+    typedef typename interp::PixelArithmetic<ImagePixel>::Working Working; // n.b. double for integer images
     //
     // Unpack some values
     //
@@ -204,17 +355,21 @@ bool is_cr_pixel(typename MaskedImageT::Image::Pixel *corr,      // corrected va
     /*
      * condition #2
      */
-    ImagePixel const mean_we =   (loc.image(-1,  0) + loc.image( 1,  0))/2; // avgs of surrounding 8 pixels
-    ImagePixel const mean_ns =   (loc.image( 0,  1) + loc.image( 0, -1))/2;
-    ImagePixel const mean_swne = (loc.image(-1, -1) + loc.image( 1,  1))/2;
-    ImagePixel const mean_nwse = (loc.image(-1,  1) + loc.image( 1, -1))/2;
+#define PIXEL(DX, DY) static_cast<Working>(pixelValue<MaskedImageT>(loc, overlay, x, y, DX, DY))
+    Working const mean_we =   (PIXEL(-1,  0) + PIXEL( 1,  0))/2; // avgs of surrounding 8 pixels
+    Working const mean_ns =   (PIXEL( 0,  1) + PIXEL( 0, -1))/2;
+    Working const mean_swne = (PIXEL(-1, -1) + PIXEL( 1,  1))/2;
+    Working const mean_nwse = (PIXEL(-1,  1) + PIXEL( 1, -1))/2;
+#undef PIXEL
+
+    double const dv_00 = noise.sigma(x);
 
     if (minSigma < 0) {         /* |thres_sky_sigma| is threshold */
         if (v_00 < -minSigma) {
             return false;
         }
     } else {
-        double const thres_sky_sigma = minSigma*sqrt(loc.variance(0, 0));
+        double const thres_sky_sigma = minSigma*dv_00;
 
         if (v_00 < mean_ns   + thres_sky_sigma &&
             v_00 < mean_we   + thres_sky_sigma &&
@@ -228,14 +383,14 @@ bool is_cr_pixel(typename MaskedImageT::Image::Pixel *corr,      // corrected va
  *
  * Note that this uses mean_ns etc. even if minSigma is negative
  */
-    double const dv_00 =      sqrt(loc.variance( 0,  0));
     // standard deviation of means of surrounding pixels
-    double const dmean_we =   sqrt(loc.variance(-1,  0) + loc.variance( 1,  0))/2;
-    double const dmean_ns =   sqrt(loc.variance( 0,  1) + loc.variance( 0, -1))/2;
-    double const dmean_swne = sqrt(loc.variance(-1, -1) + loc.variance( 1,  1))/2;
-    double const dmean_nwse = sqrt(loc.variance(-1,  1) + loc.variance( 1, -1))/2;
+    double const dmean_we =   noise.dmeanWe(x);
+    double const dmean_ns =   noise.dmeanNs(x);
+    double const dmean_swne = noise.dmeanSwne(x);
+    double const dmean_nwse = noise.dmeanNwse(x);
 
-    if (!condition_3(corr,
+    Working estimate = 0;
+    if (!condition_3(&estimate,
                      v_00 - bkgd, mean_ns - bkgd, mean_we - bkgd, mean_swne - bkgd, mean_nwse - bkgd,
                      dv_00,      dmean_ns,       dmean_we,       dmean_swne,       dmean_nwse,
                      thresH, thresV, thresD, cond3Fac)){
@@ -244,7 +399,7 @@ bool is_cr_pixel(typename MaskedImageT::Image::Pixel *corr,      // corrected va
 /*
  * OK, it's a contaminated pixel
  */
-    *corr += static_cast<ImagePixel>(bkgd);
+    *corr = interp::PixelArithmetic<ImagePixel>::convert(estimate + static_cast<Working>(bkgd));
 
     return true;
 }
@@ -252,13 +407,13 @@ bool is_cr_pixel(typename MaskedImageT::Image::Pixel *corr,      // corrected va
 /************************************************************************************************************/
 //
 // Worker routine to process the pixels adjacent to a span (including the points just
-// to the left and just to the right)
+// to the left and just to the right) in rows y0...y1
 //
 template <typename MaskedImageT>
-void checkSpanForCRs(detection::Footprint *extras, // Extra spans get added to this Footprint
+void checkSpanForCRs(CrRuns *extras, // Extra pixels get added to this list
                      std::vector<CRPixel<typename MaskedImageT::Image::Pixel> >& crpixels,
                                         // a list of pixels containing CRs
-                     int const y,   // the row to process
+                     int const y0, int const y1, // range of rows to process (inclusive)
                      int const x0, int const x1, // range of pixels in the span (inclusive)
                      MaskedImageT& image, ///< Image to search
                      double const minSigma, // minSigma
@@ -269,23 +424,31 @@ void checkSpanForCRs(detection::Footprint *extras, // Extra spans get added to t
                     )
 {
     typedef typename MaskedImageT::Image::Pixel MImagePixel;
-    typename MaskedImageT::xy_locator loc = image.xy_at(x0 - 1, y); // locator for data
 
     int const imageX0 = image.getX0();
     int const imageY0 = image.getY0();
 
-    for (int x = x0 - 1; x <= x1 + 1; ++x) {
-        MImagePixel corr = 0;                // new value for pixel
-        if (is_cr_pixel<MaskedImageT>(&corr, loc, minSigma, thresH, thresV, thresD,
-                                     bkgd, cond3Fac)) {
-            if (keep) {
-                crpixels.push_back(CRPixel<MImagePixel>(x + imageX0, y + imageY0, loc.image()));
-            }
-            loc.image() = corr;
+    NoiseRows<MaskedImageT> noise(image, x0 - 1, x1 + 1);
+    noise.reset(y0);
+    for (int y = y0; y <= y1; ++y) {
+        if (y > y0) {
+            noise.advance();
+        }
+        typename MaskedImageT::xy_locator loc = image.xy_at(x0 - 1, y); // locator for data
+
+        for (int x = x0 - 1; x <= x1 + 1; ++x) {
+            MImagePixel corr = 0;                // new value for pixel
+            if (is_cr_pixel<MaskedImageT>(&corr, loc, noise, NULL, x, y, minSigma, thresH, thresV, thresD,
+                                         bkgd, cond3Fac)) {
+                if (keep) {
+                    crpixels.push_back(CRPixel<MImagePixel>(x + imageX0, y + imageY0, loc.image()));
+                }
+                loc.image() = corr;
 
-            extras->addSpan(y + imageY0, x + imageX0, x + imageX0);
+                extras->push_back(CrRun(y, x, x));
+            }
+            ++loc.x();
         }
-        ++loc.x();
     }
 }
 
@@ -316,135 +479,69 @@ public:
     double getCounts() const { return _sum; }
 private:
     double const _bkgd;                  // the Image's background level
-    typename ImageT::Pixel _sum;         // the sum of all DN in the Footprint, corrected for bkgd
+    // the sum of all DN in the Footprint, corrected for bkgd
+    typename interp::PixelArithmetic<typename ImageT::Pixel>::Working _sum;
 };
-}
 
 /*
- * Restore all the pixels in crpixels to their pristine state
+ * Calculate the thresholds for condition #3 from the PSF at psfCenter
+ *
+ * Only the central 3x3 pixels of the PSF are needed, so for a separable KernelPsf use the 1-D factors
+ * rather than an image
  */
-template <typename ImageT>
-static void reinstateCrPixels(
-        ImageT *image,                                                // the image in question
-        std::vector<CRPixel<typename ImageT::Pixel> > const& crpixels // a list of pixels with CRs
-                             )
+void getCond3Thresholds(detection::Psf const &psf, // the Image's PSF
+                        afw::geom::Point2D const &psfCenter, // where to realise the PSF
+                        double const cond3Fac2, // 2nd fiddle factor for condition #3
+                        double *thresH, double *thresV, double *thresD // the thresholds
+                       )
 {
-    if (crpixels.empty()) return;
+    KernelPsf const * kernelPsf = dynamic_cast<KernelPsf const *>(&psf);
+    if (kernelPsf && kernelPsf->isSeparable()) {
+        std::pair<std::vector<double>, std::vector<double> > const vectors =
+            kernelPsf->computeKernelVectors(psfCenter);
+        std::vector<double> const & cols = vectors.first;
+        std::vector<double> const & rows = vectors.second;
+        int const xc = kernelPsf->getKernel()->getCtrX(); // center of PSF
+        int const yc = kernelPsf->getKernel()->getCtrY();
+
+        double const colRatio = 0.5*(cols[xc - 1] + cols[xc + 1])/cols[xc];
+        double const rowRatio = 0.5*(rows[yc - 1] + rows[yc + 1])/rows[yc];
+        *thresH = cond3Fac2*colRatio;                                     // horizontal
+        *thresV = cond3Fac2*rowRatio;                                     // vertical
+        *thresD = cond3Fac2*colRatio*rowRatio;                            // diag
+    } else {
+        lsst::afw::math::Kernel::ConstPtr kernel = psf.getLocalKernel(psfCenter);
+        if (!kernel) {
+            throw LSST_EXCEPT(pexExcept::NotFoundError, "Psf is unable to return a kernel");
+        }
+        detection::Psf::Image psfImage = detection::Psf::Image(geom::ExtentI(kernel->getWidth(), kernel->getHeight()));
+        kernel->computeImage(psfImage, true);
 
-    typedef typename std::vector<CRPixel<typename ImageT::Pixel> >::const_iterator crpixel_iter;
-    for (crpixel_iter crp = crpixels.begin(), end = crpixels.end(); crp < end - 1 ; ++crp) {
-        *image->at(crp->col - image->getX0(), crp->row - image->getY0()) = crp->val;
+        int const xc = kernel->getCtrX();   // center of PSF
+        int const yc = kernel->getCtrY();
+
+        double const I0 = psfImage(xc, yc);
+        *thresH = cond3Fac2*(0.5*(psfImage(xc - 1, yc) + psfImage(xc + 1, yc)))/I0; // horizontal
+        *thresV = cond3Fac2*(0.5*(psfImage(xc, yc - 1) + psfImage(xc, yc + 1)))/I0; // vertical
+        *thresD = cond3Fac2*(0.25*(psfImage(xc - 1, yc - 1) + psfImage(xc + 1, yc + 1) +
+                                   psfImage(xc - 1, yc + 1) + psfImage(xc + 1, yc - 1)))/I0; // diag
     }
 }
 
-/*!
- * @brief Find cosmic rays in an Image, and mask and remove them
- *
- * @return vector of CR's Footprints
- */
-template <typename MaskedImageT>
-std::vector<detection::Footprint::Ptr>
-findCosmicRays(MaskedImageT &mimage,      ///< Image to search
-               detection::Psf const &psf, ///< the Image's PSF
-               double const bkgd,         ///< unsubtracted background of frame, DN
-               lsst::pex::policy::Policy const &policy, ///< Policy directing the behavior
-               bool const keep                          ///< if true, don't remove the CRs
-              ) {
-    typedef typename MaskedImageT::Image ImageT;
-    typedef typename ImageT::Pixel ImagePixel;
-    typedef typename MaskedImageT::Mask::Pixel MaskPixel;
-
-    // Parse the Policy
-    double const minSigma = policy.getDouble("minSigma");    // min sigma over sky in pixel for CR candidate
-    double const minDn = policy.getDouble("min_DN");         // min number of DN in an CRs
-    double const cond3Fac = policy.getDouble("cond3_fac");   // fiddle factor for condition #3
-    double const cond3Fac2 = policy.getDouble("cond3_fac2"); // 2nd fiddle factor for condition #3
-    int const niteration = policy.getInt("niteration");      // Number of times to look for contaminated
-                                                             // pixels near CRs
-    int const nCrPixelMax = policy.getInt("nCrPixelMax");    // maximum number of contaminated pixels
 /*
- * thresholds for 3rd condition
+ * Merge pixels found to be contaminated into cosmic rays
  *
- * Realise PSF at center of image
- */
-    lsst::afw::math::Kernel::ConstPtr kernel = psf.getLocalKernel(
-        afw::geom::Point2D(mimage.getWidth() / 2.0, mimage.getHeight() / 2.0)
-    );
-    if (!kernel) {
-        throw LSST_EXCEPT(pexExcept::NotFoundError, "Psf is unable to return a kernel");
-    }
-    detection::Psf::Image psfImage = detection::Psf::Image(geom::ExtentI(kernel->getWidth(), kernel->getHeight()));
-    kernel->computeImage(psfImage, true);
-
-    int const xc = kernel->getCtrX();   // center of PSF
-    int const yc = kernel->getCtrY();
-
-    double const I0 = psfImage(xc, yc);
-    double const thresH = cond3Fac2*(0.5*(psfImage(xc - 1, yc) + psfImage(xc + 1, yc)))/I0; // horizontal
-    double const thresV = cond3Fac2*(0.5*(psfImage(xc, yc - 1) + psfImage(xc, yc + 1)))/I0; // vertical
-    double const thresD = cond3Fac2*(0.25*(psfImage(xc - 1, yc - 1) + psfImage(xc + 1, yc + 1) +
-                                           psfImage(xc - 1, yc + 1) + psfImage(xc + 1, yc - 1)))/I0; // diag
-/*
- * Setup desired mask planes
+ * The pixels must be in the order in which they were found, i.e. sorted by row and then column.
+ * A dummy pixel (with row == -1) is appended to crpixels if it isn't empty
  */
-    MaskPixel const badBit = mimage.getMask()->getPlaneBitMask("BAD"); // Generic bad pixels
-    MaskPixel const crBit = mimage.getMask()->getPlaneBitMask("CR"); // CR-contaminated pixels
-    MaskPixel const interpBit = mimage.getMask()->getPlaneBitMask("INTRP"); // Interpolated pixels
-    MaskPixel const saturBit = mimage.getMask()->getPlaneBitMask("SAT"); // Saturated pixels
-    MaskPixel const nodataBit = mimage.getMask()->getPlaneBitMask("NO_DATA"); // Non data pixels
-
-    MaskPixel const badMask = (badBit | interpBit | saturBit | nodataBit); // naughty pixels
-/*
- * Go through the frame looking at each pixel (except the edge ones which we ignore)
- */
-    int const ncol = mimage.getWidth();
-    int const nrow = mimage.getHeight();
-
-    std::vector<CRPixel<ImagePixel> > crpixels; // storage for detected CR-contaminated pixels
+template <typename ImagePixel>
+CrRunList
+mergeCrPixels(std::vector<CRPixel<ImagePixel> > &crpixels, // pixels containing CRs
+              int const imageX0, int const imageY0         // origin of the image containing the pixels
+             )
+{
     typedef typename std::vector<CRPixel<ImagePixel> >::iterator crpixel_iter;
-    typedef typename std::vector<CRPixel<ImagePixel> >::reverse_iterator crpixel_riter;
-
-    for (int j = 1; j < nrow - 1; ++j) {
-        typename MaskedImageT::xy_locator loc = mimage.xy_at(1, j); // locator for data
 
-        for (int i = 1; i < ncol - 1; ++i, ++loc.x()) {
-            ImagePixel corr = 0;
-            if (!is_cr_pixel<MaskedImageT>(&corr, loc, minSigma,
-                                           thresH, thresV, thresD, bkgd, cond3Fac)) {
-                continue;
-            }
-/*
- * condition #4
- */
-            if (loc.mask() & badMask) {
-                continue;
-            }
-            if ((loc.mask(-1,  1) | loc.mask(0,  1) | loc.mask(1,  1) |
-                 loc.mask(-1,  0) |                   loc.mask(1,  0) |
-                 loc.mask(-1, -1) | loc.mask(0, -1) | loc.mask(1, -1)) & interpBit) {
-                continue;
-            }
-/*
- * OK, it's a CR
- *
- * replace CR-contaminated pixels with reasonable values as we go through
- * image, which increases the detection rate
- */
-            crpixels.push_back(CRPixel<ImagePixel>(i + mimage.getX0(), j + mimage.getY0(), loc.image()));
-            loc.image() = corr;         /* just a preliminary estimate */
-
-            if (static_cast<int>(crpixels.size()) > nCrPixelMax) {
-                reinstateCrPixels(mimage.getImage().get(), crpixels);
-
-                throw LSST_EXCEPT(lsst::pex::exceptions::LengthError,
-                                  (boost::format("Too many CR pixels (max %d)") % nCrPixelMax).str());
-            }
-        }
-    }
-/*
- * We've found them on a pixel-by-pixel basis, now merge those pixels
- * into cosmic rays
- */
     std::vector<int> aliases;           // aliases for initially disjoint parts of CRs
     aliases.reserve(1 + crpixels.size()/2); // initial size of aliases
 
@@ -568,21 +665,23 @@ findCosmicRays(MaskedImageT &mimage,      ///< Image to search
     }
 
 /*
- * Build Footprints from spans
+ * Build cosmic rays from spans
  */
-    std::vector<detection::Footprint::Ptr> CRs; // our cosmic rays
+    CrRunList CRs;                      // our cosmic rays
 
     if (spans.size() > 0) {
         int id = spans[0]->id;
         unsigned int i0 = 0;            // initial value of i
         for (unsigned int i = i0; i <= spans.size(); ++i) { // <= size to catch the last object
             if (i == spans.size() || spans[i]->id != id) {
-                detection::Footprint::Ptr cr(new detection::Footprint(i - i0));
+                CRs.push_back(CrRuns());
+                CrRuns &cr = CRs.back();
+                cr.reserve(i - i0);
 
                 for (; i0 < i; ++i0) {
-                    cr->addSpan(spans[i0]->y, spans[i0]->x0, spans[i0]->x1);
+                    cr.push_back(CrRun(spans[i0]->y - imageY0, spans[i0]->x0 - imageX0,
+                                       spans[i0]->x1 - imageX0));
                 }
-                CRs.push_back(cr);
             }
 
             if (i < spans.size()) {
@@ -591,36 +690,282 @@ findCosmicRays(MaskedImageT &mimage,      ///< Image to search
         }
     }
 
-    reinstateCrPixels(mimage.getImage().get(), crpixels);
+    return CRs;
+}
+
+/*
+ * Return the number of pixels in a cosmic ray
+ */
+int countPixels(CrRuns const &cr)
+{
+    int npix = 0;
+    for (CrRuns::const_iterator run = cr.begin(); run != cr.end(); ++run) {
+        npix += run->x1 - run->x0 + 1;
+    }
+    return npix;
+}
+
+/*
+ * Sort a cosmic ray's runs by row and then column, merging those that overlap or adjoin
+ */
+struct CrRunCompar {
+    bool operator()(CrRun const &a, CrRun const &b) const {
+        return (a.y < b.y) || (a.y == b.y && a.x0 < b.x0);
+    }
+};
+
+void normalizeRuns(CrRuns &cr)
+{
+    if (cr.empty()) {
+        return;
+    }
+    std::sort(cr.begin(), cr.end(), CrRunCompar());
+
+    CrRuns::iterator to = cr.begin();
+    for (CrRuns::const_iterator from = cr.begin() + 1; from != cr.end(); ++from) {
+        if (from->y == to->y && from->x0 <= to->x1 + 1) {
+            to->x1 = std::max(to->x1, from->x1);
+        } else {
+            *++to = *from;
+        }
+    }
+    cr.erase(to + 1, cr.end());
+}
+
+/*
+ * Call a FootprintFunctor for each pixel in a cosmic ray, just as FootprintFunctor::apply would for
+ * the equivalent Footprint
+ */
+template <typename FunctorT, typename ImageT>
+void applyToRuns(FunctorT &functor, ImageT &image, CrRuns const &cr)
+{
+    functor.reset();
+    for (CrRuns::const_iterator run = cr.begin(); run != cr.end(); ++run) {
+        typename ImageT::xy_locator loc = image.xy_at(run->x0, run->y);
+        for (int x = run->x0; x <= run->x1; ++x, ++loc.x()) {
+            functor(loc, x, run->y);
+        }
+    }
+}
+
+/*
+ * Are all of a cosmic ray's pixels, or are any of the pixels in or adjoining it, set in bits?
+ */
+template <typename MaskT>
+bool allMasked(CrRuns const &cr, MaskT const &mask, typename MaskT::Pixel const bits)
+{
+    for (CrRuns::const_iterator run = cr.begin(); run != cr.end(); ++run) {
+        typename MaskT::x_iterator ptr = mask.x_at(run->x0, run->y);
+        for (int x = run->x0; x <= run->x1; ++x, ++ptr) {
+            if (!(*ptr & bits)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+template <typename MaskT>
+bool nearMasked(CrRuns const &cr, MaskT const &mask, typename MaskT::Pixel const bits)
+{
+    if (cr.empty()) {
+        return false;
+    }
+    int x0 = cr.front().x0, x1 = cr.front().x1, y0 = cr.front().y, y1 = cr.front().y;
+    for (CrRuns::const_iterator run = cr.begin(); run != cr.end(); ++run) {
+        x0 = std::min(x0, run->x0);
+        x1 = std::max(x1, run->x1);
+        y0 = std::min(y0, run->y);
+        y1 = std::max(y1, run->y);
+    }
+    x0 = std::max(x0 - 1, 0);
+    x1 = std::min(x1 + 1, mask.getWidth() - 1);
+    y0 = std::max(y0 - 1, 0);
+    y1 = std::min(y1 + 1, mask.getHeight() - 1);
+    for (int y = y0; y <= y1; ++y) {
+        typename MaskT::x_iterator ptr = mask.x_at(x0, y);
+        for (int x = x0; x <= x1; ++x, ++ptr) {
+            if (*ptr & bits) {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+/*
+ * Set bits in the mask for all the pixels in a set of cosmic rays
+ */
+template <typename MaskT>
+void setMaskFromRuns(MaskT &mask, CrRunList const &CRs, typename MaskT::Pixel const bits)
+{
+    for (CrRunList::const_iterator cr = CRs.begin(); cr != CRs.end(); ++cr) {
+        for (CrRuns::const_iterator run = cr->begin(); run != cr->end(); ++run) {
+            typename MaskT::x_iterator ptr = mask.x_at(run->x0, run->y);
+            for (int x = run->x0; x <= run->x1; ++x, ++ptr) {
+                *ptr |= bits;
+            }
+        }
+    }
+}
+
+/*
+ * Make a Footprint from a cosmic ray found in an image whose origin is (imageX0, imageY0)
+ */
+detection::Footprint::Ptr makeFootprint(CrRuns const &cr, int const imageX0, int const imageY0)
+{
+    detection::Footprint::Ptr foot(new detection::Footprint(cr.size()));
+    for (CrRuns::const_iterator run = cr.begin(); run != cr.end(); ++run) {
+        foot->addSpan(run->y + imageY0, run->x0 + imageX0, run->x1 + imageX0);
+    }
+    return foot;
+}
+
+std::vector<detection::Footprint::Ptr> makeFootprints(CrRunList const &CRs,
+                                                      int const imageX0, int const imageY0)
+{
+    std::vector<detection::Footprint::Ptr> feet;
+    feet.reserve(CRs.size());
+    for (CrRunList::const_iterator cr = CRs.begin(); cr != CRs.end(); ++cr) {
+        feet.push_back(makeFootprint(*cr, imageX0, imageY0));
+    }
+    return feet;
+}
+
+/*
+ * Find cosmic rays in an Image, and mask and remove them; the work behind findCosmicRays and
+ * findCosmicRaysMaskOnly
+ */
+template <typename MaskedImageT>
+void findCrRuns(CrRunList &CRs,            // the cosmic rays that we find
+                MaskedImageT &mimage,      // Image to search
+                detection::Psf const &psf, // the Image's PSF
+                double const bkgd,         // unsubtracted background of frame, DN
+                lsst::pex::policy::Policy const &policy, // Policy directing the behavior
+                bool const keep                          // if true, don't remove the CRs
+               ) {
+    typedef typename MaskedImageT::Image ImageT;
+    typedef typename ImageT::Pixel ImagePixel;
+    typedef typename MaskedImageT::Mask::Pixel MaskPixel;
+
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(totalTimer, "findCosmicRays");
+
+    // Parse the Policy
+    double const minSigma = policy.getDouble("minSigma");    // min sigma over sky in pixel for CR candidate
+    double const minDn = policy.getDouble("min_DN");         // min number of DN in an CRs
+    double const cond3Fac = policy.getDouble("cond3_fac");   // fiddle factor for condition #3
+    double const cond3Fac2 = policy.getDouble("cond3_fac2"); // 2nd fiddle factor for condition #3
+    int const niteration = policy.getInt("niteration");      // Number of times to look for contaminated
+                                                             // pixels near CRs
+    int const nCrPixelMax = policy.getInt("nCrPixelMax");    // maximum number of contaminated pixels
+/*
+ * thresholds for 3rd condition
+ */
+    double thresH, thresV, thresD;
+    getCond3Thresholds(psf, afw::geom::Point2D(mimage.getWidth() / 2.0, mimage.getHeight() / 2.0),
+                       cond3Fac2, &thresH, &thresV, &thresD);
+/*
+ * Setup desired mask planes
+ */
+    MaskPixel const badBit = mimage.getMask()->getPlaneBitMask("BAD"); // Generic bad pixels
+    MaskPixel const crBit = mimage.getMask()->getPlaneBitMask("CR"); // CR-contaminated pixels
+    MaskPixel const interpBit = mimage.getMask()->getPlaneBitMask("INTRP"); // Interpolated pixels
+    MaskPixel const saturBit = mimage.getMask()->getPlaneBitMask("SAT"); // Saturated pixels
+    MaskPixel const nodataBit = mimage.getMask()->getPlaneBitMask("NO_DATA"); // Non data pixels
+
+    MaskPixel const badMask = (badBit | interpBit | saturBit | nodataBit); // naughty pixels
+/*
+ * Go through the frame looking at each pixel (except the edge ones which we ignore)
+ */
+    int const ncol = mimage.getWidth();
+    int const nrow = mimage.getHeight();
+
+    std::vector<CRPixel<ImagePixel> > crpixels; // storage for detected CR-contaminated pixels
+    typedef typename std::vector<CRPixel<ImagePixel> >::reverse_iterator crpixel_riter;
+
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(candidatesTimer, "findCosmicRays.candidates");
+    NoiseRows<MaskedImageT> noise(mimage, 1, ncol - 2); // noise in the rows around row j
+    CrOverlay<ImagePixel> overlay(nrow);                // preliminary values of CR pixels found so far
+    for (int j = 1; j < nrow - 1; ++j) {
+        if (j == 1) {
+            noise.reset(j);
+        } else {
+            noise.advance();
+        }
+        typename MaskedImageT::xy_locator loc = mimage.xy_at(1, j); // locator for data
+
+        for (int i = 1; i < ncol - 1; ++i, ++loc.x()) {
+            ImagePixel corr = 0;
+            if (!is_cr_pixel<MaskedImageT>(&corr, loc, noise, &overlay, i, j, minSigma,
+                                           thresH, thresV, thresD, bkgd, cond3Fac)) {
+                continue;
+            }
+/*
+ * condition #4
+ */
+            if (loc.mask() & badMask) {
+                continue;
+            }
+            if ((loc.mask(-1,  1) | loc.mask(0,  1) | loc.mask(1,  1) |
+                 loc.mask(-1,  0) |                   loc.mask(1,  0) |
+                 loc.mask(-1, -1) | loc.mask(0, -1) | loc.mask(1, -1)) & interpBit) {
+                continue;
+            }
+/*
+ * OK, it's a CR
+ *
+ * replace CR-contaminated pixels with reasonable values as we go through
+ * image, which increases the detection rate.  The values are kept in the overlay,
+ * so the image itself is untouched until we interpolate over the CRs
+ */
+            crpixels.push_back(CRPixel<ImagePixel>(i + mimage.getX0(), j + mimage.getY0(), loc.image()));
+            overlay.set(i, j, corr);    /* just a preliminary estimate */
+
+            if (static_cast<int>(crpixels.size()) > nCrPixelMax) {
+                throw LSST_EXCEPT(lsst::pex::exceptions::LengthError,
+                                  (boost::format("Too many CR pixels (max %d)") % nCrPixelMax).str());
+            }
+        }
+    }
+    candidatesTimer.stop();
+    LSST_MEAS_ALGORITHMS_COUNT("findCosmicRays.candidatePixels", crpixels.size());
+/*
+ * We've found them on a pixel-by-pixel basis, now merge those pixels
+ * into cosmic rays
+ */
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(mergeTimer, "findCosmicRays.merge");
+    mergeCrPixels(crpixels, mimage.getX0(), mimage.getY0()).swap(CRs);
+    mergeTimer.stop();
 /*
  * apply condition #1
  */
     CountsInCR<ImageT> CountDN(*mimage.getImage(), bkgd);
-    for (std::vector<detection::Footprint::Ptr>::iterator cr = CRs.begin(), end = CRs.end();
-         cr != end; ++cr) {
-        CountDN.apply(**cr);            // find the sum of pixel values within the CR
+    std::size_t nbright = 0;            // number of CRs that are bright enough
+    for (CrRunList::iterator cr = CRs.begin(); cr != CRs.end(); ++cr) {
+        applyToRuns(CountDN, *mimage.getImage(), *cr); // find the sum of pixel values within the CR
 
         pexLogging::TTrace<10>("algorithms.CR", "CR at (%d, %d) has %g DN",
-                               (*cr)->getBBox().getMinX(), (*cr)->getBBox().getMinY(), CountDN.getCounts());
+                               cr->front().x0 + mimage.getX0(), cr->front().y + mimage.getY0(),
+                               CountDN.getCounts());
         if (CountDN.getCounts() < minDn) { /* not bright enough */
             pexLogging::TTrace<11>("algorithms.CR", "Erasing CR");
-
-            cr = CRs.erase(cr);
-            --cr;                       // back up to previous CR (we're going to increment it)
-            --end;
+            continue;
         }
+        CRs[nbright++].swap(*cr);
     }
-    ncr = CRs.size();           /* some may have been too faint */
+    CRs.resize(nbright);
 /*
  * We've found them all, time to kill them all
  */
     bool const debias_values = true;
     bool grow = false;
     pexLogging::TTrace<2>("algorithms.CR", "Removing initial list of CRs");
-    removeCR(mimage, CRs, bkgd, crBit, saturBit, badMask, debias_values, grow);
+    {
+        LSST_MEAS_ALGORITHMS_SCOPED_TIMER(removeTimer, "findCosmicRays.remove");
+        removeCR(mimage, CRs, bkgd, crBit, saturBit, badMask, debias_values, grow);
+    }
 #if 0                                   // Useful to see phase 2 in ds9; debugging only
-    (void)setMaskFromFootprintList(mimage.getMask().get(), CRs,
-                                   mimage.getMask()->getPlaneBitMask("DETECTED"));
+    setMaskFromRuns(*mimage.getMask(), CRs, mimage.getMask()->getPlaneBitMask("DETECTED"));
 #endif
 /*
  * Now that we've removed them, go through image again, examining area around
@@ -631,29 +976,21 @@ findCosmicRays(MaskedImageT &mimage,      ///< Image to search
  */
     bool too_many_crs = false;          // we've seen too many CR pixels
     int nextra = 0;                     // number of pixels added to list of CRs
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(growTimer, "findCosmicRays.grow");
     for (int i = 0; i != niteration && !too_many_crs; ++i) {
         pexLogging::TTrace<1>("algorithms.CR", "Starting iteration %d", i);
-        for (std::vector<detection::Footprint::Ptr>::iterator fiter = CRs.begin();
-             fiter != CRs.end(); fiter++) {
-            detection::Footprint::Ptr cr = *fiter;
+        for (CrRunList::iterator cr = CRs.begin(); cr != CRs.end(); ++cr) {
 /*
  * Are all those `CR' pixels interpolated?  If so, don't grow it
  */
-            {
-                detection::Footprint::Ptr om = footprintAndMask(cr, mimage.getMask(), interpBit);
-                int const npix = (om) ? om->getNpix() : 0;
-
-                if (npix == cr->getNpix()) {
-                    continue;
-                }
+            if (allMasked(*cr, *mimage.getMask(), interpBit)) {
+                continue;
             }
 /*
  * No; some of the suspect pixels aren't interpolated
  */
-            detection::Footprint extra;                     // extra pixels added to cr
-            for (detection::Footprint::SpanList::const_iterator siter = cr->getSpans().begin();
-                 siter != cr->getSpans().end(); siter++) {
-                detection::Span::Ptr const span = *siter;
+            CrRuns extra;                                   // extra pixels added to cr
+            for (CrRuns::const_iterator run = cr->begin(); run != cr->end(); ++run) {
 
                 /*
                  * Check the lines above and below the span.  We're going to check a 3x3 region around
@@ -661,37 +998,29 @@ findCosmicRays(MaskedImageT &mimage,      ///< Image to search
                  * left/right of the span, so the buffer needs to be 2 pixels (not just 1) in the
                  * column direction, but only 1 in the row direction.
                  */
-                int const y = span->getY() - mimage.getY0();
+                int const y = run->y;
                 if (y < 2 || y >= nrow - 2) {
                     continue;
                 }
-                int x0 = span->getX0() - mimage.getX0();
-                int x1 = span->getX1() - mimage.getX0();
+                int x0 = run->x0;
+                int x1 = run->x1;
                 x0 = (x0 < 2) ? 2 : (x0 > ncol - 3) ? ncol - 3 : x0;
                 x1 = (x1 < 2) ? 2 : (x1 > ncol - 3) ? ncol - 3 : x1;
 
-                checkSpanForCRs(&extra, crpixels, y - 1, x0, x1, mimage,
-                                minSigma/2, thresH, thresV, thresD, bkgd, 0, keep);
-                checkSpanForCRs(&extra, crpixels, y,     x0, x1, mimage,
-                                minSigma/2, thresH, thresV, thresD, bkgd, 0, keep);
-                checkSpanForCRs(&extra, crpixels, y + 1, x0, x1, mimage,
+                checkSpanForCRs(&extra, crpixels, y - 1, y + 1, x0, x1, mimage,
                                 minSigma/2, thresH, thresV, thresD, bkgd, 0, keep);
             }
 
-            if (extra.getSpans().size() > 0) {      // we added some pixels
+            if (!extra.empty()) {                   // we added some pixels
                 if (nextra + static_cast<int>(crpixels.size()) > nCrPixelMax) {
                     too_many_crs = true;
                     break;
                 }
 
-                nextra += extra.getNpix();
+                nextra += countPixels(extra);
 
-                detection::Footprint::SpanList &espans = extra.getSpans();
-                for (detection::Footprint::SpanList::const_iterator siter = espans.begin();
-                     siter != espans.end(); siter++) {
-                    cr->addSpan(**siter);
-                }
-                cr->normalize();
+                cr->insert(cr->end(), extra.begin(), extra.end());
+                normalizeRuns(*cr);
             }
         }
 
@@ -699,11 +1028,14 @@ findCosmicRays(MaskedImageT &mimage,      ///< Image to search
             break;
         }
     }
+    growTimer.stop();
+    LSST_MEAS_ALGORITHMS_COUNT("findCosmicRays.extraPixels", nextra);
+    LSST_MEAS_ALGORITHMS_COUNT("findCosmicRays.crs", CRs.size());
 /*
  * mark those pixels as CRs
  */
     if (!too_many_crs) {
-        (void)setMaskFromFootprintList(mimage.getMask().get(), CRs, crBit);
+        setMaskFromRuns(*mimage.getMask(), CRs, crBit);
     }
 /*
  * Maybe reinstate initial values; n.b. the same pixel may appear twice, so we want the
@@ -731,21 +1063,263 @@ findCosmicRays(MaskedImageT &mimage,      ///< Image to search
         if (true || nextra > 0) {
             grow = true;
             pexLogging::TTrace<2>("algorithms.CR", "Removing final list of CRs, grow = %d", grow);
+            LSST_MEAS_ALGORITHMS_SCOPED_TIMER(removeTimer, "findCosmicRays.remove");
             removeCR(mimage, CRs, bkgd, crBit, saturBit, badMask, debias_values, grow);
         }
 /*
  * we interpolated over all CR pixels, so set the interp bits too
  */
-        (void)setMaskFromFootprintList(mimage.getMask().get(), CRs,
-                                       static_cast<MaskPixel>(crBit | interpBit));
+        setMaskFromRuns(*mimage.getMask(), CRs, static_cast<MaskPixel>(crBit | interpBit));
     }
 
     if (too_many_crs) {                 // we've cleaned up, so we can throw the exception
         throw LSST_EXCEPT(lsst::pex::exceptions::LengthError,
                           (boost::format("Too many CR pixels (max %d)") % nCrPixelMax).str());
     }
+}
 
-    return CRs;
+}
+
+/*!
+ * @brief Find cosmic rays in an Image, and mask and remove them
+ *
+ * @return vector of CR's Footprints
+ */
+template <typename MaskedImageT>
+std::vector<detection::Footprint::Ptr>
+findCosmicRays(MaskedImageT &mimage,      ///< Image to search
+               detection::Psf const &psf, ///< the Image's PSF
+               double const bkgd,         ///< unsubtracted background of frame, DN
+               lsst::pex::policy::Policy const &policy, ///< Policy directing the behavior
+               bool const keep                          ///< if true, don't remove the CRs
+              ) {
+    CrRunList CRs;
+    findCrRuns(CRs, mimage, psf, bkgd, policy, keep);
+    return makeFootprints(CRs, mimage.getX0(), mimage.getY0());
+}
+
+/*!
+ * @brief Find cosmic rays in an Image, and mask and remove them, without making a Footprint for each
+ *
+ * The image and its mask are modified exactly as by findCosmicRays, but the CRs are only held
+ * internally as runs of pixels, so this is cheaper when there are many CRs and the caller
+ * only wants the mask bits and the cleaned pixels.
+ *
+ * @return the number of CRs, and of pixels in them
+ */
+template <typename MaskedImageT>
+CosmicRayStatistics
+findCosmicRaysMaskOnly(MaskedImageT &mimage,      ///< Image to search
+                       detection::Psf const &psf, ///< the Image's PSF
+                       double const bkgd,         ///< unsubtracted background of frame, DN
+                       lsst::pex::policy::Policy const &policy, ///< Policy directing the behavior
+                       bool const keep                          ///< if true, don't remove the CRs
+                      ) {
+    CrRunList CRs;
+    findCrRuns(CRs, mimage, psf, bkgd, policy, keep);
+
+    CosmicRayStatistics stats;
+    stats.nCr = CRs.size();
+    for (CrRunList::const_iterator cr = CRs.begin(); cr != CRs.end(); ++cr) {
+        stats.nPixel += countPixels(*cr);
+    }
+    return stats;
+}
+
+/*!
+ * @brief Find cosmic rays in a pair of snaps of the same field, and mask and remove them
+ *
+ * A pixel is contaminated in the snap in which it is brighter if the snaps differ there by more than
+ * minSigma times the standard deviation of their difference (or by more than -minSigma DN if minSigma
+ * is negative).  The difference is no guide next to saturated pixels, whose values are clipped, so there
+ * the single-image tests used by findCosmicRays are applied to each snap instead.
+ *
+ * The contaminated pixels in each snap are merged into cosmic rays just as in findCosmicRays; CRs whose
+ * excess over the other snap is less than min_DN are discarded, and the rest are masked and (unless
+ * keep is true) interpolated over.  The contaminated pixels are found directly, so there is no
+ * search for extra pixels around each CR.
+ *
+ * @return the CRs found in snap0 and in snap1
+ *
+ * @throw lsst::pex::exceptions::LengthError if the snaps' dimensions differ, or if either snap has more
+ * than nCrPixelMax contaminated pixels (in which case neither snap is changed)
+ */
+template <typename MaskedImageT>
+std::pair<std::vector<detection::Footprint::Ptr>, std::vector<detection::Footprint::Ptr> >
+findCosmicRaysInSnaps(MaskedImageT &snap0,       ///< First snap to search
+                      MaskedImageT &snap1,       ///< Second snap to search
+                      detection::Psf const &psf, ///< the snaps' PSF
+                      double const bkgd,         ///< unsubtracted background of the snaps, DN
+                      lsst::pex::policy::Policy const &policy, ///< Policy directing the behavior
+                      bool const keep                          ///< if true, don't remove the CRs
+                     ) {
+    typedef typename MaskedImageT::Image::Pixel ImagePixel;
+    typedef typename MaskedImageT::Mask::Pixel MaskPixel;
+    typedef typename interp::PixelArithmetic<ImagePixel>::Working Working;
+
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(totalTimer, "findCosmicRaysInSnaps");
+
+    if (snap0.getDimensions() != snap1.getDimensions()) {
+        throw LSST_EXCEPT(lsst::pex::exceptions::LengthError,
+                          (boost::format("Snaps have different dimensions: %dx%d v. %dx%d") %
+                           snap0.getWidth() % snap0.getHeight() %
+                           snap1.getWidth() % snap1.getHeight()).str());
+    }
+
+    // Parse the Policy
+    double const minSigma = policy.getDouble("minSigma");    // min sigma over sky in pixel for CR candidate
+    double const minDn = policy.getDouble("min_DN");         // min number of DN in an CRs
+    double const cond3Fac = policy.getDouble("cond3_fac");   // fiddle factor for condition #3
+    double const cond3Fac2 = policy.getDouble("cond3_fac2"); // 2nd fiddle factor for condition #3
+    int const nCrPixelMax = policy.getInt("nCrPixelMax");    // maximum number of contaminated pixels
+
+    double thresH, thresV, thresD;
+    getCond3Thresholds(psf, afw::geom::Point2D(snap0.getWidth() / 2.0, snap0.getHeight() / 2.0),
+                       cond3Fac2, &thresH, &thresV, &thresD);
+
+    MaskPixel const badBit = snap0.getMask()->getPlaneBitMask("BAD"); // Generic bad pixels
+    MaskPixel const crBit = snap0.getMask()->getPlaneBitMask("CR"); // CR-contaminated pixels
+    MaskPixel const interpBit = snap0.getMask()->getPlaneBitMask("INTRP"); // Interpolated pixels
+    MaskPixel const saturBit = snap0.getMask()->getPlaneBitMask("SAT"); // Saturated pixels
+    MaskPixel const nodataBit = snap0.getMask()->getPlaneBitMask("NO_DATA"); // Non data pixels
+
+    MaskPixel const badMask = (badBit | interpBit | saturBit | nodataBit); // naughty pixels
+
+    MaskedImageT *snaps[2] = {&snap0, &snap1};
+    int const ncol = snap0.getWidth();
+    int const nrow = snap0.getHeight();
+    int const imageX0 = snap0.getX0();
+    int const imageY0 = snap0.getY0();
+/*
+ * Compare the snaps pixel by pixel
+ */
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(candidatesTimer, "findCosmicRaysInSnaps.candidates");
+    std::vector<CRPixel<ImagePixel> > crpixels[2]; // storage for CR-contaminated pixels in each snap
+    std::vector<int> brighter(ncol);               // 1 (-1) if snap0 (snap1) is significantly brighter
+    std::vector<MaskPixel> saturCols(ncol);        // SAT bits in this column, in this row and those adjoining
+    double const nSigma2 = minSigma*minSigma;
+    // noise in the rows around row y of each snap; only read for rows with ambiguous pixels
+    NoiseRows<MaskedImageT> noise0(snap0, 1, ncol - 2);
+    NoiseRows<MaskedImageT> noise1(snap1, 1, ncol - 2);
+    NoiseRows<MaskedImageT> *noise[2] = {&noise0, &noise1};
+    int noiseY = -1;                                // the row that noise was last loaded for
+
+    for (int y = 0; y != nrow; ++y) {
+        typename MaskedImageT::Image::x_iterator const im0 = snap0.getImage()->row_begin(y);
+        typename MaskedImageT::Image::x_iterator const im1 = snap1.getImage()->row_begin(y);
+        typename MaskedImageT::Variance::x_iterator const var0 = snap0.getVariance()->row_begin(y);
+        typename MaskedImageT::Variance::x_iterator const var1 = snap1.getVariance()->row_begin(y);
+        // the comparison is written without branches so that the compiler can vectorise it
+        for (int x = 0; x != ncol; ++x) {
+            Working const diff = static_cast<Working>(im0[x]) - im1[x];
+            double const thres2 = (minSigma < 0) ? nSigma2 : nSigma2*(var0[x] + var1[x]);
+            brighter[x] = (diff*diff > thres2)*((diff > 0) - (diff < 0));
+        }
+
+        typename MaskedImageT::Mask::x_iterator const mask0 = snap0.getMask()->row_begin(y);
+        typename MaskedImageT::Mask::x_iterator const mask1 = snap1.getMask()->row_begin(y);
+        for (int x = 0; x != ncol; ++x) {
+            saturCols[x] = mask0[x] | mask1[x];
+        }
+        for (int dy = -1; dy <= 1; dy += 2) {
+            if (y + dy >= 0 && y + dy < nrow) {
+                typename MaskedImageT::Mask::x_iterator const adj0 = snap0.getMask()->row_begin(y + dy);
+                typename MaskedImageT::Mask::x_iterator const adj1 = snap1.getMask()->row_begin(y + dy);
+                for (int x = 0; x != ncol; ++x) {
+                    saturCols[x] |= adj0[x] | adj1[x];
+                }
+            }
+        }
+        for (int x = 0; x != ncol; ++x) {
+            saturCols[x] &= saturBit;
+        }
+
+        for (int x = 0; x != ncol; ++x) {
+            if ((mask0[x] | mask1[x]) & badMask) {
+                continue;
+            }
+            bool const nearSaturated = (x > 0 && saturCols[x - 1]) || saturCols[x] ||
+                                       (x < ncol - 1 && saturCols[x + 1]);
+            if (!nearSaturated) {
+                if (brighter[x] != 0) {
+                    int const k = (brighter[x] > 0) ? 0 : 1;
+                    crpixels[k].push_back(CRPixel<ImagePixel>(x + imageX0, y + imageY0,
+                                                              (k == 0) ? im0[x] : im1[x]));
+                }
+            } else if (x > 0 && x < ncol - 1 && y > 0 && y < nrow - 1) {
+                // The difference is ambiguous; look at the morphology in each snap
+                if (noiseY != y) {              // first ambiguous pixel in this row
+                    for (int k = 0; k != 2; ++k) {
+                        if (noiseY == y - 1) {
+                            noise[k]->advance();
+                        } else {
+                            noise[k]->reset(y);
+                        }
+                    }
+                    noiseY = y;
+                }
+                for (int k = 0; k != 2; ++k) {
+                    ImagePixel corr = 0;
+                    if (is_cr_pixel<MaskedImageT>(&corr, snaps[k]->xy_at(x, y), *noise[k], NULL, x, y,
+                                                  minSigma, thresH, thresV, thresD, bkgd, cond3Fac)) {
+                        crpixels[k].push_back(CRPixel<ImagePixel>(x + imageX0, y + imageY0,
+                                                                  (k == 0) ? im0[x] : im1[x]));
+                    }
+                }
+            }
+        }
+
+        for (int k = 0; k != 2; ++k) {
+            if (static_cast<int>(crpixels[k].size()) > nCrPixelMax) {
+                throw LSST_EXCEPT(lsst::pex::exceptions::LengthError,
+                                  (boost::format("Too many CR pixels (max %d)") % nCrPixelMax).str());
+            }
+        }
+    }
+    candidatesTimer.stop();
+    LSST_MEAS_ALGORITHMS_COUNT("findCosmicRaysInSnaps.candidatePixels",
+                               crpixels[0].size() + crpixels[1].size());
+/*
+ * Merge the pixels into CRs, and apply condition #1 to the excess over the other snap
+ */
+    CrRunList CRs[2];
+    for (int k = 0; k != 2; ++k) {
+        CrRunList const candidates = mergeCrPixels(crpixels[k], imageX0, imageY0);
+        typename MaskedImageT::Image const &image = *snaps[k]->getImage();
+        typename MaskedImageT::Image const &other = *snaps[1 - k]->getImage();
+
+        for (CrRunList::const_iterator cr = candidates.begin(); cr != candidates.end(); ++cr) {
+            double excess = 0.0;
+            for (CrRuns::const_iterator run = cr->begin(); run != cr->end(); ++run) {
+                typename MaskedImageT::Image::x_iterator ptr = image.x_at(run->x0, run->y);
+                typename MaskedImageT::Image::x_iterator optr = other.x_at(run->x0, run->y);
+                for (int x = run->x0; x <= run->x1; ++x, ++ptr, ++optr) {
+                    excess += static_cast<Working>(*ptr) - *optr;
+                }
+            }
+            if (excess >= minDn) {
+                CRs[k].push_back(*cr);
+            }
+        }
+    }
+    LSST_MEAS_ALGORITHMS_COUNT("findCosmicRaysInSnaps.crs", CRs[0].size() + CRs[1].size());
+/*
+ * Mask the CRs, and maybe interpolate over them
+ */
+    bool const debias_values = true;
+    bool const grow = true;
+    for (int k = 0; k != 2; ++k) {
+        if (keep) {
+            setMaskFromRuns(*snaps[k]->getMask(), CRs[k], crBit);
+        } else {
+            LSST_MEAS_ALGORITHMS_SCOPED_TIMER(removeTimer, "findCosmicRaysInSnaps.remove");
+            removeCR(*snaps[k], CRs[k], bkgd, crBit, saturBit, badMask, debias_values, grow);
+            setMaskFromRuns(*snaps[k]->getMask(), CRs[k], static_cast<MaskPixel>(crBit | interpBit));
+        }
+    }
+
+    return std::make_pair(makeFootprints(CRs[0], imageX0, imageY0),
+                          makeFootprints(CRs[1], imageX0, imageY0));
 }
 
 /*****************************************************************************/
@@ -820,10 +1394,11 @@ public:
                     int y                                  // row-position of pixel
                    ) {
         typedef typename MaskedImageT::Image::Pixel MImagePixel;
-        MImagePixel min = std::numeric_limits<MImagePixel>::max();
+        typedef typename interp::PixelArithmetic<MImagePixel>::Working Working;
+        Working min = std::numeric_limits<Working>::max();
         int ngood = 0;          // number of good values on min
 
-        MImagePixel const minval = _bkgd - 2*sqrt(loc.variance()); // min. acceptable pixel value after interp
+        Working const minval = _bkgd - 2*sqrt(loc.variance()); // min. acceptable pixel value after interp
 /*
  * W-E row
  */
@@ -837,7 +1412,7 @@ public:
                 MImagePixel const v_p1 = loc.image( 1, 0);
                 MImagePixel const v_p2 = loc.image( 2, 0);
 
-                MImagePixel const tmp =
+                Working const tmp =
                     interp::lpc_1_c1*(v_m1 + v_p1) + interp::lpc_1_c2*(v_m2 + v_p2);
 
                 if (tmp > minval && tmp < min) {
@@ -859,7 +1434,7 @@ public:
                 MImagePixel const v_p1 = loc.image(0,  1);
                 MImagePixel const v_p2 = loc.image(0,  2);
 
-                MImagePixel const tmp =
+                Working const tmp =
                     interp::lpc_1_c1*(v_m1 + v_p1) + interp::lpc_1_c2*(v_m2 + v_p2);
 
                 if (tmp > minval && tmp < min) {
@@ -881,7 +1456,7 @@ public:
                 MImagePixel const v_p1 = loc.image( 1,  1);
                 MImagePixel const v_p2 = loc.image( 2,  2);
 
-                MImagePixel const tmp =
+                Working const tmp =
                     interp::lpc_1s2_c1*(v_m1 + v_p1) + interp::lpc_1s2_c2*(v_m2 + v_p2);
 
                 if (tmp > minval && tmp < min) {
@@ -903,7 +1478,7 @@ public:
                 MImagePixel const v_p1 = loc.image(-1,  1);
                 MImagePixel const v_p2 = loc.image(-2,  2);
 
-                MImagePixel const tmp =
+                Working const tmp =
                     interp::lpc_1s2_c1*(v_m1 + v_p1) + interp::lpc_1s2_c2*(v_m2 + v_p2);
 
                 if (tmp > minval && tmp < min) {
@@ -935,7 +1510,7 @@ public:
                 if (val_v.first) {
                     min = val_h.second;
                 } else {
-                    min = (val_v.second + val_h.second)/2;
+                    min = (static_cast<Working>(val_v.second) + val_h.second)/2;
                 }
             }
         }
@@ -955,7 +1530,7 @@ public:
             min -= interp::min2GaussianBias*sqrt(loc.variance())*_rand.gaussian();
         }
 
-        loc.image() = min;
+        loc.image() = interp::PixelArithmetic<MImagePixel>::convert(min);
     }
 private:
     double _bkgd;
@@ -971,7 +1546,7 @@ private:
  */
 template<typename ImageT, typename MaskT>
 void removeCR(image::MaskedImage<ImageT, MaskT> & mi,  // image to search
-              std::vector<detection::Footprint::Ptr> & CRs, // list of cosmic rays
+              CrRunList const & CRs, // list of cosmic rays
               double const bkgd, // non-subtracted background
               MaskT const , // Bit value used to label CRs
               MaskT const saturBit, // Bit value used to label saturated pixels
@@ -994,17 +1569,18 @@ void removeCR(image::MaskedImage<ImageT, MaskT> & mi,  // image to search
     // a functor to remove a CR
     RemoveCR<image::MaskedImage<ImageT, MaskT> > removeCR(mi, bkgd, badMask, debias, rand); 
 
-    for (std::vector<detection::Footprint::Ptr>::reverse_iterator fiter = CRs.rbegin();
-         fiter != CRs.rend(); ++fiter) {
-        detection::Footprint::Ptr cr = *fiter;
+    for (CrRunList::const_reverse_iterator fiter = CRs.rbegin(); fiter != CRs.rend(); ++fiter) {
+        CrRuns const & cr = *fiter;
 /*
  * If I grow this CR does it touch saturated pixels?  If so, don't
- * interpolate and add CR pixels to saturated mask
+ * interpolate and add CR pixels to saturated mask.  Only make a Footprint
+ * to grow if there are saturated pixels close enough to matter
  */
-        if (grow && cr->getNpix() < 100) {
+        if (grow && countPixels(cr) < 100 && nearMasked(cr, *mi.getMask(), saturBit)) {
             try {
                 bool const isotropic = false; // use a slow isotropic grow?
-                detection::Footprint::Ptr gcr = growFootprint(cr, 1, isotropic);
+                detection::Footprint::Ptr gcr = growFootprint(makeFootprint(cr, mi.getX0(), mi.getY0()),
+                                                              1, isotropic);
                 detection::Footprint::Ptr const saturPixels = footprintAndMask(gcr, mi.getMask(), saturBit);
 
              if (saturPixels->getNpix() > 0) { // pixel is adjacent to a saturation trail
@@ -1019,7 +1595,7 @@ void removeCR(image::MaskedImage<ImageT, MaskT> & mi,  // image to search
 /*
  * OK, fix it
  */
-        removeCR.apply(*cr);
+        applyToRuns(removeCR, mi, cr);
     }
 }
 }
@@ -1036,9 +1612,28 @@ void removeCR(image::MaskedImage<ImageT, MaskT> & mi,  // image to search
                    double const bkgd,                           \
                    lsst::pex::policy::Policy const& policy,     \
                    bool const keep                              \
-                  )
+                  );                                            \
+    template \
+    CosmicRayStatistics \
+    findCosmicRaysMaskOnly(lsst::afw::image::MaskedImage<TYPE> &image,  \
+                           detection::Psf const &psf,                   \
+                           double const bkgd,                           \
+                           lsst::pex::policy::Policy const& policy,     \
+                           bool const keep                              \
+                          );                                            \
+    template \
+    std::pair<std::vector<detection::Footprint::Ptr>, std::vector<detection::Footprint::Ptr> > \
+    findCosmicRaysInSnaps(lsst::afw::image::MaskedImage<TYPE> &snap0,   \
+                          lsst::afw::image::MaskedImage<TYPE> &snap1,   \
+                          detection::Psf const &psf,                    \
+                          double const bkgd,                            \
+                          lsst::pex::policy::Policy const& policy,      \
+                          bool const keep                               \
+                         )
 
 INSTANTIATE(float);
 INSTANTIATE(double);                    // Why do we need double images?
+INSTANTIATE(boost::uint16_t);           // raw frames
+INSTANTIATE(int);
 // \endcond
 }}} // namespace lsst::meas::algorithms
@@ -26,6 +26,7 @@
  * Represent a PSF as for a Coadd based on the James Jee stacking
  * algorithm which was extracted from Stackfit.
  */
+#include <algorithm>
 #include <cmath>
 #include <sstream>
 #include <iostream>
@@ -38,6 +39,7 @@
 #include "lsst/afw/image/ImageUtils.h"
 #include "lsst/afw/math/Statistics.h"
 #include "lsst/meas/algorithms/CoaddPsf.h"
+#include "lsst/meas/algorithms/Instrumentation.h"
 #include "lsst/afw/table/io/OutputArchive.h"
 #include "lsst/afw/table/io/InputArchive.h"
 #include "lsst/afw/table/io/CatalogVector.h"
@@ -137,6 +139,51 @@ afw::geom::Point2D computeAveragePosition(
     return result.getPoint();
 }
 
+// Orders indices by decreasing weight
+struct WeightGreater {
+    explicit WeightGreater(std::vector<double> const & weights_) : weights(weights_) {}
+
+    bool operator()(std::size_t a, std::size_t b) const { return weights[a] > weights[b]; }
+
+    std::vector<double> const & weights;
+};
+
+/*
+ * Choose the components of subcat to combine, returning their indices; all of them, in order, if
+ * maxTruncatedWeightFraction is 0, otherwise the heaviest, in order of decreasing weight, until the
+ * weight left over is no more than maxTruncatedWeightFraction of the total.
+ *
+ * Returns the fraction of the weight left over.
+ */
+double selectComponents(
+    afw::table::ExposureCatalog const & subcat,
+    afw::table::Key<double> weightKey,
+    double maxTruncatedWeightFraction,
+    std::vector<std::size_t> & indices
+) {
+    std::size_t const n = subcat.size();
+    indices.resize(n);
+    std::vector<double> weights(n);
+    double weightSum = 0.0;
+    for (std::size_t i = 0; i < n; ++i) {
+        indices[i] = i;
+        weights[i] = subcat[i].get(weightKey);
+        weightSum += weights[i];
+    }
+    if (maxTruncatedWeightFraction <= 0.0 || weightSum <= 0.0) {
+        return 0.0;
+    }
+
+    std::stable_sort(indices.begin(), indices.end(), WeightGreater(weights));
+    double used = 0.0;
+    std::size_t nUsed = 0;
+    for (; nUsed < n && weightSum - used > maxTruncatedWeightFraction*weightSum; ++nUsed) {
+        used += weights[indices[nUsed]];
+    }
+    indices.resize(nUsed);
+    return (weightSum - used)/weightSum;
+}
+
 } // anonymous
 
 CoaddPsf::CoaddPsf(
@@ -148,7 +195,8 @@ CoaddPsf::CoaddPsf(
 ) :
     _coaddWcs(coaddWcs.clone()),
     _warpingKernelName(warpingKernelName),
-    _warpingControl(boost::make_shared<afw::math::WarpingControl>(warpingKernelName, "", cacheSize))
+    _warpingControl(boost::make_shared<afw::math::WarpingControl>(warpingKernelName, "", cacheSize)),
+    _maxTruncatedWeightFraction(0.0)
 {
     afw::table::SchemaMapper mapper(catalog.getSchema());
     mapper.addMinimalSchema(afw::table::ExposureTable::makeMinimalSchema(), true);
@@ -173,6 +221,19 @@ CoaddPsf::CoaddPsf(
     _averagePosition = computeAveragePosition(_catalog, *_coaddWcs, _weightKey);
 }
 
+CoaddPsf::CoaddPsf(CoaddPsf const & other) :
+    afw::table::io::PersistableFacade<CoaddPsf>(other),
+    ImagePsf(other),
+    _catalog(other._catalog),
+    _coaddWcs(other._coaddWcs),
+    _weightKey(other._weightKey),
+    _averagePosition(other._averagePosition),
+    _warpingKernelName(other._warpingKernelName),
+    _warpingControl(other._warpingControl),
+    _maxTruncatedWeightFraction(other._maxTruncatedWeightFraction),
+    _warpedPsfs()                       // the copy makes its own WarpedPsfs
+{}
+
 PTR(afw::detection::Psf) CoaddPsf::clone() const {
     return boost::make_shared<CoaddPsf>(*this);
 }
@@ -225,8 +286,10 @@ PTR(afw::detection::Psf::Image) CoaddPsf::doComputeKernelImage(
     afw::geom::Point2D const & ccdXY,
     afw::image::Color const & color
 ) const {
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "CoaddPsf.computeKernelImage");
     // Get the subset of expoures which contain our coordinate within their validPolygons.
     afw::table::ExposureCatalog subcat = _catalog.subsetContaining(ccdXY, *_coaddWcs, true);
+    LSST_MEAS_ALGORITHMS_COUNT("CoaddPsf.components", subcat.size());
     if (subcat.empty()) {
         throw LSST_EXCEPT(
             pex::exceptions::InvalidParameterError,
@@ -236,21 +299,32 @@ PTR(afw::detection::Psf::Image) CoaddPsf::doComputeKernelImage(
     }
     double weightSum = 0.0;
 
+    std::vector<std::size_t> indices;
+    selectComponents(subcat, _weightKey, _maxTruncatedWeightFraction, indices);
+    LSST_MEAS_ALGORITHMS_COUNT("CoaddPsf.truncatedComponents", subcat.size() - indices.size());
+
     // Read all the Psf images into a vector.  The code is set up so that this can be done in chunks,
     // with the image modified to accomodate
     // However, we currently read all of the images.
     std::vector<PTR(afw::image::Image<double>)> imgVector;
     std::vector<double> weightVector;
 
-    for (afw::table::ExposureCatalog::const_iterator i = subcat.begin(); i != subcat.end(); ++i) {
-        PTR(afw::geom::XYTransform) xytransform(
-            new afw::image::XYTransformFromWcsPair(_coaddWcs, i->getWcs())
-        );
-        WarpedPsf warpedPsf = WarpedPsf(i->getPsf(), xytransform, _warpingControl);
-        PTR(afw::image::Image<double>) componentImg = warpedPsf.computeKernelImage(ccdXY, color);
+    for (std::vector<std::size_t>::const_iterator iter = indices.begin(); iter != indices.end(); ++iter) {
+        afw::table::ExposureRecord const & record = subcat[*iter];
+        // Keep the WarpedPsfs, which remember the images of spatially constant components
+        WarpedPsfMap::key_type const key(record.getPsf().get(), record.getWcs().get());
+        WarpedPsfMap::iterator warpedPsf = _warpedPsfs.find(key);
+        if (warpedPsf == _warpedPsfs.end()) {
+            PTR(afw::geom::XYTransform) xytransform(
+                new afw::image::XYTransformFromWcsPair(_coaddWcs, record.getWcs())
+            );
+            PTR(WarpedPsf) psf = boost::make_shared<WarpedPsf>(record.getPsf(), xytransform, _warpingControl);
+            warpedPsf = _warpedPsfs.insert(std::make_pair(key, psf)).first;
+        }
+        PTR(afw::image::Image<double>) componentImg = warpedPsf->second->computeKernelImage(ccdXY, color);
         imgVector.push_back(componentImg);
-        weightSum += i->get(_weightKey);
-        weightVector.push_back(i->get(_weightKey));
+        weightSum += record.get(_weightKey);
+        weightVector.push_back(record.get(_weightKey));
     }
 
     afw::geom::Box2I bbox = getOverallBBox(imgVector);
@@ -267,6 +341,36 @@ int CoaddPsf::getComponentCount() const {
     return _catalog.size();
 }
 
+PTR(CoaddPsf) CoaddPsf::truncate(double maxTruncatedWeightFraction) const {
+    if (!(maxTruncatedWeightFraction >= 0.0 && maxTruncatedWeightFraction < 1.0)) {
+        throw LSST_EXCEPT(
+            pex::exceptions::InvalidParameterError,
+            (boost::format("Truncated weight fraction must be in [0, 1); saw %g")
+             % maxTruncatedWeightFraction).str()
+        );
+    }
+    // Not a copy, which would share the images cached by Psf
+    PTR(CoaddPsf) result(
+        new CoaddPsf(_catalog, _coaddWcs, _averagePosition, _warpingKernelName,
+                     _warpingControl->getCacheSize())
+    );
+    result->_maxTruncatedWeightFraction = maxTruncatedWeightFraction;
+    return result;
+}
+
+double CoaddPsf::computeTruncatedWeightFraction(afw::geom::Point2D const & ccdXY) const {
+    afw::table::ExposureCatalog subcat = _catalog.subsetContaining(ccdXY, *_coaddWcs, true);
+    if (subcat.empty()) {
+        throw LSST_EXCEPT(
+            pex::exceptions::InvalidParameterError,
+            (boost::format("Cannot compute CoaddPsf at point %s; no input images at that point.")
+             % ccdXY).str()
+        );
+    }
+    std::vector<std::size_t> indices;
+    return selectComponents(subcat, _weightKey, _maxTruncatedWeightFraction, indices);
+}
+
 CONST_PTR(afw::detection::Psf) CoaddPsf::getPsf(int index) {
     if (index < 0 || index > getComponentCount()) {
         throw LSST_EXCEPT(pex::exceptions::RangeError, "index of CoaddPsf component out of range");
@@ -406,7 +510,8 @@ CoaddPsf::CoaddPsf(
 ) :
     _catalog(catalog), _coaddWcs(coaddWcs), _weightKey(_catalog.getSchema()["weight"]),
     _averagePosition(averagePosition), _warpingKernelName(warpingKernelName),
-    _warpingControl(new afw::math::WarpingControl(warpingKernelName, "", cacheSize))
+    _warpingControl(new afw::math::WarpingControl(warpingKernelName, "", cacheSize)),
+    _maxTruncatedWeightFraction(0.0)
 {}
 
 }}} // namespace lsst::meas::algorithms
@@ -0,0 +1,161 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+#include "boost/format.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/afw/detection/Footprint.h"
+#include "lsst/meas/algorithms/DetectionMask.h"
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+
+namespace {
+
+typedef std::pair<int, int> Run;        // [first, second] columns, inclusive, in LOCAL coordinates
+
+/// OR bitmask into pixels [x0, x1] of row y (LOCAL coordinates)
+template <typename MaskPixelT>
+inline void orRun(afw::image::Mask<MaskPixelT> & mask, int y, int x0, int x1, MaskPixelT bitmask) {
+    typedef typename afw::image::Mask<MaskPixelT>::x_iterator x_iterator;
+    for (x_iterator ptr = mask.x_at(x0, y), end = mask.x_at(x1, y) + 1; ptr != end; ++ptr) {
+        *ptr |= bitmask;
+    }
+}
+
+} // anonymous namespace
+
+template <typename MaskPixelT>
+void setMaskFromGrownFootprints(
+    afw::image::Mask<MaskPixelT> & mask,
+    afw::detection::FootprintSet const & footprints,
+    int nGrow,
+    bool isotropic,
+    MaskPixelT bitmask
+) {
+    if (nGrow < 0) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          (boost::format("nGrow = %d < 0") % nGrow).str());
+    }
+    // Half-width of the structuring element in each row, indexed by dy + nGrow.
+    // The disk matches afw::detection::Footprint(center, radius).
+    std::vector<int> halfWidth(2*nGrow + 1);
+    for (int dy = -nGrow; dy <= nGrow; ++dy) {
+        halfWidth[dy + nGrow] = isotropic ?
+            static_cast<int>(std::sqrt(static_cast<double>(nGrow*nGrow - dy*dy))) : nGrow - std::abs(dy);
+    }
+
+    int const x0 = mask.getX0();
+    int const y0 = mask.getY0();
+    int const width = mask.getWidth();
+    int const height = mask.getHeight();
+
+    // Gather the runs of the dilated spans row by row, so overlapping runs are merged
+    // and each masked pixel is written once
+    std::vector<std::vector<Run> > rows(height);
+    CONST_PTR(afw::detection::FootprintSet::FootprintList) footprintList = footprints.getFootprints();
+    for (afw::detection::FootprintSet::FootprintList::const_iterator fiter = footprintList->begin();
+         fiter != footprintList->end(); ++fiter) {
+        afw::detection::Footprint::SpanList const & spans = (*fiter)->getSpans();
+        for (afw::detection::Footprint::SpanList::const_iterator siter = spans.begin();
+             siter != spans.end(); ++siter) {
+            afw::detection::Span const & span = **siter;
+            for (int dy = -nGrow; dy <= nGrow; ++dy) {
+                int const y = span.getY() + dy - y0;
+                if (y < 0 || y >= height) {
+                    continue;
+                }
+                int const hw = halfWidth[dy + nGrow];
+                int const begin = std::max(span.getX0() - hw - x0, 0);
+                int const end = std::min(span.getX1() + hw - x0, width - 1);
+                if (begin <= end) {
+                    rows[y].push_back(Run(begin, end));
+                }
+            }
+        }
+    }
+
+    for (int y = 0; y < height; ++y) {
+        std::vector<Run> & runs = rows[y];
+        if (runs.empty()) {
+            continue;
+        }
+        std::sort(runs.begin(), runs.end());
+        Run current = runs.front();
+        for (std::vector<Run>::const_iterator riter = runs.begin() + 1; riter != runs.end(); ++riter) {
+            if (riter->first <= current.second + 1) {
+                current.second = std::max(current.second, riter->second);
+            } else {
+                orRun(mask, y, current.first, current.second, bitmask);
+                current = *riter;
+            }
+        }
+        orRun(mask, y, current.first, current.second, bitmask);
+        std::vector<Run>().swap(runs);  // release memory as we go
+    }
+}
+
+template <typename MaskPixelT>
+void setMaskOutsideBox(
+    afw::image::Mask<MaskPixelT> & mask,
+    afw::geom::Box2I const & box,
+    MaskPixelT bitmask
+) {
+    int const width = mask.getWidth();
+    int const height = mask.getHeight();
+    // the box in LOCAL coordinates; if it lies outside the mask the whole mask is set
+    afw::geom::Box2I good(box);
+    good.shift(afw::geom::Extent2I(-mask.getX0(), -mask.getY0()));
+    good.clip(afw::geom::Box2I(afw::geom::Point2I(0, 0), afw::geom::Extent2I(width, height)));
+
+    for (int y = 0; y < height; ++y) {
+        if (good.isEmpty() || y < good.getMinY() || y > good.getMaxY()) {
+            orRun(mask, y, 0, width - 1, bitmask);
+            continue;
+        }
+        if (good.getMinX() > 0) {
+            orRun(mask, y, 0, good.getMinX() - 1, bitmask);
+        }
+        if (good.getMaxX() < width - 1) {
+            orRun(mask, y, good.getMaxX() + 1, width - 1, bitmask);
+        }
+    }
+}
+
+#define INSTANTIATE(MASKPIXEL) \
+    template void setMaskFromGrownFootprints<MASKPIXEL>( \
+        afw::image::Mask<MASKPIXEL> &, afw::detection::FootprintSet const &, int, bool, MASKPIXEL); \
+    template void setMaskOutsideBox<MASKPIXEL>( \
+        afw::image::Mask<MASKPIXEL> &, afw::geom::Box2I const &, MASKPIXEL);
+
+INSTANTIATE(afw::image::MaskPixel);
+
+}}} // namespace lsst::meas::algorithms
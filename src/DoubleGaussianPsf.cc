@@ -22,6 +22,8 @@
  */
 
 #include <cmath>
+#include <utility>
+#include <vector>
 
 #include "lsst/pex/exceptions.h"
 #include "lsst/afw/math/FunctionLibrary.h"
@@ -114,8 +116,70 @@ DoubleGaussianPsfFactory registration(getDoubleGaussianPsfPersistenceName());
 
 DoubleGaussianPsf::DoubleGaussianPsf(int width, int height, double sigma1, double sigma2, double b) :
     KernelPsf(makeDoubleGaussianKernel(width, height, sigma1, sigma2, b)),
-    _sigma1(sigma1), _sigma2(sigma2), _b(b)
-{}
+    _sigma1(sigma1), _sigma2(sigma2), _b(b),
+    _kernelImage(boost::make_shared<Image>(getKernel()->getDimensions()))
+{
+    getKernel()->computeImage(*_kernelImage, true);
+    _kernelImage->setXY0(-getKernel()->getCtrX(), -getKernel()->getCtrY());
+}
+
+PTR(afw::detection::Psf::Image) DoubleGaussianPsf::doComputeKernelImage(
+    afw::geom::Point2D const &, afw::image::Color const &
+) const {
+    return boost::make_shared<Image>(*_kernelImage, true);
+}
+
+/*
+ * The Psf is exp(-r^2/2 sigma1^2) + b exp(-r^2/2 sigma2^2) (see afw::math::DoubleGaussianFunction2),
+ * i.e. the sum of two separable terms, each of which is an outer product of 1-D Gaussians
+ */
+PTR(afw::detection::Psf::Image) DoubleGaussianPsf::doComputeImage(
+    afw::geom::Point2D const & position, afw::image::Color const &
+) const {
+    std::pair<int, double> const irX = afw::image::positionToIndex(position.getX(), true);
+    std::pair<int, double> const irY = afw::image::positionToIndex(position.getY(), true);
+    PTR(Image) image;
+    if (irX.second == 0.0 && irY.second == 0.0) {
+        image = boost::make_shared<Image>(*_kernelImage, true);
+    } else {
+        int const width = _kernelImage->getWidth();
+        int const height = _kernelImage->getHeight();
+        int const xCentre = getKernel()->getCtrX();
+        int const yCentre = getKernel()->getCtrY();
+        afw::math::GaussianFunction1<double> const gauss1(_sigma1);
+        std::vector<double> const x1 = sampleKernelFunction(gauss1, width, xCentre, irX.second);
+        std::vector<double> const y1 = sampleKernelFunction(gauss1, height, yCentre, irY.second);
+        std::vector<double> x2, y2;
+        double b = 0.0;                 // GaussianFunction1 is normalised, so rescale b to match
+        if (_b != 0.0) {                // the relative amplitudes of DoubleGaussianFunction2
+            afw::math::GaussianFunction1<double> const gauss2(_sigma2);
+            x2 = sampleKernelFunction(gauss2, width, xCentre, irX.second);
+            y2 = sampleKernelFunction(gauss2, height, yCentre, irY.second);
+            b = _b*(_sigma2*_sigma2)/(_sigma1*_sigma1);
+        }
+
+        image = boost::make_shared<Image>(_kernelImage->getDimensions());
+        double sum = 0.0;
+        for (int y = 0; y < height; ++y) {
+            Image::x_iterator ptr = image->row_begin(y);
+            if (b == 0.0) {
+                for (int x = 0; x < width; ++x, ++ptr) {
+                    *ptr = y1[y]*x1[x];
+                    sum += *ptr;
+                }
+            } else {
+                double const by2 = b*y2[y];
+                for (int x = 0; x < width; ++x, ++ptr) {
+                    *ptr = y1[y]*x1[x] + by2*x2[x];
+                    sum += *ptr;
+                }
+            }
+        }
+        *image /= sum;
+    }
+    image->setXY0(irX.first + _kernelImage->getX0(), irY.first + _kernelImage->getY0());
+    return image;
+}
     
 PTR(afw::detection::Psf) DoubleGaussianPsf::clone() const {
     return boost::make_shared<DoubleGaussianPsf>(
@@ -30,31 +30,156 @@
  * @ingroup algorithms
  */
 
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "boost/format.hpp"
+#include "Eigen/Core"
+#include "Eigen/LU"
+
+#include "lsst/utils/ieee.h"
+#include "lsst/pex/exceptions.h"
 #include "lsst/afw.h"
 #include "lsst/meas/algorithms/ImagePca.h"
+#include "lsst/meas/algorithms/Instrumentation.h"
 
 namespace lsst {
 namespace meas {
 namespace algorithms {
 
+namespace {
+
+// Images without a mask plane have no bad pixels
+template <typename PixelT>
+void findBadPixels(afw::image::Image<PixelT> const &, unsigned long, std::vector<int> & indices)
+{
+    indices.clear();
+}
+
+template <typename PixelT>
+void findBadPixels(afw::image::MaskedImage<PixelT> const & mimage, unsigned long mask,
+                   std::vector<int> & indices)
+{
+    typedef afw::image::Mask<afw::image::MaskPixel> MaskT;
+
+    indices.clear();
+    MaskT const & msk = *mimage.getMask();
+    int const width = msk.getWidth();
+    for (int y = 0; y != msk.getHeight(); ++y) {
+        int x = 0;
+        for (typename MaskT::const_x_iterator ptr = msk.row_begin(y), end = msk.row_end(y);
+             ptr != end; ++ptr, ++x) {
+            if (*ptr & mask) {
+                indices.push_back(x + y*width);
+            }
+        }
+    }
+}
+
+/*
+ * Add an image's contributions to the inverse-variance weighted mean of the flux-normalised good pixels
+ * at the listed pixels, as afw::image::ImagePca::updateBadPixels computes it.  Images without a mask
+ * plane have no bad pixels, so never need it
+ */
+template <typename PixelT>
+void accumulateMean(afw::image::Image<PixelT> const &, double, unsigned long, std::vector<int> const &,
+                    std::vector<PixelT> &, std::vector<float> &)
+{
+}
+
+template <typename PixelT>
+void accumulateMean(afw::image::MaskedImage<PixelT> const & mimage, double flux, unsigned long mask,
+                    std::vector<int> const & pixels, std::vector<PixelT> & mean, std::vector<float> & weight)
+{
+    typename afw::image::MaskedImage<PixelT>::Image const & image = *mimage.getImage();
+    typename afw::image::MaskedImage<PixelT>::Mask const & msk = *mimage.getMask();
+    typename afw::image::MaskedImage<PixelT>::Variance const & variance = *mimage.getVariance();
+    int const width = mimage.getWidth();
+    for (std::size_t j = 0; j != pixels.size(); ++j) {
+        int const x = pixels[j]%width, y = pixels[j]/width;
+        if (!(msk(x, y) & mask) && variance(x, y) > 0.0) {
+            PixelT const value = image(x, y)/flux;
+            float const var = variance(x, y)/(flux*flux);
+            float const ivar = 1.0/var;
+
+            if (lsst::utils::isfinite(value*ivar)) {
+                mean[j] += value*ivar;
+                weight[j] += ivar;
+            }
+        }
+    }
+}
+
+/*
+ * Return the median of values, which are reordered.  For an even number of values this is the mean of
+ * the two central values, as for afw::math::Statistics' MEDIAN
+ */
+double median(std::vector<double> & values)
+{
+    std::size_t const n = values.size();
+    std::vector<double>::iterator const mid = values.begin() + n/2;
+    std::nth_element(values.begin(), mid, values.end());
+    if (n%2 == 1) {
+        return *mid;
+    }
+    return 0.5*(*mid + *std::max_element(values.begin(), mid));
+}
+
+} // anonymous namespace
+
 template <typename ImageT>
 void PsfImagePca<ImageT>::analyze()
 {
+    typedef typename afw::image::GetImage<ImageT>::type PlaneT;
+
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "PsfImagePca.analyze");
+    LSST_MEAS_ALGORITHMS_COUNT("PsfImagePca.stamps", this->getImageList().size());
     Super::analyze();
 
+    std::vector<double> edgePixels;     // reused for each eigen image
     typename Super::ImageList const &eImageList = this->getEigenImages();
     typename Super::ImageList::const_iterator iter = eImageList.begin(), end = eImageList.end();
     for (size_t i = 0; iter != end; ++i, ++iter) {
         PTR(ImageT) eImage = *iter;
+        // If ImageT is a MaskedImage, unpack the Image
+        typename PlaneT::Ptr eImageIm = afw::image::GetImage<ImageT>::getImage(eImage);
+        int const height = eImageIm->getHeight();
+        int const width = eImageIm->getWidth();
+
+        /*
+         * Find the extrema and, for the i > 0 eigen images, gather the pixels used to estimate the
+         * background (the edge pixels, or all pixels if the border would consume the image) in a
+         * single pass
+         */
+        bool const subtractBackground = (i > 0 && _border > 0);
+        bool const useAll = (2*_border >= std::min(height, width));
+        edgePixels.clear();
+        double min = std::numeric_limits<double>::infinity();
+        double max = -std::numeric_limits<double>::infinity();
+        for (int y = 0; y != height; ++y) {
+            bool const edgeRow = useAll || y < _border || y >= height - _border;
+            int x = 0;
+            for (typename PlaneT::x_iterator ptr = eImageIm->row_begin(y), rowEnd = eImageIm->row_end(y);
+                 ptr != rowEnd; ++ptr, ++x) {
+                double const value = *ptr;
+                if (value < min) {
+                    min = value;
+                }
+                if (value > max) {
+                    max = value;
+                }
+                if (subtractBackground && (edgeRow || x < _border || x >= width - _border)) {
+                    edgePixels.push_back(value);
+                }
+            }
+        }
 
         /*
          * Normalise eigenImages to have a maximum of 1.0.  For n > 0 they
          * (should) have mean == 0, so we can't use that to normalize
          */
-        afw::math::Statistics stats = afw::math::makeStatistics(*eImage, (afw::math::MIN | afw::math::MAX));
-        double const min = stats.getValue(afw::math::MIN);
-        double const max = stats.getValue(afw::math::MAX);
-
         double const extreme = (fabs(min) > max) ? min :max;
         if (extreme != 0.0) {
             *eImage /= extreme;
@@ -69,57 +194,135 @@ void PsfImagePca<ImageT>::analyze()
          * It is not at all clear that doing this is a good idea; it'd be
          * better to get the sky level right in the first place.
          */
-        if (i > 0 && _border > 0) {                 /* not the zeroth KL component */
-            int const height = eImage->getHeight();
-            int const width = eImage->getWidth();
-            double background;
-            if (2*_border >= std::min(height, width)) {
-                // _Border consumes the entire image
-                background = afw::math::makeStatistics(*afw::image::GetImage<ImageT>::getImage(eImage),
-                                                       afw::math::MEDIAN).getValue();
-            } else {
-                // Use the median of the edge pixels
-
-                // If ImageT is a MaskedImage, unpack the Image
-                typename afw::image::GetImage<ImageT>::type::Ptr eImageIm =
-                    afw::image::GetImage<ImageT>::getImage(eImage);
+        if (subtractBackground && !edgePixels.empty()) {
+            // The pixels were gathered before normalisation, so scale their median to match
+            double const background = median(edgePixels)/((extreme != 0.0) ? extreme : 1.0);
+            *eImage -= background;
+        }
+    }
+    /*
+     * Save the final eigen images as a basis, and their inner products, for updateBadPixels' fits
+     */
+    int const nComp = eImageList.size();
+    int const nPix = nComp ? eImageList[0]->getWidth()*eImageList[0]->getHeight() : 0;
+    _basis.resize(nPix, nComp);
+    for (int k = 0; k != nComp; ++k) {
+        PlaneT const &eImage = *afw::image::GetImage<ImageT>::getImage(eImageList[k]);
+        for (int y = 0, j = 0; y != eImage.getHeight(); ++y) {
+            for (typename PlaneT::const_x_iterator ptr = eImage.row_begin(y), end = eImage.row_end(y);
+                 ptr != end; ++ptr, ++j) {
+                _basis(j, k) = *ptr;
+            }
+        }
+    }
+    _normal = _basis.transpose()*_basis;
+}
 
-                int const nEdge = width*height - (width - 2*_border)*(height - 2*_border);
-                std::vector<double> edgePixels(nEdge);
+template <typename ImageT>
+double PsfImagePca<ImageT>::updateBadPixels(unsigned long mask, int const ncomp)
+{
+    typedef typename afw::image::GetImage<ImageT>::type PlaneT;
 
-                std::vector<double>::iterator bi = edgePixels.begin();
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "PsfImagePca.updateBadPixels");
+    typename Super::ImageList const &imageList = this->getImageList();
+    int const nImage = imageList.size();
+    if (nImage == 0) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError, "Please provide at least one Image for me to update");
+    }
+    if (ncomp > 0 && ncomp > static_cast<int>(this->getEigenImages().size())) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("You only have %d eigen images (you asked for %d)")
+                           % this->getEigenImages().size() % ncomp).str());
+    }
+    if (static_cast<int>(_badPixels.size()) != nImage || mask != _badPixelMask) {
+        _badPixels.resize(nImage);
+        for (int i = 0; i != nImage; ++i) {
+            findBadPixels(*imageList[i], mask, _badPixels[i]);
+        }
+        _badPixelMask = mask;
+    }
 
-                typedef typename afw::image::GetImage<ImageT>::type::x_iterator imIter;
-                int y = 0;
-                for (; y != _border; ++y) {   // Bottom border of eImage
-                    for (imIter ptr = eImageIm->row_begin(y),
-                             end = eImageIm->row_end(y); ptr != end; ++ptr, ++bi) {
-                        *bi = *ptr;
-                    }
-                }
-                for (; y != height - _border; ++y) {   // Left and right borders of eImage
-                    for (imIter ptr = eImageIm->row_begin(y),
-                             end = eImageIm->x_at(_border, y); ptr != end; ++ptr, ++bi) {
-                        *bi = *ptr;
-                    }
-                    for (imIter ptr = eImageIm->x_at(width - _border, y),
-                             end = eImageIm->row_end(y); ptr != end; ++ptr, ++bi) {
-                        *bi = *ptr;
-                    }
+    int const width = imageList[0]->getWidth();
+    int const nPix = width*imageList[0]->getHeight();
+    double maxChange = 0.0;
+    if (ncomp == 0) {
+        /*
+         * Replace bad pixels by the inverse-variance weighted mean of the flux-normalised good pixels of
+         * all the images, as afw does; we only need the mean where some image has a bad pixel
+         */
+        std::vector<int> slot(nPix, -1); // index into needed of each pixel, or -1 if not needed
+        std::vector<int> needed;
+        for (int i = 0; i != nImage; ++i) {
+            for (std::vector<int>::const_iterator ptr = _badPixels[i].begin(), end = _badPixels[i].end();
+                 ptr != end; ++ptr) {
+                if (slot[*ptr] < 0) {
+                    slot[*ptr] = needed.size();
+                    needed.push_back(*ptr);
                 }
-                for (; y != height; ++y) {   // Top border of eImage
-                    for (imIter ptr = eImageIm->row_begin(y),
-                             end = eImageIm->row_end(y); ptr != end; ++ptr, ++bi) {
-                        *bi = *ptr;
-                    }
+            }
+        }
+        if (needed.empty()) {
+            return 0.0;
+        }
+        typename Super::FluxList const &fluxList = this->getFluxList();
+        std::vector<typename PlaneT::Pixel> mean(needed.size(), 0.0);
+        std::vector<float> weight(needed.size(), 0.0);
+        for (int i = 0; i != nImage; ++i) {
+            accumulateMean(*imageList[i], fluxList[i], mask, needed, mean, weight);
+        }
+        for (std::size_t j = 0; j != needed.size(); ++j) {
+            mean[j] = (weight[j] == 0.0) ? 0.0 : mean[j]/weight[j]; // no good pixels => 0
+        }
+        for (int i = 0; i != nImage; ++i) {
+            PlaneT &plane = *afw::image::GetImage<ImageT>::getImage(imageList[i]);
+            double const flux = fluxList[i];
+            for (std::vector<int>::const_iterator ptr = _badPixels[i].begin(), end = _badPixels[i].end();
+                 ptr != end; ++ptr) {
+                typename PlaneT::Pixel &value = plane(*ptr%width, *ptr/width);
+                double const model = flux*mean[slot[*ptr]];
+                maxChange = std::max(maxChange, std::fabs(model - value));
+                value = model;
+            }
+        }
+    } else {
+        /*
+         * Replace the bad pixels by the least-squares fit of the first ncomp eigen images to the whole
+         * image, as afw does, using the basis and normal equations saved by analyze().  Images without
+         * bad pixels wouldn't change, so aren't fit
+         */
+        Eigen::MatrixXd const normal = _normal.topLeftCorner(ncomp, ncomp);
+        Eigen::PartialPivLU<Eigen::MatrixXd> const lu(normal);
+        Eigen::VectorXd data(nPix);
+        for (int i = 0; i != nImage; ++i) {
+            std::vector<int> const &bad = _badPixels[i];
+            if (bad.empty()) {
+                continue;
+            }
+            PlaneT &plane = *afw::image::GetImage<ImageT>::getImage(imageList[i]);
+            for (int y = 0, j = 0; y != plane.getHeight(); ++y) {
+                for (typename PlaneT::const_x_iterator ptr = plane.row_begin(y), end = plane.row_end(y);
+                     ptr != end; ++ptr, ++j) {
+                    data[j] = *ptr;
                 }
-                assert(std::distance(edgePixels.begin(), bi) == nEdge);
-            
-                background = afw::math::makeStatistics(edgePixels, afw::math::MEDIAN).getValue();
             }
-            *eImage -= background;
+            Eigen::VectorXd const rhs = _basis.leftCols(ncomp).transpose()*data;
+            Eigen::VectorXd amplitudes(ncomp);
+            if (ncomp == 1) {
+                amplitudes[0] = rhs[0]/normal(0, 0);
+            } else {
+                amplitudes = lu.solve(rhs);
+            }
+
+            for (std::vector<int>::const_iterator ptr = bad.begin(), end = bad.end(); ptr != end; ++ptr) {
+                typename PlaneT::Pixel &value = plane(*ptr%width, *ptr/width);
+                typename PlaneT::Pixel const model = _basis.row(*ptr).head(ncomp).dot(amplitudes);
+                maxChange = std::max(maxChange, std::fabs(static_cast<double>(model) - value));
+                value = model;
+            }
         }
     }
+
+    return maxChange;
 }
 
 #define INSTANTIATE_IMAGE(IMAGE) \
@@ -0,0 +1,207 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include <pthread.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include <cstdlib>
+#include <map>
+
+#include "lsst/meas/algorithms/Instrumentation.h"
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+namespace instrumentation {
+
+struct ProbeData {
+    enum Kind { COUNTER, TIMER };
+
+    explicit ProbeData(Kind kind_) : kind(kind_), count(0), nanoseconds(0) {}
+
+    Kind kind;
+    boost::int64_t volatile count;       // calls for a timer
+    boost::int64_t volatile nanoseconds; // timers only
+};
+
+namespace {
+
+bool initiallyEnabled() {
+    char const * env = std::getenv("MEAS_ALGORITHMS_INSTRUMENTATION");
+    return env && *env;
+}
+
+/*
+ * Probes are created by function-level statics, i.e. during the first call of the function that uses
+ * them, which may be on any thread; so the registry is protected by a mutex.  Updates to the values
+ * are lock-free.
+ */
+pthread_mutex_t registryMutex = PTHREAD_MUTEX_INITIALIZER;
+
+typedef std::map<std::string, ProbeData *> Registry;
+
+Registry & getRegistry() {
+    static Registry registry;
+    return registry;
+}
+
+ProbeData * registerProbe(std::string const & name, ProbeData::Kind kind) {
+    pthread_mutex_lock(&registryMutex);
+    Registry & registry = getRegistry();
+    Registry::iterator iter = registry.find(name);
+    if (iter == registry.end()) {
+        // never deleted: probes live as long as the process
+        iter = registry.insert(std::make_pair(name, new ProbeData(kind))).first;
+    }
+    ProbeData * data = iter->second;
+    pthread_mutex_unlock(&registryMutex);
+    return data;
+}
+
+} // anonymous namespace
+
+volatile bool enabled = initiallyEnabled();
+
+Counter::Counter(std::string const & name) : _data(registerProbe(name, ProbeData::COUNTER)) {}
+
+void Counter::_add(boost::int64_t n) {
+    __sync_fetch_and_add(&_data->count, n);
+}
+
+Timer::Timer(std::string const & name) : _data(registerProbe(name, ProbeData::TIMER)) {}
+
+void Timer::record(boost::int64_t nanoseconds) {
+    __sync_fetch_and_add(&_data->count, 1);
+    __sync_fetch_and_add(&_data->nanoseconds, nanoseconds);
+}
+
+boost::int64_t ScopedTimer::now() {
+#if defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<boost::int64_t>(ts.tv_sec)*1000000000 + ts.tv_nsec;
+#else
+    struct timeval tv;
+    gettimeofday(&tv, 0);
+    return static_cast<boost::int64_t>(tv.tv_sec)*1000000000 + 1000*tv.tv_usec;
+#endif
+}
+
+} // namespace instrumentation
+
+bool isInstrumentationEnabled() {
+    return instrumentation::enabled;
+}
+
+void setInstrumentationEnabled(bool enabled) {
+    instrumentation::enabled = enabled;
+}
+
+void resetInstrumentation() {
+    pthread_mutex_lock(&instrumentation::registryMutex);
+    instrumentation::Registry & registry = instrumentation::getRegistry();
+    for (instrumentation::Registry::iterator iter = registry.begin(); iter != registry.end(); ++iter) {
+        iter->second->count = 0;
+        iter->second->nanoseconds = 0;
+    }
+    pthread_mutex_unlock(&instrumentation::registryMutex);
+}
+
+namespace {
+
+// Set the values of one probe in a PropertySet
+void setProbe(
+    daf::base::PropertySet & metadata,
+    std::string const & name,
+    instrumentation::ProbeData::Kind kind,
+    boost::int64_t count,
+    boost::int64_t nanoseconds
+) {
+    if (kind == instrumentation::ProbeData::TIMER) {
+        metadata.set(name + ".seconds", 1e-9*nanoseconds);
+        metadata.set(name + ".calls", count);
+    } else {
+        metadata.set(name + ".count", count);
+    }
+}
+
+} // anonymous namespace
+
+void collectInstrumentation(daf::base::PropertySet & metadata, std::string const & prefix, bool reset) {
+    pthread_mutex_lock(&instrumentation::registryMutex);
+    instrumentation::Registry & registry = instrumentation::getRegistry();
+    for (instrumentation::Registry::iterator iter = registry.begin(); iter != registry.end(); ++iter) {
+        instrumentation::ProbeData & data = *iter->second;
+        if (data.count == 0) {
+            continue;
+        }
+        setProbe(metadata, prefix + iter->first, data.kind, data.count, data.nanoseconds);
+        if (reset) {
+            data.count = 0;
+            data.nanoseconds = 0;
+        }
+    }
+    pthread_mutex_unlock(&instrumentation::registryMutex);
+}
+
+InstrumentationSnapshot::InstrumentationSnapshot() : _values() {
+    pthread_mutex_lock(&instrumentation::registryMutex);
+    instrumentation::Registry & registry = instrumentation::getRegistry();
+    for (instrumentation::Registry::iterator iter = registry.begin(); iter != registry.end(); ++iter) {
+        _values[iter->first] = std::make_pair(static_cast<boost::int64_t>(iter->second->count),
+                                              static_cast<boost::int64_t>(iter->second->nanoseconds));
+    }
+    pthread_mutex_unlock(&instrumentation::registryMutex);
+}
+
+void InstrumentationSnapshot::collect(
+    daf::base::PropertySet & metadata,
+    std::string const & prefix,
+    std::string const & probePrefix
+) const {
+    pthread_mutex_lock(&instrumentation::registryMutex);
+    instrumentation::Registry & registry = instrumentation::getRegistry();
+    for (instrumentation::Registry::iterator iter = registry.lower_bound(probePrefix);
+         iter != registry.end() && iter->first.compare(0, probePrefix.size(), probePrefix) == 0; ++iter) {
+        instrumentation::ProbeData const & data = *iter->second;
+        boost::int64_t count = data.count;
+        boost::int64_t nanoseconds = data.nanoseconds;
+        std::map<std::string, std::pair<boost::int64_t, boost::int64_t> >::const_iterator const old =
+            _values.find(iter->first);
+        if (old != _values.end()) {
+            // a probe reset since the snapshot has only the values accumulated since then
+            if (count >= old->second.first) {
+                count -= old->second.first;
+                nanoseconds -= old->second.second;
+            }
+        }
+        if (count > 0) {
+            setProbe(metadata, prefix + iter->first, data.kind, count, nanoseconds);
+        }
+    }
+    pthread_mutex_unlock(&instrumentation::registryMutex);
+}
+
+}}} // namespace lsst::meas::algorithms
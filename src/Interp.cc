@@ -35,12 +35,14 @@
 #include <string>
 #include <typeinfo>
 #include <limits>
+#include "boost/cstdint.hpp"
 #include "boost/format.hpp"
 
 #include "lsst/afw/geom.h"
 #include "lsst/pex/logging/Trace.h"
 #include "lsst/pex/exceptions.h"
 #include "lsst/afw/image/MaskedImage.h"
+#include "lsst/meas/algorithms/Instrumentation.h"
 #include "lsst/meas/algorithms/Interp.h"
 
 namespace lsst {
@@ -195,6 +197,37 @@ classify_defects(std::vector<Defect::Ptr> const & badList, // list of bad things
 }
 
 /*****************************************************************************/
+namespace {
+/*
+ * A row of an image whose pixels are set via interp::PixelArithmetic::convert, so values written to integer
+ * images are rounded and clamped rather than truncated (or wrapped)
+ */
+template<typename ImageT>
+class PixelRow {
+public:
+    typedef typename ImageT::Pixel Pixel;
+
+    class Reference {
+    public:
+        explicit Reference(typename ImageT::x_iterator ptr) : _ptr(ptr) {}
+
+        Reference& operator=(double value) {
+            *_ptr = interp::PixelArithmetic<Pixel>::convert(value);
+            return *this;
+        }
+        operator Pixel() const { return *_ptr; }
+    private:
+        typename ImageT::x_iterator _ptr;
+    };
+
+    explicit PixelRow(typename ImageT::x_iterator begin) : _begin(begin) {}
+
+    Reference operator[](int i) const { return Reference(_begin + i); }
+private:
+    typename ImageT::x_iterator _begin;
+};
+}
+
 /*
  * Interpolate over the defects in a given line of data. In the comments,
  * a bad pixel is written as ., a good one as #, and unknown but non-interpolated pixels as ?.
@@ -222,12 +255,12 @@ static void do_defects(std::vector<Defect::Ptr> const & badList, // list of bad
 {
     typedef typename ImageT::Pixel ImagePixel;
     ImagePixel out1_2, out1_1, out2_1, out2_2; // == out[badX1-2], ..., out[bad_x2+2]
-    ImagePixel val;                         // unpack a pixel value
+    typename interp::PixelArithmetic<ImagePixel>::Working val; // unpack a pixel value
     //
     // Get pointer to this row of data
     //
     int const ncol = data.getWidth();
-    typename ImageT::x_iterator out = data.row_begin(y);
+    PixelRow<ImageT> out(data.row_begin(y));
 
     for (DefectCIter ptr = badList.begin(), end = badList.end(); ptr != end; ++ptr) {
         Defect::Ptr const defect = *ptr;
@@ -2061,6 +2094,8 @@ void interpolateOverDefects(MaskedImageT& mimage, ///< Image to patch
                             double fallbackValue,                ///< Value to fallback to if all else fails
                             bool useFallbackValueAtEdge ///< Use the fallback value at the image's edge?
                            ) {
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "interpolateOverDefects");
+    LSST_MEAS_ALGORITHMS_COUNT("interpolateOverDefects.defects", _badList.size());
 /*
  * Allow for image's origin
  */
@@ -2109,13 +2144,13 @@ void interpolateOverDefects(MaskedImageT& mimage, ///< Image to patch
         std::vector<Defect::Ptr> badList1D = classify_defects(badList, y, width);
 
         do_defects(badList1D, y, *mimage.getImage(),
-                   -std::numeric_limits<typename MaskedImageT::Image::Pixel>::max(),
+                   interp::PixelArithmetic<typename MaskedImageT::Image::Pixel>::lowest(),
                    fallbackValue, useFallbackValueAtEdge, nUseInterp);
 
         do_defects(badList1D, y, *mimage.getMask(), interpBit, useFallbackValueAtEdge, nUseInterp);
 
         do_defects(badList1D, y, *mimage.getVariance(),
-                   -std::numeric_limits<typename MaskedImageT::Image::Pixel>::max(),
+                   interp::PixelArithmetic<typename MaskedImageT::Variance::Pixel>::lowest(),
                    fallbackValue, useFallbackValueAtEdge, nUseInterp);
     }
 }
@@ -2239,31 +2274,20 @@ std::pair<bool, typename MaskedImageT::Image::Pixel> interp::singlePixel(
 //
 // \cond
 
-typedef float ImagePixel;
-
-template
-void interpolateOverDefects(image::MaskedImage<ImagePixel, image::MaskPixel> &image,
-                            lsst::afw::detection::Psf const &, std::vector<Defect::Ptr> &badList, double, bool
-                           );
-template
-std::pair<bool, ImagePixel> interp::singlePixel(int x, int y,
-                                                image::MaskedImage<ImagePixel, image::MaskPixel> const& image,
-                                                bool horizontal, double minval);
-//
-// Why do we need double images?
-//
-#if 1
-template
-void interpolateOverDefects(image::MaskedImage<double, image::MaskPixel> &image,
-                            lsst::afw::detection::Psf const &, std::vector<Defect::Ptr> &badList, double, bool
-                           );
-
-template
-std::pair<bool, double> interp::singlePixel(int x, int y,
-                                            image::MaskedImage<double, image::MaskPixel> const& image,
-                                            bool horizontal, double minval);
-
-#endif
+#define INSTANTIATE(TYPE) \
+    template \
+    void interpolateOverDefects(image::MaskedImage<TYPE, image::MaskPixel> &image, \
+                                lsst::afw::detection::Psf const &, std::vector<Defect::Ptr> &badList, \
+                                double, bool); \
+    template \
+    std::pair<bool, TYPE> interp::singlePixel(int x, int y, \
+                                              image::MaskedImage<TYPE, image::MaskPixel> const& image, \
+                                              bool horizontal, double minval)
+
+INSTANTIATE(float);
+INSTANTIATE(double);
+INSTANTIATE(boost::uint16_t);           // raw frames
+INSTANTIATE(int);
 // \endcond
 
 }}} // lsst::meas::algorithms
@@ -1,10 +1,24 @@
 // -*- LSST-C++ -*-
 
+#include <cmath>
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/afw/image/ImageUtils.h"
 #include "lsst/meas/algorithms/KernelPsf.h"
 #include "lsst/meas/algorithms/KernelPsfFactory.h"
 
 namespace lsst { namespace meas { namespace algorithms {
 
+std::vector<double> KernelPsf::sampleKernelFunction(
+    afw::math::SeparableKernel::KernelFunction const & func, int n, int centre, double offset
+) {
+    std::vector<double> vec(n);
+    for (int i = 0; i < n; ++i) {
+        vec[i] = func(i - centre - offset);
+    }
+    return vec;
+}
+
 PTR(afw::detection::Psf::Image) KernelPsf::doComputeKernelImage(
     afw::geom::Point2D const & position, afw::image::Color const& color
 ) const {
@@ -13,11 +27,65 @@ PTR(afw::detection::Psf::Image) KernelPsf::doComputeKernelImage(
     return im;
 }
 
+PTR(afw::detection::Psf::Image) KernelPsf::doComputeImage(
+    afw::geom::Point2D const & position, afw::image::Color const& color
+) const {
+    if (!_separableKernel || _separableKernel->isSpatiallyVarying()) {
+        return recenterKernelImage(computeKernelImage(position, color), position);
+    }
+    std::pair<int, double> const irX = afw::image::positionToIndex(position.getX(), true);
+    std::pair<int, double> const irY = afw::image::positionToIndex(position.getY(), true);
+    int const width = _kernel->getWidth();
+    int const height = _kernel->getHeight();
+    std::vector<double> const colList = sampleKernelFunction(*_separableKernel->getKernelColFunction(),
+                                                             width, _kernel->getCtrX(), irX.second);
+    std::vector<double> const rowList = sampleKernelFunction(*_separableKernel->getKernelRowFunction(),
+                                                             height, _kernel->getCtrY(), irY.second);
+    double colSum = 0.0, rowSum = 0.0;
+    for (int i = 0; i < width; ++i) {
+        colSum += colList[i];
+    }
+    for (int i = 0; i < height; ++i) {
+        rowSum += rowList[i];
+    }
+    double const norm = 1.0/(colSum*rowSum);
+
+    PTR(Psf::Image) im = boost::make_shared<Psf::Image>(_kernel->getDimensions());
+    for (int y = 0; y < height; ++y) {
+        double const rowValue = norm*rowList[y];
+        Psf::Image::x_iterator ptr = im->row_begin(y);
+        for (int x = 0; x < width; ++x, ++ptr) {
+            *ptr = rowValue*colList[x];
+        }
+    }
+    im->setXY0(irX.first - _kernel->getCtrX(), irY.first - _kernel->getCtrY());
+    return im;
+}
+
+std::pair<std::vector<double>, std::vector<double> >
+KernelPsf::computeKernelVectors(afw::geom::Point2D position) const {
+    if (!_separableKernel) {
+        throw LSST_EXCEPT(pex::exceptions::LogicError, "KernelPsf's Kernel is not separable");
+    }
+    if (std::isnan(position.getX())) {
+        position = getAveragePosition();
+    }
+    std::pair<std::vector<double>, std::vector<double> > vectors;
+    vectors.first.resize(_kernel->getWidth());
+    vectors.second.resize(_kernel->getHeight());
+    _separableKernel->computeVectors(vectors.first, vectors.second, true, position.getX(), position.getY());
+    return vectors;
+}
+
 KernelPsf::KernelPsf(afw::math::Kernel const & kernel, afw::geom::Point2D const & averagePosition) :
-    ImagePsf(!kernel.isSpatiallyVarying()), _kernel(kernel.clone()), _averagePosition(averagePosition) {}
+    ImagePsf(!kernel.isSpatiallyVarying()), _kernel(kernel.clone()),
+    _separableKernel(boost::dynamic_pointer_cast<afw::math::SeparableKernel const>(_kernel)),
+    _averagePosition(averagePosition) {}
 
 KernelPsf::KernelPsf(PTR(afw::math::Kernel) kernel, afw::geom::Point2D const & averagePosition) :
-    ImagePsf(!kernel->isSpatiallyVarying()), _kernel(kernel), _averagePosition(averagePosition) {}
+    ImagePsf(!kernel->isSpatiallyVarying()), _kernel(kernel),
+    _separableKernel(boost::dynamic_pointer_cast<afw::math::SeparableKernel const>(_kernel)),
+    _averagePosition(averagePosition) {}
 
 PTR(afw::detection::Psf) KernelPsf::clone() const { return boost::make_shared<KernelPsf>(*this); }
 
@@ -0,0 +1,123 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include "boost/format.hpp"
+#include "boost/make_shared.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/meas/algorithms/MaskedImageAccumulator.h"
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+
+namespace {
+
+/*
+ * Add numRows rows of the input to the sum, starting at row y0 of the sum
+ *
+ * The three planes are walked together through raw row pointers, so each input pixel is
+ * touched once and the inner loop is a simple contiguous loop that the compiler can vectorise.
+ */
+template <typename PixelT>
+void addPlanes(
+    afw::image::MaskedImage<PixelT> & sum,
+    afw::image::MaskedImage<PixelT> const & input,
+    int y0,
+    int numRows
+) {
+    typedef afw::image::MaskPixel MaskPixelT;
+    typedef afw::image::VariancePixel VariancePixelT;
+
+    ndarray::Array<PixelT, 2, 1> sumImage = sum.getImage()->getArray();
+    ndarray::Array<MaskPixelT, 2, 1> sumMask = sum.getMask()->getArray();
+    ndarray::Array<VariancePixelT, 2, 1> sumVariance = sum.getVariance()->getArray();
+    ndarray::Array<PixelT const, 2, 1> inImage = input.getImage()->getArray();
+    ndarray::Array<MaskPixelT const, 2, 1> inMask = input.getMask()->getArray();
+    ndarray::Array<VariancePixelT const, 2, 1> inVariance = input.getVariance()->getArray();
+
+    int const width = sum.getWidth();
+    for (int y = 0; y < numRows; ++y) {
+        PixelT * sImage = sumImage[y0 + y].getData();
+        MaskPixelT * sMask = sumMask[y0 + y].getData();
+        VariancePixelT * sVariance = sumVariance[y0 + y].getData();
+        PixelT const * iImage = inImage[y].getData();
+        MaskPixelT const * iMask = inMask[y].getData();
+        VariancePixelT const * iVariance = inVariance[y].getData();
+        for (int x = 0; x < width; ++x) {
+            sImage[x] += iImage[x];
+            sMask[x] |= iMask[x];
+            sVariance[x] += iVariance[x];
+        }
+    }
+}
+
+} // anonymous namespace
+
+template <typename PixelT>
+MaskedImageAccumulator<PixelT>::MaskedImageAccumulator(
+    afw::geom::Extent2I const & dimensions,
+    afw::geom::Point2I const & xy0
+) : _sum(boost::make_shared<MaskedImageT>(dimensions))
+{
+    _sum->setXY0(xy0);
+    *_sum->getImage() = 0;
+    *_sum->getMask() = 0;
+    *_sum->getVariance() = 0;
+}
+
+template <typename PixelT>
+void MaskedImageAccumulator<PixelT>::add(MaskedImageT const & input) {
+    if (input.getDimensions() != _sum->getDimensions()) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Input is %dx%d, but the sum is %dx%d")
+                           % input.getWidth() % input.getHeight()
+                           % _sum->getWidth() % _sum->getHeight()).str());
+    }
+    addPlanes(*_sum, input, 0, input.getHeight());
+}
+
+template <typename PixelT>
+void MaskedImageAccumulator<PixelT>::addRows(MaskedImageT const & band, int y) {
+    if (band.getWidth() != _sum->getWidth() || y < 0 || y + band.getHeight() > _sum->getHeight()) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Band of %dx%d starting at row %d does not fit in the %dx%d sum")
+                           % band.getWidth() % band.getHeight() % y
+                           % _sum->getWidth() % _sum->getHeight()).str());
+    }
+    addPlanes(*_sum, band, y, band.getHeight());
+}
+
+template <typename PixelT>
+void MaskedImageAccumulator<PixelT>::merge(MaskedImageAccumulator const & other) {
+    add(*other._sum);
+}
+
+#define INSTANTIATE(TYPE) \
+    template class MaskedImageAccumulator<TYPE>;
+
+INSTANTIATE(float);
+INSTANTIATE(double);
+
+}}} // namespace lsst::meas::algorithms
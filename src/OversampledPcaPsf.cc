@@ -0,0 +1,323 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include <cmath>
+
+#include "boost/format.hpp"
+#include "boost/make_shared.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/afw/image/ImageUtils.h"
+#include "lsst/afw/table/io/InputArchive.h"
+#include "lsst/afw/table/io/OutputArchive.h"
+#include "lsst/afw/table/io/CatalogVector.h"
+#include "lsst/afw/table/aggregates.h"
+#include "lsst/meas/algorithms/OversampledPcaPsf.h"
+
+namespace lsst { namespace meas { namespace algorithms {
+
+namespace {
+
+/*
+ * The samples of an oversampled basis image between which one pixel of a rendered image is interpolated.
+ * Samples that fall outside the basis image have zero weight.
+ */
+struct Tap {
+    int index0, index1;
+    double weight0, weight1;
+};
+
+/*
+ * Return the taps for each of the n pixels of one dimension of a rendered image.
+ *
+ * Sample p of the basis is at an offset of (p + 0.5)/N - 0.5 - ctr pixels from the centre of the PSF,
+ * and pixel i of the rendered image is at an offset of i - ctr - d, so it lies at p = N*(i - d + 0.5) - 0.5.
+ */
+std::vector<Tap> makeTaps(int n, int oversampling, double d) {
+    int const nSample = n*oversampling;
+    std::vector<Tap> taps(n);
+    for (int i = 0; i != n; ++i) {
+        double const p = oversampling*(i - d + 0.5) - 0.5;
+        int const p0 = static_cast<int>(std::floor(p));
+        double const t = p - p0;
+        Tap & tap = taps[i];
+        tap.index0 = p0;
+        tap.weight0 = 1.0 - t;
+        tap.index1 = p0 + 1;
+        tap.weight1 = t;
+        if (tap.index0 < 0 || tap.index0 >= nSample) {
+            tap.index0 = 0;
+            tap.weight0 = 0.0;
+        }
+        if (tap.index1 < 0 || tap.index1 >= nSample) {
+            tap.index1 = 0;
+            tap.weight1 = 0.0;
+        }
+    }
+    return taps;
+}
+
+} // anonymous
+
+OversampledPcaPsf::OversampledPcaPsf(
+    std::vector<PTR(BasisImage)> const & basis,
+    std::vector<afw::math::Kernel::SpatialFunctionPtr> const & spatialFunctions,
+    int oversampling,
+    afw::geom::Extent2I const & dimensions,
+    afw::geom::Point2D const & averagePosition
+) : ImagePsf(false),
+    _basis(basis),
+    _spatialFunctions(spatialFunctions),
+    _oversampling(oversampling),
+    _dimensions(dimensions),
+    _averagePosition(averagePosition)
+{
+    if (oversampling < 1 || dimensions.getX() < 1 || dimensions.getY() < 1) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          (boost::format("Invalid oversampling %d or dimensions %dx%d")
+                           % oversampling % dimensions.getX() % dimensions.getY()).str());
+    }
+    if (basis.empty() || basis.size() != spatialFunctions.size()) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          (boost::format("Need one spatial function per basis image; saw %d and %d")
+                           % basis.size() % spatialFunctions.size()).str());
+    }
+    for (std::size_t i = 0; i != basis.size(); ++i) {
+        if (!basis[i] || !spatialFunctions[i]) {
+            throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                              "Basis images and spatial functions must not be null");
+        }
+        if (basis[i]->getDimensions() != dimensions*oversampling) {
+            throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                              (boost::format("Basis image %d is %dx%d, not %dx%d")
+                               % i % basis[i]->getWidth() % basis[i]->getHeight()
+                               % (oversampling*dimensions.getX()) % (oversampling*dimensions.getY())).str());
+        }
+    }
+}
+
+PTR(afw::detection::Psf) OversampledPcaPsf::clone() const {
+    return boost::make_shared<OversampledPcaPsf>(*this);
+}
+
+std::vector<PTR(OversampledPcaPsf::BasisImage const)> OversampledPcaPsf::getBasis() const {
+    return std::vector<PTR(BasisImage const)>(_basis.begin(), _basis.end());
+}
+
+std::vector<double> OversampledPcaPsf::getWeights(afw::geom::Point2D const & position) const {
+    std::vector<double> weights(_spatialFunctions.size());
+    for (std::size_t i = 0; i != weights.size(); ++i) {
+        weights[i] = (*_spatialFunctions[i])(position.getX(), position.getY());
+    }
+    return weights;
+}
+
+PTR(afw::detection::Psf::Image) OversampledPcaPsf::doComputeKernelImage(
+    afw::geom::Point2D const & position,
+    afw::image::Color const &
+) const {
+    PTR(Image) image = _render(position, 0.0, 0.0);
+    image->setXY0(-(_dimensions.getX()/2), -(_dimensions.getY()/2));
+    return image;
+}
+
+PTR(afw::detection::Psf::Image) OversampledPcaPsf::doComputeImage(
+    afw::geom::Point2D const & position,
+    afw::image::Color const &
+) const {
+    std::pair<int, double> const irX = afw::image::positionToIndex(position.getX(), true);
+    std::pair<int, double> const irY = afw::image::positionToIndex(position.getY(), true);
+    PTR(Image) image = _render(position, irX.second, irY.second);
+    image->setXY0(irX.first - _dimensions.getX()/2, irY.first - _dimensions.getY()/2);
+    return image;
+}
+
+PTR(afw::detection::Psf::Image) OversampledPcaPsf::_render(
+    afw::geom::Point2D const & position,
+    double dx,
+    double dy
+) const {
+    int const width = _dimensions.getX();
+    int const height = _dimensions.getY();
+    std::vector<Tap> const xTaps = makeTaps(width, _oversampling, dx);
+    std::vector<Tap> const yTaps = makeTaps(height, _oversampling, dy);
+    std::vector<double> const weights = getWeights(position);
+
+    PTR(Image) image = boost::make_shared<Image>(_dimensions);
+    *image = 0.0;
+    for (std::size_t k = 0; k != _basis.size(); ++k) {
+        if (weights[k] == 0.0) {
+            continue;
+        }
+        BasisImage const & basis = *_basis[k];
+        for (int y = 0; y != height; ++y) {
+            Tap const & yTap = yTaps[y];
+            double const weight0 = weights[k]*yTap.weight0;
+            double const weight1 = weights[k]*yTap.weight1;
+            BasisImage::const_x_iterator const row0 = basis.row_begin(yTap.index0);
+            BasisImage::const_x_iterator const row1 = basis.row_begin(yTap.index1);
+            Image::x_iterator ptr = image->row_begin(y);
+            for (std::vector<Tap>::const_iterator xTap = xTaps.begin(); xTap != xTaps.end(); ++xTap, ++ptr) {
+                *ptr += weight0*(xTap->weight0*row0[xTap->index0] + xTap->weight1*row0[xTap->index1]) +
+                        weight1*(xTap->weight0*row1[xTap->index0] + xTap->weight1*row1[xTap->index1]);
+            }
+        }
+    }
+    //
+    // The interpolation doesn't conserve flux exactly (e.g. at the edges of the basis), so normalise
+    //
+    double sum = 0.0;
+    for (int y = 0; y != height; ++y) {
+        for (Image::x_iterator ptr = image->row_begin(y), end = image->row_end(y); ptr != end; ++ptr) {
+            sum += *ptr;
+        }
+    }
+    if (sum != 0.0) {
+        *image /= sum;
+    }
+    return image;
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// Persistence
+// ---------------------------------------------------------------------------------------------------------
+
+namespace {
+
+namespace tbl = afw::table;
+
+/*
+ * Persisted as a single record; the schema depends on the size and number of the basis images,
+ * so the keys are looked up by name when reading.
+ */
+class OversampledPcaPsfFactory : public tbl::io::PersistableFactory {
+public:
+
+    virtual PTR(tbl::io::Persistable)
+    read(tbl::io::InputArchive const & archive, tbl::io::CatalogVector const & catalogs) const {
+        LSST_ARCHIVE_ASSERT(catalogs.size() == 1u);
+        LSST_ARCHIVE_ASSERT(catalogs.front().size() == 1u);
+        tbl::BaseRecord const & record = catalogs.front().front();
+        tbl::Schema const schema = record.getSchema();
+        tbl::PointKey<double> const averagePositionKey(schema["averagePosition"]);
+        tbl::Key<int> const oversamplingKey = schema["oversampling"];
+        tbl::Key<int> const widthKey = schema["width"];
+        tbl::Key<int> const heightKey = schema["height"];
+        tbl::Key< tbl::Array<double> > const basisKey = schema["basis"];
+        tbl::Key< tbl::Array<int> > const spatialFunctionsKey = schema["spatialFunctions"];
+
+        int const oversampling = record.get(oversamplingKey);
+        int const width = oversampling*record.get(widthKey);
+        int const height = oversampling*record.get(heightKey);
+        int const nComponents = spatialFunctionsKey.getSize();
+        LSST_ARCHIVE_ASSERT(basisKey.getSize() == nComponents*width*height);
+
+        ndarray::Array<double const,1,1> const basisArray = record.get(basisKey);
+        ndarray::Array<int const,1,1> const spatialFunctionIds = record.get(spatialFunctionsKey);
+        std::vector<PTR(OversampledPcaPsf::BasisImage)> basis;
+        std::vector<afw::math::Kernel::SpatialFunctionPtr> spatialFunctions;
+        ndarray::Array<double const,1,1>::Iterator pixel = basisArray.begin();
+        for (int i = 0; i != nComponents; ++i) {
+            PTR(OversampledPcaPsf::BasisImage) image =
+                boost::make_shared<OversampledPcaPsf::BasisImage>(width, height);
+            for (int y = 0; y != height; ++y) {
+                for (OversampledPcaPsf::BasisImage::x_iterator ptr = image->row_begin(y),
+                         end = image->row_end(y); ptr != end; ++ptr, ++pixel) {
+                    *ptr = *pixel;
+                }
+            }
+            basis.push_back(image);
+            spatialFunctions.push_back(archive.get< afw::math::Function2<double> >(spatialFunctionIds[i]));
+        }
+        return boost::make_shared<OversampledPcaPsf>(
+            basis, spatialFunctions, oversampling,
+            afw::geom::Extent2I(record.get(widthKey), record.get(heightKey)),
+            record.get(averagePositionKey)
+        );
+    }
+
+    OversampledPcaPsfFactory(std::string const & name) : tbl::io::PersistableFactory(name) {}
+
+};
+
+std::string getOversampledPcaPsfPersistenceName() { return "OversampledPcaPsf"; }
+
+OversampledPcaPsfFactory registration(getOversampledPcaPsfPersistenceName());
+
+} // anonymous
+
+bool OversampledPcaPsf::isPersistable() const {
+    for (std::size_t i = 0; i != _spatialFunctions.size(); ++i) {
+        if (!_spatialFunctions[i]->isPersistable()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::string OversampledPcaPsf::getPersistenceName() const { return getOversampledPcaPsfPersistenceName(); }
+
+std::string OversampledPcaPsf::getPythonModule() const { return "lsst.meas.algorithms"; }
+
+void OversampledPcaPsf::write(OutputArchiveHandle & handle) const {
+    int const nComponents = _basis.size();
+    int const nPixels = _basis.front()->getWidth()*_basis.front()->getHeight();
+
+    tbl::Schema schema;
+    tbl::PointKey<double> const averagePositionKey = tbl::PointKey<double>::addFields(
+        schema, "averagePosition", "average position of stars used to make the PSF", "pixels"
+    );
+    tbl::Key<int> const oversamplingKey = schema.addField<int>("oversampling", "samples per pixel");
+    tbl::Key<int> const widthKey = schema.addField<int>("width", "width of PSF images", "pixels");
+    tbl::Key<int> const heightKey = schema.addField<int>("height", "height of PSF images", "pixels");
+    tbl::Key< tbl::Array<double> > const basisKey = schema.addField< tbl::Array<double> >(
+        "basis", "oversampled basis images, each in row-major order", nComponents*nPixels
+    );
+    tbl::Key< tbl::Array<int> > const spatialFunctionsKey = schema.addField< tbl::Array<int> >(
+        "spatialFunctions", "archive IDs of the spatial function of each basis image", nComponents
+    );
+
+    tbl::BaseCatalog catalog = handle.makeCatalog(schema);
+    PTR(tbl::BaseRecord) record = catalog.addNew();
+    record->set(averagePositionKey, _averagePosition);
+    record->set(oversamplingKey, _oversampling);
+    record->set(widthKey, _dimensions.getX());
+    record->set(heightKey, _dimensions.getY());
+    ndarray::ArrayRef<double,1,1> const basis = (*record)[basisKey];
+    ndarray::ArrayRef<int,1,1> const spatialFunctionIds = (*record)[spatialFunctionsKey];
+    ndarray::ArrayRef<double,1,1>::Iterator pixel = basis.begin();
+    for (int i = 0; i != nComponents; ++i) {
+        BasisImage const & image = *_basis[i];
+        for (int y = 0; y != image.getHeight(); ++y) {
+            for (BasisImage::const_x_iterator ptr = image.row_begin(y), end = image.row_end(y);
+                 ptr != end; ++ptr, ++pixel) {
+                *pixel = *ptr;
+            }
+        }
+        spatialFunctionIds[i] = handle.put(_spatialFunctions[i]);
+    }
+    handle.saveCatalog(catalog);
+}
+
+}}} // namespace lsst::meas::algorithms
@@ -29,6 +29,7 @@
  *
  * @ingroup algorithms
  */
+#include <algorithm>
 #include <cmath>
 
 #include "boost/make_shared.hpp"
@@ -37,6 +38,8 @@
 #include "lsst/pex/exceptions.h"
 #include "lsst/afw/image/ImageUtils.h"
 #include "lsst/afw/math/Statistics.h"
+#include "lsst/afw/math/FunctionLibrary.h"
+#include "lsst/afw/table/aggregates.h"
 #include "lsst/meas/algorithms/PcaPsf.h"
 #include "lsst/afw/formatters/KernelFormatter.h"
 #include "lsst/afw/detection/PsfFormatter.h"
@@ -69,11 +72,256 @@ PTR(afw::detection::Psf) PcaPsf::clone() const {
 
 namespace {
 
-// registration for table persistence
+namespace tbl = afw::table;
+
+// registration for table persistence in the standard format
 KernelPsfFactory<PcaPsf,afw::math::LinearCombinationKernel> registration("PcaPsf");
 
+std::string const COMPACT_PERSISTENCE_NAME = "PcaPsfCompact";
+
+bool compactPersistence = false;
+
+// Kinds of spatial function supported by the compact format
+enum SpatialFunctionType { NOT_SPATIALLY_VARYING = 0, POLYNOMIAL = 1, CHEBYSHEV1 = 2 };
+
+/*
+ * Describe how a kernel's spatial variation is stored in the compact format; return false if the
+ * kernel cannot be stored in the compact format.
+ */
+bool getSpatialFunctionType(
+    afw::math::LinearCombinationKernel const & kernel,
+    SpatialFunctionType & type,
+    int & order,
+    afw::geom::Box2D & xyRange
+) {
+    afw::math::KernelList const & basis = kernel.getKernelList();
+    for (afw::math::KernelList::const_iterator iter = basis.begin(); iter != basis.end(); ++iter) {
+        if (!boost::dynamic_pointer_cast<afw::math::FixedKernel const>(*iter)) {
+            return false;
+        }
+    }
+    if (!kernel.isSpatiallyVarying()) {
+        type = NOT_SPATIALLY_VARYING;
+        order = 0;
+        return true;
+    }
+    std::vector<afw::math::Kernel::SpatialFunctionPtr> const functions = kernel.getSpatialFunctionList();
+    for (std::size_t i = 0; i < functions.size(); ++i) {
+        SpatialFunctionType thisType;
+        int thisOrder;
+        afw::geom::Box2D thisRange(afw::geom::Point2D(0, 0), afw::geom::Point2D(0, 0)); // Chebyshev only
+        if (PTR(afw::math::PolynomialFunction2<double> const) poly =
+                boost::dynamic_pointer_cast<afw::math::PolynomialFunction2<double> const>(functions[i])) {
+            thisType = POLYNOMIAL;
+            thisOrder = poly->getOrder();
+        } else if (PTR(afw::math::Chebyshev1Function2<double> const) cheby =
+                boost::dynamic_pointer_cast<afw::math::Chebyshev1Function2<double> const>(functions[i])) {
+            thisType = CHEBYSHEV1;
+            thisOrder = cheby->getOrder();
+            thisRange = cheby->getXYRange();
+        } else {
+            return false;
+        }
+        if (i == 0) {
+            type = thisType;
+            order = thisOrder;
+            xyRange = thisRange;
+        } else if (thisType != type || thisOrder != order || thisRange != xyRange) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Factory for the compact format.  The schema depends on the size and number of the basis images,
+ * so the keys are looked up by name.
+ */
+class CompactPcaPsfFactory : public tbl::io::PersistableFactory {
+public:
+
+    virtual PTR(tbl::io::Persistable)
+    read(tbl::io::InputArchive const & archive, tbl::io::CatalogVector const & catalogs) const {
+        LSST_ARCHIVE_ASSERT(catalogs.size() == 1u);
+        LSST_ARCHIVE_ASSERT(catalogs.front().size() == 1u);
+        tbl::BaseRecord const & record = catalogs.front().front();
+        tbl::Schema const schema = record.getSchema();
+        tbl::PointKey<double> const averagePositionKey(schema["averagePosition"]);
+        tbl::PointKey<int> const ctrKey(schema["ctr"]);
+        tbl::Key<int> const widthKey = schema["width"];
+        tbl::Key<int> const heightKey = schema["height"];
+        tbl::Key<int> const nComponentsKey = schema["nComponents"];
+        tbl::Key<int> const spatialFunctionKey = schema["spatialFunction"];
+        tbl::Key<int> const spatialOrderKey = schema["spatialOrder"];
+        tbl::PointKey<double> const xyRangeMinKey(schema["xyRange_min"]);
+        tbl::PointKey<double> const xyRangeMaxKey(schema["xyRange_max"]);
+        tbl::Key< tbl::Array<float> > const basisKey = schema["basis"];
+        tbl::Key< tbl::Array<double> > const coefficientsKey = schema["coefficients"];
+
+        int const width = record.get(widthKey);
+        int const height = record.get(heightKey);
+        int const nComponents = record.get(nComponentsKey);
+        LSST_ARCHIVE_ASSERT(width > 0 && height > 0 && nComponents > 0);
+        LSST_ARCHIVE_ASSERT(basisKey.getSize() == nComponents*width*height);
+        LSST_ARCHIVE_ASSERT(coefficientsKey.getSize() % nComponents == 0);
+        int const nCoefficients = coefficientsKey.getSize()/nComponents;
+
+        ndarray::Array<float const,1,1> const basis = record.get(basisKey);
+        ndarray::Array<double const,1,1> const coefficients = record.get(coefficientsKey);
+
+        afw::math::KernelList kernelList;
+        kernelList.reserve(nComponents);
+        ndarray::Array<float const,1,1>::Iterator pixel = basis.begin();
+        for (int i = 0; i < nComponents; ++i) {
+            afwImage::Image<double> image(width, height);
+            for (int y = 0; y < height; ++y) {
+                afwImage::Image<double>::x_iterator ptr = image.row_begin(y);
+                for (int x = 0; x < width; ++x, ++ptr, ++pixel) {
+                    *ptr = *pixel;
+                }
+            }
+            kernelList.push_back(boost::make_shared<afw::math::FixedKernel>(image));
+        }
+
+        PTR(afw::math::LinearCombinationKernel) kernel;
+        SpatialFunctionType const type = static_cast<SpatialFunctionType>(record.get(spatialFunctionKey));
+        if (type == NOT_SPATIALLY_VARYING) {
+            LSST_ARCHIVE_ASSERT(nCoefficients == 1);
+            std::vector<double> const parameters(coefficients.begin(), coefficients.end());
+            kernel = boost::make_shared<afw::math::LinearCombinationKernel>(kernelList, parameters);
+        } else {
+            int const order = record.get(spatialOrderKey);
+            afw::geom::Box2D const xyRange(record.get(xyRangeMinKey), record.get(xyRangeMaxKey));
+            std::vector<afw::math::Kernel::SpatialFunctionPtr> functions;
+            functions.reserve(nComponents);
+            for (int i = 0; i < nComponents; ++i) {
+                afw::math::Kernel::SpatialFunctionPtr function;
+                if (type == POLYNOMIAL) {
+                    function = boost::make_shared< afw::math::PolynomialFunction2<double> >(order);
+                } else {
+                    LSST_ARCHIVE_ASSERT(type == CHEBYSHEV1);
+                    function = boost::make_shared< afw::math::Chebyshev1Function2<double> >(order, xyRange);
+                }
+                LSST_ARCHIVE_ASSERT(function->getNParameters() == static_cast<unsigned int>(nCoefficients));
+                function->setParameters(std::vector<double>(coefficients.begin() + i*nCoefficients,
+                                                            coefficients.begin() + (i + 1)*nCoefficients));
+                functions.push_back(function);
+            }
+            kernel = boost::make_shared<afw::math::LinearCombinationKernel>(kernelList, functions);
+        }
+        kernel->setCtr(record.get(ctrKey));
+        return boost::make_shared<PcaPsf>(kernel, record.get(averagePositionKey));
+    }
+
+    CompactPcaPsfFactory(std::string const & name) : tbl::io::PersistableFactory(name) {}
+
+};
+
+CompactPcaPsfFactory compactRegistration(COMPACT_PERSISTENCE_NAME);
+
 } // anonymous
 
+void PcaPsf::setCompactPersistence(bool compact) {
+    compactPersistence = compact;
+}
+
+bool PcaPsf::getCompactPersistence() {
+    return compactPersistence;
+}
+
+bool PcaPsf::_isWrittenCompact() const {
+    SpatialFunctionType type;
+    int order;
+    afw::geom::Box2D xyRange;
+    return compactPersistence && getSpatialFunctionType(*getKernel(), type, order, xyRange);
+}
+
+std::string PcaPsf::getPersistenceName() const {
+    return _isWrittenCompact() ? COMPACT_PERSISTENCE_NAME : "PcaPsf";
+}
+
+void PcaPsf::write(OutputArchiveHandle & handle) const {
+    PTR(afw::math::LinearCombinationKernel const) kernel = getKernel();
+    SpatialFunctionType type;
+    int order;
+    afw::geom::Box2D xyRange;
+    if (!compactPersistence || !getSpatialFunctionType(*kernel, type, order, xyRange)) {
+        KernelPsf::write(handle);
+        return;
+    }
+
+    afw::math::KernelList const & kernelList = kernel->getKernelList();
+    int const nComponents = kernelList.size();
+    int const width = kernel->getWidth();
+    int const height = kernel->getHeight();
+    std::vector<double> coefficients;
+    if (type == NOT_SPATIALLY_VARYING) {
+        coefficients = kernel->getKernelParameters();
+    } else {
+        std::vector<afw::math::Kernel::SpatialFunctionPtr> const functions = kernel->getSpatialFunctionList();
+        for (int i = 0; i < nComponents; ++i) {
+            std::vector<double> const parameters = functions[i]->getParameters();
+            coefficients.insert(coefficients.end(), parameters.begin(), parameters.end());
+        }
+    }
+
+    tbl::Schema schema;
+    tbl::PointKey<double> const averagePositionKey = tbl::PointKey<double>::addFields(
+        schema, "averagePosition", "average position of stars used to make the PSF", "pixels"
+    );
+    tbl::PointKey<int> const ctrKey = tbl::PointKey<int>::addFields(
+        schema, "ctr", "center of the kernel", "pixels"
+    );
+    tbl::Key<int> const widthKey = schema.addField<int>("width", "width of the basis images", "pixels");
+    tbl::Key<int> const heightKey = schema.addField<int>("height", "height of the basis images", "pixels");
+    tbl::Key<int> const nComponentsKey = schema.addField<int>("nComponents", "number of basis images");
+    tbl::Key<int> const spatialFunctionKey = schema.addField<int>(
+        "spatialFunction", "kind of spatial function: 0=none, 1=PolynomialFunction2, 2=Chebyshev1Function2"
+    );
+    tbl::Key<int> const spatialOrderKey = schema.addField<int>("spatialOrder", "order of spatial functions");
+    tbl::PointKey<double> const xyRangeMinKey = tbl::PointKey<double>::addFields(
+        schema, "xyRange_min", "minimum corner of the range of Chebyshev1Function2s", "pixels"
+    );
+    tbl::PointKey<double> const xyRangeMaxKey = tbl::PointKey<double>::addFields(
+        schema, "xyRange_max", "maximum corner of the range of Chebyshev1Function2s", "pixels"
+    );
+    tbl::Key< tbl::Array<float> > const basisKey = schema.addField< tbl::Array<float> >(
+        "basis", "basis images, each in row-major order", nComponents*width*height
+    );
+    tbl::Key< tbl::Array<double> > const coefficientsKey = schema.addField< tbl::Array<double> >(
+        "coefficients",
+        "parameters of the spatial function of each basis image, or the kernel parameters if not spatially "
+        "varying", coefficients.size()
+    );
+
+    tbl::BaseCatalog catalog = handle.makeCatalog(schema);
+    PTR(tbl::BaseRecord) record = catalog.addNew();
+    record->set(averagePositionKey, getAveragePosition());
+    record->set(ctrKey, kernel->getCtr());
+    record->set(widthKey, width);
+    record->set(heightKey, height);
+    record->set(nComponentsKey, nComponents);
+    record->set(spatialFunctionKey, static_cast<int>(type));
+    record->set(spatialOrderKey, order);
+    record->set(xyRangeMinKey, xyRange.getMin());
+    record->set(xyRangeMaxKey, xyRange.getMax());
+
+    ndarray::ArrayRef<float,1,1> const basis = (*record)[basisKey];
+    ndarray::ArrayRef<float,1,1>::Iterator pixel = basis.begin();
+    afwImage::Image<double> image(width, height);
+    for (int i = 0; i < nComponents; ++i) {
+        kernelList[i]->computeImage(image, false);
+        for (int y = 0; y < height; ++y) {
+            for (afwImage::Image<double>::x_iterator ptr = image.row_begin(y), end = image.row_end(y);
+                 ptr != end; ++ptr, ++pixel) {
+                *pixel = *ptr;
+            }
+        }
+    }
+    std::copy(coefficients.begin(), coefficients.end(), (*record)[coefficientsKey].begin());
+    handle.saveCatalog(catalog);
+}
+
 }}} // namespace lsst::meas::algorithms
 
 namespace lsst { namespace afw { namespace detection {
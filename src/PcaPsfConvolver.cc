@@ -0,0 +1,327 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include <algorithm>
+#include <complex>
+#include <vector>
+
+#include "boost/format.hpp"
+#include "unsupported/Eigen/FFT"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/afw/image/ImageUtils.h"
+#include "lsst/meas/algorithms/Instrumentation.h"
+#include "lsst/meas/algorithms/PcaPsfConvolver.h"
+#include "lsst/meas/algorithms/ThreadPool.h"
+
+namespace lsst { namespace meas { namespace algorithms {
+
+namespace {
+
+typedef std::complex<double> Complex;
+
+/*
+ * In-place 2-d FFT of an n x n array stored by rows; the inverse transform is scaled by 1/n^2
+ */
+void fft2(Eigen::FFT<double> & fft, std::vector<Complex> & data, std::vector<Complex> & buffer, int n,
+          bool inverse) {
+    buffer.resize(2*n);
+    Complex * const in = &buffer[0];
+    Complex * const out = &buffer[n];
+    for (int y = 0; y < n; ++y) {
+        Complex * const row = &data[y*n];
+        std::copy(row, row + n, in);
+        if (inverse) {
+            fft.inv(row, in, n);
+        } else {
+            fft.fwd(row, in, n);
+        }
+    }
+    for (int x = 0; x < n; ++x) {
+        for (int y = 0; y < n; ++y) {
+            in[y] = data[y*n + x];
+        }
+        if (inverse) {
+            fft.inv(out, in, n);
+        } else {
+            fft.fwd(out, in, n);
+        }
+        for (int y = 0; y < n; ++y) {
+            data[y*n + x] = out[y];
+        }
+    }
+}
+
+/*
+ * Convolve the tiles of an image.  The good region of the output (the pixels for which the kernel
+ * lies entirely within the input) is divided into blocks of (n - kernel width + 1) by
+ * (n - kernel height + 1) pixels; each block is computed from one n x n tile of the input, so the
+ * circular correlation computed by the FFT never wraps for the pixels we keep.
+ */
+template <typename OutPixelT, typename InPixelT>
+class ConvolveTilesTask : public ParallelTask {
+public:
+    ConvolveTilesTask(
+        afw::image::Image<OutPixelT> & convolvedImage,
+        afw::image::Image<InPixelT> const & inImage,
+        afw::math::LinearCombinationKernel const & kernel,
+        std::vector<std::vector<Complex> > const & spectra,
+        std::vector<double> const & basisSums,
+        int n,
+        bool doNormalize
+    ) : ParallelTask(), _convolvedImage(convolvedImage), _inImage(inImage), _kernel(kernel),
+        _spectra(spectra), _basisSums(basisSums), _n(n), _doNormalize(doNormalize),
+        _blockWidth(n - kernel.getWidth() + 1), _blockHeight(n - kernel.getHeight() + 1),
+        _goodWidth(inImage.getWidth() - kernel.getWidth() + 1),
+        _goodHeight(inImage.getHeight() - kernel.getHeight() + 1),
+        _nTileX((_goodWidth + _blockWidth - 1)/_blockWidth)
+    {}
+
+    int getNTiles() const {
+        return _nTileX*((_goodHeight + _blockHeight - 1)/_blockHeight);
+    }
+
+    virtual void operator()(int begin, int end) {
+        int const nBasis = _spectra.size();
+        // Each chunk has its own FFT plans, buffers, and spatial functions, as afw's Functions may
+        // cache intermediate results and so may not be evaluated concurrently
+        Eigen::FFT<double> fft;
+        std::vector<afw::math::Kernel::SpatialFunctionPtr> functions;
+        if (_kernel.isSpatiallyVarying()) {
+            std::vector<afw::math::Kernel::SpatialFunctionPtr> const list = _kernel.getSpatialFunctionList();
+            for (std::size_t k = 0; k < list.size(); ++k) {
+                functions.push_back(list[k]->clone());
+            }
+        }
+        std::vector<double> const parameters = _kernel.getKernelParameters();
+
+        std::vector<Complex> transform(_n*_n), product(_n*_n), buffer;
+        std::vector<double> coeffs(nBasis*_blockWidth*_blockHeight);
+        std::vector<double> sums(_blockWidth*_blockHeight);
+        std::vector<double> result(_blockWidth*_blockHeight);
+
+        for (int tile = begin; tile < end; ++tile) {
+            // pixel (a, b) of the block is pixel (x0 + a + ctrX, y0 + b + ctrY) of the output and
+            // depends on pixels (x0 + a, y0 + b) to (x0 + a + width - 1, y0 + b + height - 1) of the input
+            int const x0 = (tile%_nTileX)*_blockWidth;
+            int const y0 = (tile/_nTileX)*_blockHeight;
+            int const width = std::min(_blockWidth, _goodWidth - x0);
+            int const height = std::min(_blockHeight, _goodHeight - y0);
+
+            std::fill(transform.begin(), transform.end(), Complex(0.0, 0.0));
+            for (int v = 0; v < height + _kernel.getHeight() - 1; ++v) {
+                typename afw::image::Image<InPixelT>::const_x_iterator ptr = _inImage.x_at(x0, y0 + v);
+                for (int u = 0; u < width + _kernel.getWidth() - 1; ++u, ++ptr) {
+                    transform[v*_n + u] = *ptr;
+                }
+            }
+            fft2(fft, transform, buffer, _n, false);
+
+            // Weights of the basis images at each output pixel
+            for (int b = 0; b < height; ++b) {
+                double const yPos = afw::image::indexToPosition(y0 + b + _kernel.getCtrY() +
+                                                                _inImage.getY0());
+                for (int a = 0; a < width; ++a) {
+                    double const xPos = afw::image::indexToPosition(x0 + a + _kernel.getCtrX() +
+                                                                    _inImage.getX0());
+                    double sum = 0.0;
+                    for (int k = 0; k < nBasis; ++k) {
+                        double const c = functions.empty() ? parameters[k] : (*functions[k])(xPos, yPos);
+                        coeffs[(k*height + b)*width + a] = c;
+                        sum += c*_basisSums[k];
+                    }
+                    sums[b*width + a] = sum;
+                }
+            }
+
+            std::fill(result.begin(), result.end(), 0.0);
+            for (int k = 0; k < nBasis; k += 2) {
+                // Both correlations are real, so two can share one inverse transform
+                bool const pair = (k + 1 < nBasis);
+                std::vector<Complex> const & spectrum0 = _spectra[k];
+                for (int i = 0; i < _n*_n; ++i) {
+                    product[i] = transform[i]*spectrum0[i];
+                }
+                if (pair) {
+                    std::vector<Complex> const & spectrum1 = _spectra[k + 1];
+                    for (int i = 0; i < _n*_n; ++i) {
+                        product[i] += Complex(0.0, 1.0)*transform[i]*spectrum1[i];
+                    }
+                }
+                fft2(fft, product, buffer, _n, true);
+
+                for (int b = 0; b < height; ++b) {
+                    double const * c0 = &coeffs[(k*height + b)*width];
+                    double const * c1 = pair ? &coeffs[((k + 1)*height + b)*width] : 0;
+                    for (int a = 0; a < width; ++a) {
+                        Complex const value = product[b*_n + a];
+                        result[b*width + a] += c0[a]*value.real() + (pair ? c1[a]*value.imag() : 0.0);
+                    }
+                }
+            }
+
+            for (int b = 0; b < height; ++b) {
+                typename afw::image::Image<OutPixelT>::x_iterator ptr =
+                    _convolvedImage.x_at(x0 + _kernel.getCtrX(), y0 + b + _kernel.getCtrY());
+                for (int a = 0; a < width; ++a, ++ptr) {
+                    double value = result[b*width + a];
+                    if (_doNormalize) {
+                        double const sum = sums[b*width + a];
+                        if (sum == 0.0) {
+                            throw LSST_EXCEPT(pex::exceptions::OverflowError, "Kernel image sums to 0");
+                        }
+                        value /= sum;
+                    }
+                    *ptr = static_cast<OutPixelT>(value);
+                }
+            }
+        }
+    }
+
+private:
+    afw::image::Image<OutPixelT> & _convolvedImage;
+    afw::image::Image<InPixelT> const & _inImage;
+    afw::math::LinearCombinationKernel const & _kernel;
+    std::vector<std::vector<Complex> > const & _spectra;
+    std::vector<double> const & _basisSums;
+    int const _n;
+    bool const _doNormalize;
+    int const _blockWidth, _blockHeight;        // size of the output block computed from each tile
+    int const _goodWidth, _goodHeight;          // size of the region of the output that we compute
+    int const _nTileX;                          // number of tiles in each row
+};
+
+/*
+ * Set the edge pixels (those not set by ConvolveTilesTask) as afw::math::convolve does: copy them from
+ * the input if doCopyEdge, else set them to the standard edge pixel (NaN for floating-point images)
+ */
+template <typename OutPixelT, typename InPixelT>
+void setEdge(
+    afw::image::Image<OutPixelT> & convolvedImage,
+    afw::image::Image<InPixelT> const & inImage,
+    afw::math::Kernel const & kernel,
+    bool doCopyEdge
+) {
+    typedef afw::image::Image<OutPixelT> OutImageT;
+    OutPixelT const edgePixel = afw::math::edgePixel<OutImageT>(
+        typename afw::image::detail::image_traits<OutImageT>::image_category()
+    );
+    int const x0 = kernel.getCtrX();
+    int const x1 = inImage.getWidth() - kernel.getWidth() + kernel.getCtrX();       // inclusive
+    int const y0 = kernel.getCtrY();
+    int const y1 = inImage.getHeight() - kernel.getHeight() + kernel.getCtrY();    // inclusive
+    for (int y = 0; y < inImage.getHeight(); ++y) {
+        bool const goodRow = (y >= y0 && y <= y1);
+        typename afw::image::Image<InPixelT>::const_x_iterator inPtr = inImage.row_begin(y);
+        typename afw::image::Image<OutPixelT>::x_iterator outPtr = convolvedImage.row_begin(y);
+        for (int x = 0; x < inImage.getWidth(); ++x, ++inPtr, ++outPtr) {
+            if (!goodRow || x < x0 || x > x1) {
+                *outPtr = doCopyEdge ? static_cast<OutPixelT>(*inPtr) : edgePixel;
+            }
+        }
+    }
+}
+
+} // anonymous
+
+PcaPsfConvolver::PcaPsfConvolver(PcaPsf const & psf, int fftSize) :
+    _kernel(psf.getKernel()), _fftSize(fftSize), _basisSums(), _spectra()
+{
+    if (fftSize < _kernel->getWidth() || fftSize < _kernel->getHeight()) {
+        throw LSST_EXCEPT(
+            pex::exceptions::InvalidParameterError,
+            (boost::format("FFT size %d is smaller than the kernel (%dx%d)")
+             % fftSize % _kernel->getWidth() % _kernel->getHeight()).str()
+        );
+    }
+
+    afw::math::KernelList const & basis = _kernel->getKernelList();
+    _basisSums.reserve(basis.size());
+    _spectra.reserve(basis.size());
+    Eigen::FFT<double> fft;
+    std::vector<Complex> buffer;
+    afw::image::Image<double> image(_kernel->getDimensions());
+    for (afw::math::KernelList::const_iterator iter = basis.begin(); iter != basis.end(); ++iter) {
+        _basisSums.push_back((*iter)->computeImage(image, false));
+
+        std::vector<Complex> spectrum(fftSize*fftSize, Complex(0.0, 0.0));
+        for (int y = 0; y < image.getHeight(); ++y) {
+            afw::image::Image<double>::x_iterator ptr = image.row_begin(y);
+            for (int x = 0; x < image.getWidth(); ++x, ++ptr) {
+                spectrum[y*fftSize + x] = *ptr;
+            }
+        }
+        fft2(fft, spectrum, buffer, fftSize, false);
+        // afw::math::convolve correlates the image with the kernel, so we need the conjugate
+        for (std::vector<Complex>::iterator ptr = spectrum.begin(); ptr != spectrum.end(); ++ptr) {
+            *ptr = std::conj(*ptr);
+        }
+        _spectra.push_back(spectrum);
+    }
+}
+
+template <typename OutPixelT, typename InPixelT>
+void PcaPsfConvolver::convolve(
+    afw::image::Image<OutPixelT> & convolvedImage,
+    afw::image::Image<InPixelT> const & inImage,
+    afw::math::ConvolutionControl const & control
+) const {
+    if (convolvedImage.getDimensions() != inImage.getDimensions()) {
+        throw LSST_EXCEPT(
+            pex::exceptions::InvalidParameterError,
+            (boost::format("convolvedImage dimensions = (%d, %d) != (%d, %d) = inImage dimensions")
+             % convolvedImage.getWidth() % convolvedImage.getHeight()
+             % inImage.getWidth() % inImage.getHeight()).str()
+        );
+    }
+    if (inImage.getWidth() < _kernel->getWidth() || inImage.getHeight() < _kernel->getHeight()) {
+        throw LSST_EXCEPT(
+            pex::exceptions::InvalidParameterError,
+            (boost::format("inImage (%dx%d) is smaller than the kernel (%dx%d)")
+             % inImage.getWidth() % inImage.getHeight() % _kernel->getWidth() % _kernel->getHeight()).str()
+        );
+    }
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "PcaPsfConvolver.convolve");
+
+    ConvolveTilesTask<OutPixelT, InPixelT> task(convolvedImage, inImage, *_kernel, _spectra, _basisSums,
+                                                _fftSize, control.getDoNormalize());
+    LSST_MEAS_ALGORITHMS_COUNT("PcaPsfConvolver.tiles", task.getNTiles());
+    parallelFor(task.getNTiles(), task, 1);
+
+    setEdge(convolvedImage, inImage, *_kernel, control.getDoCopyEdge());
+}
+
+// \cond
+#define INSTANTIATE(OUTPIXEL, INPIXEL) \
+    template void PcaPsfConvolver::convolve( \
+        afw::image::Image<OUTPIXEL> &, afw::image::Image<INPIXEL> const &, \
+        afw::math::ConvolutionControl const & \
+    ) const
+
+INSTANTIATE(float, float);
+INSTANTIATE(double, double);
+INSTANTIATE(double, float);
+// \endcond
+
+}}} // namespace lsst::meas::algorithms
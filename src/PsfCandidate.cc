@@ -29,6 +29,8 @@
  *
  * @ingroup algorithms
  */
+#include "boost/format.hpp"
+
 #include "lsst/afw/detection/Footprint.h"
 #include "lsst/afw/detection/FootprintFunctor.h"
 #include "lsst/afw/geom/Point.h"
@@ -36,6 +38,7 @@
 #include "lsst/afw/geom/Box.h"
 #include "lsst/afw/image/ImageAlgorithm.h"
 #include "lsst/afw/math/offsetImage.h"
+#include "lsst/meas/algorithms/Instrumentation.h"
 #include "lsst/meas/algorithms/PsfCandidate.h"
 
 namespace afwDetection = lsst::afw::detection;
@@ -301,6 +304,7 @@ measAlg::PsfCandidate<PixelT>::getMaskedImage(int width, int height) const {
     }
 
     if (!_haveImage) {
+        LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "PsfCandidate.extract");
         _image = extractImage(width, height);
         _haveImage = true;
     }
@@ -356,6 +360,64 @@ measAlg::PsfCandidate<PixelT>::getOffsetImage(
     return _offsetImage;
 }
 
+/**
+ * @brief Return an image of the source resampled onto a grid oversampled by a factor of oversampling
+ *
+ * The source's image is resampled at N = oversampling sub-pixel phases in each dimension, and the phases
+ * are interleaved: pixel (N*i + kx, N*j + ky) of the returned image is the (pixel-integrated) image of the
+ * source sampled at an offset of (i - width/2 + (kx + 0.5)/N - 0.5, j - height/2 + (ky + 0.5)/N - 0.5)
+ * pixels from its centre.  With oversampling == 1 this is the same as getOffsetImage().
+ *
+ * @throw lsst::pex::exceptions::InvalidParameterError if oversampling < 1 or buffer < 1
+ */
+template <typename PixelT>
+PTR(afwImage::MaskedImage<PixelT>)
+measAlg::PsfCandidate<PixelT>::getOversampledImage(
+    int oversampling,                   // Oversampling factor
+    std::string const algorithm,        // Warping algorithm to use
+    unsigned int buffer                 // Buffer for warping; must be at least 1
+) const {
+    if (oversampling < 1 || buffer < 1) {
+        throw LSST_EXCEPT(lsst::pex::exceptions::InvalidParameterError,
+                          (boost::format("Oversampling (%d) and buffer (%d) must both be >= 1")
+                           % oversampling % buffer).str());
+    }
+    int const width = getWidth() == 0 ? _defaultWidth : getWidth();
+    int const height = getHeight() == 0 ? _defaultWidth : getHeight();
+
+    PTR(MaskedImageT) image = extractImage(width + 2*buffer, height + 2*buffer);
+
+    double const dx = afwImage::positionToIndex(getXCenter(), true).second;
+    double const dy = afwImage::positionToIndex(getYCenter(), true).second;
+
+    PTR(MaskedImageT) result(new MaskedImageT(afwGeom::Extent2I(oversampling*width, oversampling*height)));
+    for (int ky = 0; ky != oversampling; ++ky) {
+        for (int kx = 0; kx != oversampling; ++kx) {
+            // Shift by the sub-pixel part of the total offset; the integer part selects the sub-image
+            std::pair<int, double> const shiftX =
+                afwImage::positionToIndex(dx + (kx + 0.5)/oversampling - 0.5, true);
+            std::pair<int, double> const shiftY =
+                afwImage::positionToIndex(dy + (ky + 0.5)/oversampling - 0.5, true);
+            PTR(MaskedImageT) offset = afwMath::offsetImage(*image, -shiftX.second, -shiftY.second, algorithm);
+            afwGeom::Box2I const box(afwGeom::Point2I(buffer + shiftX.first, buffer + shiftY.first),
+                                     afwGeom::Extent2I(width, height));
+            MaskedImageT const shifted(*offset, box, afwImage::LOCAL);
+
+            for (int y = 0; y != height; ++y) {
+                typename MaskedImageT::const_x_iterator ptr = shifted.row_begin(y);
+                for (int x = 0; x != width; ++x, ++ptr) {
+                    int const xOut = oversampling*x + kx;
+                    int const yOut = oversampling*y + ky;
+                    (*result->getImage())(xOut, yOut) = ptr.image();
+                    (*result->getMask())(xOut, yOut) = ptr.mask();
+                    (*result->getVariance())(xOut, yOut) = ptr.variance();
+                }
+            }
+        }
+    }
+
+    return result;
+}
 
 /************************************************************************************************************/
 //
@@ -0,0 +1,223 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "boost/format.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/meas/algorithms/Instrumentation.h"
+#include "lsst/meas/algorithms/PsfRendering.h"
+#include "lsst/meas/algorithms/ThreadPool.h"
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+
+namespace {
+
+typedef afw::detection::Psf::Image PsfImage;
+
+/// Largest integer <= a/b, for b > 0
+int floorDiv(int a, int b) {
+    return (a >= 0) ? a/b : -((-a + b - 1)/b);
+}
+
+/// Where to add one source's PSF image
+struct Stamp {
+    Stamp() : realization(-1), dx(0), dy(0), flux(0.0), bbox() {}
+
+    int realization;                    // index of the PSF image to add
+    int dx, dy;                         // shift to apply to the PSF image
+    double flux;
+    afw::geom::Box2I bbox;              // pixels to add (shifted; parent coordinates), clipped to the image
+};
+
+/*
+ * Add the stamps that overlap each band of rows to the image
+ */
+template <typename PixelT>
+class AddStampsTask : public ParallelTask {
+public:
+    AddStampsTask(
+        afw::image::MaskedImage<PixelT> & image,
+        std::vector<PTR(PsfImage)> const & realizations,
+        std::vector<Stamp> const & stamps,
+        std::vector<std::vector<int> > const & bands,
+        int bandHeight,
+        double gain
+    ) : ParallelTask(), _image(image), _realizations(realizations), _stamps(stamps), _bands(bands),
+        _bandHeight(bandHeight), _gain(gain)
+    {}
+
+    virtual void operator()(int begin, int end) {
+        for (int band = begin; band < end; ++band) {
+            int const bandY0 = _image.getY0() + band*_bandHeight;
+            int const bandY1 = bandY0 + _bandHeight - 1;
+            std::vector<int> const & indices = _bands[band];
+            for (std::vector<int>::const_iterator iter = indices.begin(); iter != indices.end(); ++iter) {
+                _add(_stamps[*iter], std::max(bandY0, _stamps[*iter].bbox.getMinY()),
+                     std::min(bandY1, _stamps[*iter].bbox.getMaxY()));
+            }
+        }
+    }
+
+private:
+    // Add rows y0..y1 (parent coordinates) of a stamp
+    void _add(Stamp const & stamp, int y0, int y1) {
+        PsfImage const & psfImage = *_realizations[stamp.realization];
+        int const x0 = stamp.bbox.getMinX();
+        int const width = stamp.bbox.getWidth();
+        for (int y = y0; y <= y1; ++y) {
+            PsfImage::const_x_iterator psfPtr = psfImage.x_at(x0 - stamp.dx - psfImage.getX0(),
+                                                              y - stamp.dy - psfImage.getY0());
+            typename afw::image::MaskedImage<PixelT>::x_iterator ptr =
+                _image.x_at(x0 - _image.getX0(), y - _image.getY0());
+            for (int i = 0; i < width; ++i, ++psfPtr, ++ptr) {
+                double const value = stamp.flux*(*psfPtr);
+                ptr.image() += value;
+                if (_gain > 0) {
+                    ptr.variance() += value/_gain;
+                }
+            }
+        }
+    }
+
+    afw::image::MaskedImage<PixelT> & _image;
+    std::vector<PTR(PsfImage)> const & _realizations;
+    std::vector<Stamp> const & _stamps;
+    std::vector<std::vector<int> > const & _bands;
+    int const _bandHeight;
+    double const _gain;
+};
+
+} // anonymous namespace
+
+template <typename PixelT>
+int addPsfImages(
+    afw::image::MaskedImage<PixelT> & image,
+    afw::detection::Psf const & psf,
+    std::vector<double> const & x,
+    std::vector<double> const & y,
+    std::vector<double> const & flux,
+    double subpixelTolerance,
+    int cellSize,
+    double gain
+) {
+    if (x.size() != y.size() || x.size() != flux.size()) {
+        throw LSST_EXCEPT(pex::exceptions::LengthError,
+                          (boost::format("Saw %d x, %d y and %d flux values")
+                           % x.size() % y.size() % flux.size()).str());
+    }
+    if (cellSize < 1) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          (boost::format("Cell size must be >= 1; saw %d") % cellSize).str());
+    }
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "addPsfImages");
+
+    int const nSource = x.size();
+    int const nSub = (subpixelTolerance > 0) ? static_cast<int>(std::ceil(1.0/subpixelTolerance)) : 0;
+    afw::geom::Box2I const imageBBox = image.getBBox(afw::image::PARENT);
+    /*
+     * Compute the PSF images; when reusing them, each is identified by its cell and sub-pixel phase
+     */
+    typedef std::pair<std::pair<int, int>, std::pair<int, int> > Key;
+    std::map<Key, int> keys;
+    std::vector<PTR(PsfImage)> realizations;
+    std::vector<Stamp> stamps(nSource);
+    for (int i = 0; i < nSource; ++i) {
+        Stamp & stamp = stamps[i];
+        stamp.flux = flux[i];
+        if (nSub == 0) {
+            stamp.realization = realizations.size();
+            realizations.push_back(psf.computeImage(afw::geom::Point2D(x[i], y[i])));
+        } else {
+            // position rounded to the sub-pixel grid, as a whole number of pixels and a phase
+            double const sx = std::floor(x[i]*nSub + 0.5), sy = std::floor(y[i]*nSub + 0.5);
+            int const ix = static_cast<int>(std::floor(sx/nSub));
+            int const iy = static_cast<int>(std::floor(sy/nSub));
+            int const phaseX = static_cast<int>(sx - static_cast<double>(ix)*nSub);
+            int const phaseY = static_cast<int>(sy - static_cast<double>(iy)*nSub);
+            int const cellX = floorDiv(ix - image.getX0(), cellSize);
+            int const cellY = floorDiv(iy - image.getY0(), cellSize);
+            int const centerX = image.getX0() + cellX*cellSize + cellSize/2;
+            int const centerY = image.getY0() + cellY*cellSize + cellSize/2;
+
+            Key const key(std::make_pair(cellX, cellY), std::make_pair(phaseX, phaseY));
+            std::map<Key, int>::const_iterator iter = keys.find(key);
+            if (iter == keys.end()) {
+                afw::geom::Point2D const position(centerX + static_cast<double>(phaseX)/nSub,
+                                                  centerY + static_cast<double>(phaseY)/nSub);
+                iter = keys.insert(std::make_pair(key, static_cast<int>(realizations.size()))).first;
+                realizations.push_back(psf.computeImage(position));
+            }
+            stamp.realization = iter->second;
+            stamp.dx = ix - centerX;
+            stamp.dy = iy - centerY;
+        }
+        afw::geom::Box2I bbox = realizations[stamp.realization]->getBBox(afw::image::PARENT);
+        bbox.shift(afw::geom::Extent2I(stamp.dx, stamp.dy));
+        bbox.clip(imageBBox);
+        stamp.bbox = bbox;
+    }
+    LSST_MEAS_ALGORITHMS_COUNT("addPsfImages.realizations", realizations.size());
+    /*
+     * Assign each source to all the bands of rows that it touches, in order, and add them
+     */
+    int const nBand = (image.getHeight() + cellSize - 1)/cellSize;
+    std::vector<std::vector<int> > bands(nBand);
+    for (int i = 0; i < nSource; ++i) {
+        if (stamps[i].bbox.isEmpty()) {
+            continue;
+        }
+        int const band0 = (stamps[i].bbox.getMinY() - image.getY0())/cellSize;
+        int const band1 = (stamps[i].bbox.getMaxY() - image.getY0())/cellSize;
+        for (int band = band0; band <= band1; ++band) {
+            bands[band].push_back(i);
+        }
+    }
+
+    AddStampsTask<PixelT> task(image, realizations, stamps, bands, cellSize, gain);
+    parallelFor(nBand, task, 1);
+
+    return realizations.size();
+}
+
+// \cond
+#define INSTANTIATE(PIXTYPE) \
+    template int addPsfImages( \
+        afw::image::MaskedImage<PIXTYPE> &, afw::detection::Psf const &, \
+        std::vector<double> const &, std::vector<double> const &, std::vector<double> const &, \
+        double, int, double \
+    )
+
+INSTANTIATE(float);
+INSTANTIATE(double);
+// \endcond
+
+}}} // namespace lsst::meas::algorithms
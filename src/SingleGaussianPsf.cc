@@ -104,8 +104,18 @@ PTR(afw::math::Kernel) makeSingleGaussianKernel(int width, int height, double si
 } // anonymous
 
 SingleGaussianPsf::SingleGaussianPsf(int width, int height, double sigma) :
-    KernelPsf(makeSingleGaussianKernel(width, height, sigma)), _sigma(sigma)
-{}
+    KernelPsf(makeSingleGaussianKernel(width, height, sigma)), _sigma(sigma),
+    _kernelImage(boost::make_shared<Image>(getKernel()->getDimensions()))
+{
+    getKernel()->computeImage(*_kernelImage, true);
+    _kernelImage->setXY0(-getKernel()->getCtrX(), -getKernel()->getCtrY());
+}
+
+PTR(afw::detection::Psf::Image) SingleGaussianPsf::doComputeKernelImage(
+    afw::geom::Point2D const &, afw::image::Color const &
+) const {
+    return boost::make_shared<Image>(*_kernelImage, true);
+}
 
 PTR(afw::detection::Psf) SingleGaussianPsf::clone() const {
     return boost::make_shared<SingleGaussianPsf>(
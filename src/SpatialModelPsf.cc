@@ -39,6 +39,9 @@
 #   include "Minuit2/MnPrint.h"
 #endif
 
+#include "boost/format.hpp"
+#include "boost/make_shared.hpp"
+
 #include "Eigen/Core"
 #include "Eigen/Cholesky"
 #include "Eigen/SVD"
@@ -49,8 +52,10 @@
 #include "lsst/afw/geom/Point.h"
 #include "lsst/afw/geom/Box.h"
 #include "lsst/meas/algorithms/ImagePca.h"
+#include "lsst/meas/algorithms/Instrumentation.h"
 #include "lsst/meas/algorithms/SpatialModelPsf.h"
 #include "lsst/meas/algorithms/PsfCandidate.h"
+#include "lsst/meas/algorithms/ThreadPool.h"
 
 namespace afwDetection = lsst::afw::detection;
 namespace afwGeom = lsst::afw::geom;
@@ -68,6 +73,9 @@ std::string const WARP_ALGORITHM("lanczos5"); // Name of warping algorithm to us
 
 
 // A class to pass around to all our PsfCandidates which builds the PcaImageSet
+//
+// If oversampling > 1 the candidates' oversampled images (PsfCandidate::getOversampledImage) are used;
+// if positions isn't NULL, the position of each candidate added to imagePca is appended to it.
 template<typename PixelT>
 class SetPcaImageVisitor : public afwMath::CandidateVisitor {
     typedef afwImage::Image<PixelT> ImageT;
@@ -76,10 +84,14 @@ class SetPcaImageVisitor : public afwMath::CandidateVisitor {
 public:
     explicit SetPcaImageVisitor(
             PsfImagePca<MaskedImageT> *imagePca, // Set of Images to initialise
-            unsigned int const mask=0x0                    // Ignore pixels with any of these bits set
+            unsigned int const mask=0x0,                   // Ignore pixels with any of these bits set
+            int const oversampling=1,                      // Number of samples per pixel
+            std::vector<afwGeom::Point2D> *positions=NULL  // Positions of the candidates used, or NULL
                                ) :
         afwMath::CandidateVisitor(),
-        _imagePca(imagePca)
+        _imagePca(imagePca),
+        _oversampling(oversampling),
+        _positions(positions)
         {
             ;
         }
@@ -93,8 +105,9 @@ public:
         }
 
         try {
-            typename MaskedImageT::Ptr im = imCandidate->getOffsetImage(WARP_ALGORITHM,
-                                                                        WARP_BUFFER);
+            typename MaskedImageT::Ptr im = (_oversampling > 1) ?
+                imCandidate->getOversampledImage(_oversampling, WARP_ALGORITHM, WARP_BUFFER) :
+                imCandidate->getOffsetImage(WARP_ALGORITHM, WARP_BUFFER);
 
             
             //static int count = 0;
@@ -119,12 +132,18 @@ public:
             }
 
             _imagePca->addImage(im, imCandidate->getSource()->getPsfFlux());
+            if (_positions) {
+                _positions->push_back(afwGeom::Point2D(imCandidate->getXCenter(),
+                                                       imCandidate->getYCenter()));
+            }
         } catch(lsst::pex::exceptions::LengthError &) {
             return;
         }
     }
 private:
     PsfImagePca<MaskedImageT> *_imagePca; // the ImagePca we're building
+    int _oversampling;                    // number of samples per pixel
+    std::vector<afwGeom::Point2D> *_positions; // positions of the candidates added to _imagePca, or NULL
 };
 
 /************************************************************************************************************/
@@ -192,57 +211,23 @@ std::vector<typename ImageT::Ptr> offsetKernel(
     return kernelImages;
 }
 
-} // Anonymous namespace
-
-/************************************************************************************************************/
-/**
- * Return a Kernel::Ptr and a list of eigenvalues resulting from analysing the provided SpatialCellSet
- *
- * The Kernel is a LinearCombinationKernel of the first nEigenComponents eigenImages
+/*
+ * Do a PCA decomposition of the PSF candidates in imagePca and return the number of components to keep
+ * (eigenValues.size() is the number found).  The background level of the components kept is set to 0.0
  *
- * N.b. This is templated over the Pixel type of the science image
+ * We have "gappy" data;  in other words we don't want to include any pixels with INTRP set
  */
-template<typename PixelT>
-std::pair<afwMath::LinearCombinationKernel::Ptr, std::vector<double> > createKernelFromPsfCandidates(
-        afwMath::SpatialCellSet const& psfCells, ///< A SpatialCellSet containing PsfCandidates
-        lsst::afw::geom::Extent2I const& dims, ///< Dimensions of image
-        lsst::afw::geom::Point2I const& xy0,   ///< Origin of image
-        int const nEigenComponents,     ///< number of eigen components to keep; <= 0 => infty
-        int const spatialOrder,         ///< Order of spatial variation (cf. afw::math::PolynomialFunction2)
-        int const ksize,                ///< Size of generated Kernel images
-        int const nStarPerCell,         ///< max no. of stars per cell; <= 0 => infty
-        bool const constantWeight,       ///< should each star have equal weight in the fit?
-        int const border                 ///< Border size for background subtraction
+template<typename MaskedImageT>
+int analyzePsfCandidates(
+    PsfImagePca<MaskedImageT> & imagePca,                  ///< the candidates' images
+    int const nEigenComponents,                            ///< number of components to keep; <= 0 => infty
+    int const bkgBorder,                                   ///< width of border used to estimate background
+    std::vector<typename MaskedImageT::Ptr> & eigenImages, ///< output: the eigen images
+    std::vector<double> & eigenValues                      ///< output: the eigen values
     )
 {
-    typedef typename afwImage::Image<PixelT> ImageT;
-    typedef typename afwImage::MaskedImage<PixelT> MaskedImageT;
-    typedef typename afwImage::Exposure<PixelT> ExposureT;
-    
-    //
-    // Set the sizes for PsfCandidates made from either Images or MaskedImages
-    //
-    //lsst::meas::algorithms::PsfCandidate<ImageT>::setWidth(ksize);
-    //lsst::meas::algorithms::PsfCandidate<ImageT>::setHeight(ksize);
-    //lsst::meas::algorithms::PsfCandidate<MaskedImageT>::setWidth(ksize);
-    //lsst::meas::algorithms::PsfCandidate<MaskedImageT>::setHeight(ksize);
-    lsst::meas::algorithms::PsfCandidate<PixelT>::setWidth(ksize);
-    lsst::meas::algorithms::PsfCandidate<PixelT>::setHeight(ksize);
-
-    
-    PsfImagePca<MaskedImageT> imagePca(constantWeight, border); // Here's the set of images we'll analyze
+    typedef typename MaskedImageT::Image ImageT;
 
-    {
-        SetPcaImageVisitor<PixelT> importStarVisitor(&imagePca);
-        bool const ignoreExceptions = true;
-        psfCells.visitCandidates(&importStarVisitor, nStarPerCell, ignoreExceptions);
-    }
-
-    //
-    // Do a PCA decomposition of those PSF candidates.
-    //
-    // We have "gappy" data;  in other words we don't want to include any pixels with INTRP set
-    //
     int niter = 10;                     // number of iterations of updateBadPixels
     double deltaLim = 10.0;             // acceptable value of delta, the max change due to updateBadPixels
     lsst::afw::image::MaskPixel const BAD = afwImage::Mask<>::getPlaneBitMask("BAD");
@@ -260,8 +245,8 @@ std::pair<afwMath::LinearCombinationKernel::Ptr, std::vector<double> > createKer
         imagePca.analyze();
     }
     
-    std::vector<typename MaskedImageT::Ptr> eigenImages = imagePca.getEigenImages();
-    std::vector<double> eigenValues = imagePca.getEigenValues();
+    eigenImages = imagePca.getEigenImages();
+    eigenValues = imagePca.getEigenValues();
     int const nEigen = static_cast<int>(eigenValues.size());
     
     int const ncomp = (nEigenComponents <= 0 || nEigen < nEigenComponents) ? nEigen : nEigenComponents;
@@ -273,7 +258,7 @@ std::pair<afwMath::LinearCombinationKernel::Ptr, std::vector<double> > createKer
     for (int k = 0; k != ncomp; ++k) {
         ImageT const& im = *eigenImages[k]->getImage();
 
-        int bkg_border = 2;
+        int bkg_border = bkgBorder;
         if (bkg_border > im.getWidth()) {
             bkg_border = im.getWidth() / 2;
         }
@@ -302,6 +287,69 @@ std::pair<afwMath::LinearCombinationKernel::Ptr, std::vector<double> > createKer
 
         *eigenImages[k] -= sum;
     }
+    return ncomp;
+}
+
+/*
+ * Enforce unit sum for kernel by construction
+ * Zeroth component has sum norm
+ * Other components have zero sum by normalising and then subtracting the zeroth component
+ */
+template<typename MaskedImageT>
+void normalizeEigenImages(
+    std::vector<typename MaskedImageT::Ptr> & eigenImages, ///< the eigen images
+    int const ncomp,                                       ///< the number of components to normalise
+    double const norm                                      ///< the desired sum of the zeroth component
+    )
+{
+    typedef typename MaskedImageT::Image ImageT;
+
+    for (int i = 0; i != ncomp; ++i) {
+        ImageT& image = *eigenImages[i]->getImage();
+        double sum = std::accumulate(image.begin(true), image.end(true), 0.0)/norm;
+        if (i == 0) {
+            image /= sum;
+        } else {
+            for (typename ImageT::fast_iterator ptr0 = eigenImages[0]->getImage()->begin(true),
+                     ptr1 = image.begin(true), end = image.end(true); ptr1 != end; ++ptr0, ++ptr1) {
+                *ptr1 = *ptr1 / sum - *ptr0;
+            }
+        }
+    }
+}
+
+/*
+ * The work of createKernelFromPsfCandidates, which PsfCandidate's (static) stamp size must already
+ * have been set for.  Doesn't set it itself, so may be called concurrently (cf. FitPsfsTask)
+ */
+template<typename PixelT>
+std::pair<afwMath::LinearCombinationKernel::Ptr, std::vector<double> > doCreateKernelFromPsfCandidates(
+        afwMath::SpatialCellSet const& psfCells,
+        lsst::afw::geom::Extent2I const& dims,
+        lsst::afw::geom::Point2I const& xy0,
+        int const nEigenComponents,
+        int const spatialOrder,
+        int const nStarPerCell,
+        bool const constantWeight,
+        int const border=3
+    )
+{
+    typedef typename afwImage::MaskedImage<PixelT> MaskedImageT;
+
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "createKernelFromPsfCandidates");
+    
+    PsfImagePca<MaskedImageT> imagePca(constantWeight, border); // Here's the set of images we'll analyze
+
+    {
+        SetPcaImageVisitor<PixelT> importStarVisitor(&imagePca);
+        bool const ignoreExceptions = true;
+        psfCells.visitCandidates(&importStarVisitor, nStarPerCell, ignoreExceptions);
+    }
+
+    std::vector<typename MaskedImageT::Ptr> eigenImages;
+    std::vector<double> eigenValues;
+    int const ncomp = analyzePsfCandidates(imagePca, nEigenComponents, 2, eigenImages, eigenValues);
+    normalizeEigenImages<MaskedImageT>(eigenImages, ncomp, 1.0);
     //
     // Now build our LinearCombinationKernel; build the lists of basis functions
     // and spatial variation, then assemble the Kernel
@@ -311,22 +359,6 @@ std::pair<afwMath::LinearCombinationKernel::Ptr, std::vector<double> > createKer
     afwGeom::Box2D const range = afwGeom::Box2D(afwGeom::Point2D(xy0), afwGeom::Extent2D(dims));
 
     for (int i = 0; i != ncomp; ++i) {
-        {
-            // Enforce unit sum for kernel by construction
-            // Zeroth component has unit sum
-            // Other components have zero sum by normalising and then subtracting the zeroth component
-            ImageT& image = *eigenImages[i]->getImage();
-            double sum = std::accumulate(image.begin(true), image.end(true), 0.0);
-            if (i == 0) {
-                image /= sum;
-            } else {
-                for (typename ImageT::fast_iterator ptr0 = eigenImages[0]->getImage()->begin(true),
-                         ptr1 = image.begin(true), end = image.end(true); ptr1 != end; ++ptr0, ++ptr1) {
-                    *ptr1 = *ptr1 / sum - *ptr0;
-                }
-            }
-        }
-
         kernelList.push_back(afwMath::Kernel::Ptr(new afwMath::FixedKernel(
                                       afwImage::Image<afwMath::Kernel::Pixel>(*eigenImages[i]->getImage(),true)
                                                                           )));
@@ -343,6 +375,185 @@ std::pair<afwMath::LinearCombinationKernel::Ptr, std::vector<double> > createKer
 
     return std::make_pair(psf, eigenValues);
 }
+} // Anonymous namespace
+
+/************************************************************************************************************/
+/**
+ * Return a Kernel::Ptr and a list of eigenvalues resulting from analysing the provided SpatialCellSet
+ *
+ * The Kernel is a LinearCombinationKernel of the first nEigenComponents eigenImages
+ *
+ * N.b. This is templated over the Pixel type of the science image
+ */
+template<typename PixelT>
+std::pair<afwMath::LinearCombinationKernel::Ptr, std::vector<double> > createKernelFromPsfCandidates(
+        afwMath::SpatialCellSet const& psfCells, ///< A SpatialCellSet containing PsfCandidates
+        lsst::afw::geom::Extent2I const& dims, ///< Dimensions of image
+        lsst::afw::geom::Point2I const& xy0,   ///< Origin of image
+        int const nEigenComponents,     ///< number of eigen components to keep; <= 0 => infty
+        int const spatialOrder,         ///< Order of spatial variation (cf. afw::math::PolynomialFunction2)
+        int const ksize,                ///< Size of generated Kernel images
+        int const nStarPerCell,         ///< max no. of stars per cell; <= 0 => infty
+        bool const constantWeight,       ///< should each star have equal weight in the fit?
+        int const border                 ///< Border size for background subtraction
+    )
+{
+    //
+    // Set the sizes for PsfCandidates made from either Images or MaskedImages
+    //
+    //lsst::meas::algorithms::PsfCandidate<ImageT>::setWidth(ksize);
+    //lsst::meas::algorithms::PsfCandidate<ImageT>::setHeight(ksize);
+    //lsst::meas::algorithms::PsfCandidate<MaskedImageT>::setWidth(ksize);
+    //lsst::meas::algorithms::PsfCandidate<MaskedImageT>::setHeight(ksize);
+    lsst::meas::algorithms::PsfCandidate<PixelT>::setWidth(ksize);
+    lsst::meas::algorithms::PsfCandidate<PixelT>::setHeight(ksize);
+
+    return doCreateKernelFromPsfCandidates<PixelT>(psfCells, dims, xy0, nEigenComponents, spatialOrder,
+                                                   nStarPerCell, constantWeight, border);
+}
+
+/************************************************************************************************************/
+/**
+ * Return an OversampledPcaPsf and a list of eigenvalues resulting from analysing the provided SpatialCellSet
+ *
+ * Each candidate is resampled onto a grid oversampled by a factor of oversampling (see
+ * PsfCandidate::getOversampledImage), and the PSF's basis is the first nEigenComponents eigenImages
+ * of those oversampled images.  The zeroth component has unit (pixel-integrated) sum, and a constant
+ * weight of 1; the others have zero sum.  The weights of the other components are found by fitting
+ * each candidate's normalised image with the basis, and then fitting the weights of each component
+ * with a Chebyshev polynomial of order spatialOrder in the candidates' positions.
+ *
+ * N.b. This is templated over the Pixel type of the science image
+ */
+template<typename PixelT>
+std::pair<PTR(OversampledPcaPsf), std::vector<double> > createOversampledPsfFromPsfCandidates(
+        afwMath::SpatialCellSet const& psfCells, ///< A SpatialCellSet containing PsfCandidates
+        lsst::afw::geom::Extent2I const& dims, ///< Dimensions of image
+        lsst::afw::geom::Point2I const& xy0,   ///< Origin of image
+        int const nEigenComponents,     ///< number of eigen components to keep; <= 0 => infty
+        int const spatialOrder,         ///< Order of spatial variation (cf. afw::math::Chebyshev1Function2)
+        int const ksize,                ///< Size of generated PSF images, in pixels
+        int const oversampling,         ///< Number of samples per pixel in each dimension
+        int const nStarPerCell,         ///< max no. of stars per cell; <= 0 => infty
+        bool const constantWeight,       ///< should each star have equal weight in the fit?
+        int const border,                ///< Border size for background subtraction, in pixels
+        afwGeom::Point2D const& averagePosition ///< Average position of the stars used
+    )
+{
+    typedef typename afwImage::Image<PixelT> ImageT;
+    typedef typename afwImage::MaskedImage<PixelT> MaskedImageT;
+
+    if (oversampling < 1) {
+        throw LSST_EXCEPT(lsst::pex::exceptions::InvalidParameterError,
+                          str(boost::format("Oversampling must be >= 1; saw %d") % oversampling));
+    }
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "createOversampledPsfFromPsfCandidates");
+
+    lsst::meas::algorithms::PsfCandidate<PixelT>::setWidth(ksize);
+    lsst::meas::algorithms::PsfCandidate<PixelT>::setHeight(ksize);
+
+    PsfImagePca<MaskedImageT> imagePca(constantWeight, border*oversampling);
+    std::vector<afwGeom::Point2D> positions; // positions of the images in imagePca
+    {
+        SetPcaImageVisitor<PixelT> importStarVisitor(&imagePca, 0x0, oversampling, &positions);
+        bool const ignoreExceptions = true;
+        psfCells.visitCandidates(&importStarVisitor, nStarPerCell, ignoreExceptions);
+    }
+    if (positions.empty()) {
+        throw LSST_EXCEPT(lsst::pex::exceptions::LengthError, "No usable PSF candidates");
+    }
+
+    std::vector<typename MaskedImageT::Ptr> eigenImages;
+    std::vector<double> eigenValues;
+    int const ncomp = analyzePsfCandidates(imagePca, nEigenComponents, 2*oversampling,
+                                           eigenImages, eigenValues);
+    if (ncomp == 0) {
+        throw LSST_EXCEPT(lsst::pex::exceptions::LengthError, "PCA of PSF candidates found no components");
+    }
+    double const norm = oversampling*oversampling; // sum of samples of an image of unit flux
+    normalizeEigenImages<MaskedImageT>(eigenImages, ncomp, norm);
+    //
+    // Fit each candidate's image, normalised to unit flux, with the zeroth component plus a linear
+    // combination of the others
+    //
+    int const nPix = eigenImages[0]->getWidth()*eigenImages[0]->getHeight();
+    Eigen::MatrixXd basis(nPix, ncomp);
+    for (int k = 0; k != ncomp; ++k) {
+        ImageT const& image = *eigenImages[k]->getImage();
+        int j = 0;
+        for (int y = 0; y != image.getHeight(); ++y) {
+            for (typename ImageT::const_x_iterator ptr = image.row_begin(y), end = image.row_end(y);
+                 ptr != end; ++ptr, ++j) {
+                basis(j, k) = *ptr;
+            }
+        }
+    }
+    int const nCand = positions.size();
+    Eigen::MatrixXd weights(nCand, ncomp); // weight of each component in each candidate
+    weights.col(0).setOnes();
+    if (ncomp > 1) {
+        Eigen::JacobiSVD<Eigen::MatrixXd> svd(basis.rightCols(ncomp - 1),
+                                               Eigen::ComputeThinU | Eigen::ComputeThinV);
+        typename PsfImagePca<MaskedImageT>::ImageList const& images = imagePca.getImageList();
+        Eigen::VectorXd data(nPix);
+        for (int c = 0; c != nCand; ++c) {
+            ImageT const& image = *images[c]->getImage();
+            int j = 0;
+            for (int y = 0; y != image.getHeight(); ++y) {
+                for (typename ImageT::const_x_iterator ptr = image.row_begin(y), end = image.row_end(y);
+                     ptr != end; ++ptr, ++j) {
+                    data(j) = *ptr;
+                }
+            }
+            double const sum = data.sum();
+            if (sum == 0.0) {
+                weights.row(c).tail(ncomp - 1).setZero();
+                continue;
+            }
+            data *= norm/sum;
+            data -= basis.col(0);
+            weights.row(c).tail(ncomp - 1) = svd.solve(data).transpose();
+        }
+    }
+    //
+    // Fit the spatial variation of each component's weight
+    //
+    afwGeom::Box2D const range = afwGeom::Box2D(afwGeom::Point2D(xy0), afwGeom::Extent2D(dims));
+    afwMath::Chebyshev1Function2<double> chebyshev(spatialOrder, range);
+    int const nParams = chebyshev.getNParameters();
+    Eigen::MatrixXd design(nCand, nParams); // value of each Chebyshev term at each candidate
+    for (int p = 0; p != nParams; ++p) {
+        std::vector<double> params(nParams, 0.0);
+        params[p] = 1.0;
+        chebyshev.setParameters(params);
+        for (int c = 0; c != nCand; ++c) {
+            design(c, p) = chebyshev(positions[c].getX(), positions[c].getY());
+        }
+    }
+    Eigen::JacobiSVD<Eigen::MatrixXd> designSvd(design, Eigen::ComputeThinU | Eigen::ComputeThinV);
+
+    std::vector<PTR(OversampledPcaPsf::BasisImage)> basisImages;
+    std::vector<afwMath::Kernel::SpatialFunctionPtr> spatialFunctions;
+    for (int k = 0; k != ncomp; ++k) {
+        basisImages.push_back(boost::make_shared<OversampledPcaPsf::BasisImage>(
+                                  *eigenImages[k]->getImage(), true));
+
+        afwMath::Kernel::SpatialFunctionPtr spatialFunction(
+            new afwMath::Chebyshev1Function2<double>(spatialOrder, range));
+        if (k == 0) {
+            spatialFunction->setParameter(0, 1.0); // the constant term; all others are 0
+        } else {
+            Eigen::VectorXd const coeffs = designSvd.solve(weights.col(k));
+            spatialFunction->setParameters(std::vector<double>(coeffs.data(), coeffs.data() + nParams));
+        }
+        spatialFunctions.push_back(spatialFunction);
+    }
+
+    PTR(OversampledPcaPsf) psf = boost::make_shared<OversampledPcaPsf>(
+        basisImages, spatialFunctions, oversampling, afwGeom::Extent2I(ksize, ksize), averagePosition
+    );
+    return std::make_pair(psf, eigenValues);
+}
 
 /************************************************************************************************************/
 /**
@@ -627,6 +838,8 @@ fitSpatialKernelFromPsfCandidates(
                                  ) {
     typedef typename afwImage::Image<PixelT> Image;
 
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "fitSpatialKernelFromPsfCandidates.nonlinear");
+
     int const nComponents = kernel->getNKernelParameters();
     int const nSpatialParams = kernel->getNSpatialParameters();
     //
@@ -919,6 +1132,8 @@ fitSpatialKernelFromPsfCandidates(
         return fitSpatialKernelFromPsfCandidates<PixelT>(kernel, psfCells, nStarPerCell, tolerance);
     }
 
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "fitSpatialKernelFromPsfCandidates.linear");
+
     double const tau = 0;               // softening for errors
 
     afwMath::LinearCombinationKernel const* lcKernel =
@@ -1001,6 +1216,159 @@ fitSpatialKernelFromPsfCandidates(
     return std::make_pair(true, getChi2.getValue());
 }
 
+/************************************************************************************************************/
+
+namespace {
+/*
+ * Fit a PSF to each of a set of SpatialCellSets, in parallel; all the sets must share a kernel size,
+ * as PsfCandidate's stamp size is static.  The caller sets it before running the task
+ */
+template<typename PixelT>
+class FitPsfsTask : public ParallelTask {
+public:
+    FitPsfsTask(std::vector<PTR(afwMath::SpatialCellSet)> const& psfCellSets,
+                std::vector<afwGeom::Box2I> const& bboxes,
+                std::vector<int> const& nEigenComponents,
+                std::vector<int> const& indices, // indices into the above of the sets to fit
+                int const spatialOrder,
+                int const nStarPerCell,
+                bool const constantWeight,
+                bool const doNonLinearFit,
+                int const nStarPerCellSpatialFit,
+                double const tolerance,
+                double const lambda,
+                std::vector<PsfFitResult> & results
+               ) :
+        ParallelTask(), _psfCellSets(psfCellSets), _bboxes(bboxes), _nEigenComponents(nEigenComponents),
+        _indices(indices), _spatialOrder(spatialOrder), _nStarPerCell(nStarPerCell),
+        _constantWeight(constantWeight), _doNonLinearFit(doNonLinearFit),
+        _nStarPerCellSpatialFit(nStarPerCellSpatialFit), _tolerance(tolerance), _lambda(lambda),
+        _results(results)
+    {}
+
+    virtual void operator()(int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            _fit(_indices[i]);
+        }
+    }
+
+private:
+    // Fit one set of candidates, recording any failure in its result rather than throwing
+    void _fit(int const j) {
+        PsfFitResult & result = _results[j];
+        afwMath::SpatialCellSet const& psfCells = *_psfCellSets[j];
+        try {
+            // Use nEigenComponents if possible, but allow smaller numbers if necessary
+            for (int nEigen = _nEigenComponents[j]; nEigen > 0; --nEigen) {
+                try {
+                    std::pair<afwMath::LinearCombinationKernel::Ptr, std::vector<double> > const kernel =
+                        doCreateKernelFromPsfCandidates<PixelT>(psfCells, _bboxes[j].getDimensions(),
+                                                                _bboxes[j].getMin(), nEigen, _spatialOrder,
+                                                                _nStarPerCell, _constantWeight);
+                    result.kernel = kernel.first;
+                    result.eigenValues = kernel.second;
+                    result.nEigenComponents = nEigen;
+                    // count before the spatial fit, which may mark candidates BAD
+                    result.nCandidates = countPsfCandidates<PixelT>(psfCells, _nStarPerCell);
+                    break;
+                } catch (lsst::pex::exceptions::LengthError & e) {
+                    if (nEigen == 1) {
+                        result.error = "No viable PSF candidates survive";
+                        return;
+                    }
+                    result.warnings.push_back(e.what());
+                }
+            }
+            if (!result.kernel) {
+                result.error = "No viable PSF candidates survive";
+                return;
+            }
+            std::pair<bool, double> const fit =
+                fitSpatialKernelFromPsfCandidates<PixelT>(result.kernel.get(), psfCells, _doNonLinearFit,
+                                                          _nStarPerCellSpatialFit, _tolerance, _lambda);
+            result.spatialFitStatus = fit.first;
+            result.spatialFitChi2 = fit.second;
+        } catch (std::exception & e) {
+            result.kernel.reset();
+            result.error = e.what();
+        }
+    }
+
+    std::vector<PTR(afwMath::SpatialCellSet)> const& _psfCellSets;
+    std::vector<afwGeom::Box2I> const& _bboxes;
+    std::vector<int> const& _nEigenComponents;
+    std::vector<int> const& _indices;
+    int const _spatialOrder;
+    int const _nStarPerCell;
+    bool const _constantWeight;
+    bool const _doNonLinearFit;
+    int const _nStarPerCellSpatialFit;
+    double const _tolerance;
+    double const _lambda;
+    std::vector<PsfFitResult> & _results;
+};
+}
+
+/**
+ * Fit PCA PSF models to the candidates of several exposures (e.g. the CCDs of a visit) at once
+ *
+ * For each exposure this does what PcaPsfDeterminer._fitPsf does, i.e. createKernelFromPsfCandidates
+ * (reducing the number of components if there are too few candidates) followed by
+ * fitSpatialKernelFromPsfCandidates, and gives identical results.  Exposures are fit concurrently
+ * on the shared thread pool (see ThreadPool.h), in groups with the same kernel size.  A failure for
+ * one exposure is reported in its PsfFitResult::error and doesn't affect the others.
+ *
+ * \throw lsst::pex::exceptions::LengthError if the input vectors' lengths differ
+ */
+template<typename PixelT>
+std::vector<PsfFitResult>
+fitPsfsFromPsfCandidates(
+        std::vector<PTR(afwMath::SpatialCellSet)> const& psfCellSets, ///< each exposure's PsfCandidates
+        std::vector<afwGeom::Box2I> const& bboxes,  ///< each exposure's bounding box
+        std::vector<int> const& nEigenComponents,   ///< max number of eigen components for each exposure
+        std::vector<int> const& ksizes,             ///< kernel size for each exposure
+        int const spatialOrder,                     ///< order of spatial variation
+        int const nStarPerCell,                     ///< max no. of stars per cell for the PCA; <= 0 => infty
+        bool const constantWeight,                  ///< should each star have the same weight in the PCA?
+        bool const doNonLinearFit,                  ///< use the nonlinear spatial fitter?
+        int const nStarPerCellSpatialFit,           ///< max no. of stars per cell for the spatial fit
+        double const tolerance,                     ///< tolerance of the nonlinear spatial fit
+        double const lambda                         ///< floor for variance is lambda*data
+                        )
+{
+    std::size_t const nExposure = psfCellSets.size();
+    if (bboxes.size() != nExposure || nEigenComponents.size() != nExposure || ksizes.size() != nExposure) {
+        throw LSST_EXCEPT(lsst::pex::exceptions::LengthError,
+                          (boost::format("Saw %d cell sets but %d bboxes, %d nEigenComponents and %d ksizes")
+                           % nExposure % bboxes.size() % nEigenComponents.size() % ksizes.size()).str());
+    }
+    LSST_MEAS_ALGORITHMS_SCOPED_TIMER(timer, "fitPsfsFromPsfCandidates");
+
+    std::vector<PsfFitResult> results(nExposure);
+    std::vector<bool> done(nExposure, false);
+    for (std::size_t i = 0; i != nExposure; ++i) {
+        if (done[i]) {
+            continue;
+        }
+        std::vector<int> indices;
+        for (std::size_t j = i; j != nExposure; ++j) {
+            if (!done[j] && ksizes[j] == ksizes[i]) {
+                indices.push_back(j);
+                done[j] = true;
+            }
+        }
+        // the threads only read the stamp size, so set it now
+        lsst::meas::algorithms::PsfCandidate<PixelT>::setWidth(ksizes[i]);
+        lsst::meas::algorithms::PsfCandidate<PixelT>::setHeight(ksizes[i]);
+        FitPsfsTask<PixelT> task(psfCellSets, bboxes, nEigenComponents, indices, spatialOrder,
+                                 nStarPerCell, constantWeight, doNonLinearFit, nStarPerCellSpatialFit,
+                                 tolerance, lambda, results);
+        parallelFor(indices.size(), task, 1);
+    }
+
+    return results;
+}
+
 /************************************************************************************************************/
 /**
  * Subtract a PSF from an image at a given position
@@ -1182,6 +1550,12 @@ fitKernelToImage(
                                          afwGeom::Point2I const&, int const, int const, int const,
                                          int const, bool const, int const);
     template
+    std::pair<PTR(OversampledPcaPsf), std::vector<double> >
+    createOversampledPsfFromPsfCandidates<Pixel>(afwMath::SpatialCellSet const&, afwGeom::Extent2I const&,
+                                                 afwGeom::Point2I const&, int const, int const, int const,
+                                                 int const, int const, bool const, int const,
+                                                 afwGeom::Point2D const&);
+    template
     int countPsfCandidates<Pixel>(afwMath::SpatialCellSet const&, int const);
 
     template
@@ -1193,6 +1567,13 @@ fitKernelToImage(
     fitSpatialKernelFromPsfCandidates<Pixel>(afwMath::Kernel *, afwMath::SpatialCellSet const&, bool const,
                                              int const, double const, double const);
 
+    template
+    std::vector<PsfFitResult>
+    fitPsfsFromPsfCandidates<Pixel>(std::vector<PTR(afwMath::SpatialCellSet)> const&,
+                                    std::vector<afwGeom::Box2I> const&, std::vector<int> const&,
+                                    std::vector<int> const&, int const, int const, bool const, bool const,
+                                    int const, double const, double const);
+
     template
     double subtractPsf(afwDetection::Psf const&, afwImage::MaskedImage<float> *, double, double, double);
 
@@ -0,0 +1,300 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+
+#include <algorithm>
+#include <cmath>
+
+#include "boost/format.hpp"
+#include "boost/make_shared.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/afw/table/io/InputArchive.h"
+#include "lsst/afw/table/io/OutputArchive.h"
+#include "lsst/afw/table/io/CatalogVector.h"
+#include "lsst/afw/table/aggregates.h"
+#include "lsst/meas/algorithms/TabulatedPsf.h"
+
+namespace lsst { namespace meas { namespace algorithms {
+
+namespace {
+
+void checkGrid(afw::geom::Box2I const & bbox, afw::geom::Extent2I const & gridDimensions) {
+    if (bbox.isEmpty()) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError, "TabulatedPsf bbox must not be empty");
+    }
+    if (gridDimensions.getX() < 1 || gridDimensions.getY() < 1) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          (boost::format("Invalid TabulatedPsf grid dimensions %dx%d")
+                           % gridDimensions.getX() % gridDimensions.getY()).str());
+    }
+}
+
+/*
+ * Return the nodes between which to interpolate in one dimension, and the weight of the second.
+ *
+ * Node i of n is at the centre of the i'th of n equal cells spanning [min, min + length).
+ */
+void findNodes(double position, double min, double length, int n, int & i0, int & i1, double & t) {
+    double const u = (position - min)*n/length - 0.5;
+    i0 = std::max(0, std::min(n - 1, static_cast<int>(std::floor(u))));
+    i1 = std::min(n - 1, i0 + 1);
+    t = (i1 == i0) ? 0.0 : std::max(0.0, std::min(1.0, u - i0));
+}
+
+} // anonymous
+
+TabulatedPsf::TabulatedPsf(
+    afw::detection::Psf const & psf,
+    afw::geom::Box2I const & bbox,
+    afw::geom::Extent2I const & gridDimensions,
+    afw::image::Color const & color
+) : ImagePsf(gridDimensions.getX()*gridDimensions.getY() == 1),
+    _images(),
+    _bbox(bbox),
+    _gridDimensions(gridDimensions),
+    _averagePosition(psf.getAveragePosition())
+{
+    checkGrid(bbox, gridDimensions);
+    int const nNode = gridDimensions.getX()*gridDimensions.getY();
+    std::vector<PTR(Image)> images;
+    images.reserve(nNode);
+    afw::geom::Box2I imageBBox;
+    for (int iy = 0; iy != gridDimensions.getY(); ++iy) {
+        for (int ix = 0; ix != gridDimensions.getX(); ++ix) {
+            images.push_back(psf.computeKernelImage(getNodePosition(ix, iy), color));
+            imageBBox.include(images.back()->getBBox());
+        }
+    }
+    // The kernel images of some Psfs (e.g. WarpedPsf) change size; put them all in the same box
+    _images.reserve(nNode);
+    for (int i = 0; i != nNode; ++i) {
+        if (images[i]->getBBox() == imageBBox) {
+            _images.push_back(images[i]);
+        } else {
+            PTR(Image) image = boost::make_shared<Image>(imageBBox);
+            *image = 0.0;
+            Image subImage(*image, images[i]->getBBox());
+            subImage <<= *images[i];
+            _images.push_back(image);
+        }
+    }
+}
+
+TabulatedPsf::TabulatedPsf(
+    std::vector<PTR(Image)> const & images,
+    afw::geom::Box2I const & bbox,
+    afw::geom::Extent2I const & gridDimensions,
+    afw::geom::Point2D const & averagePosition
+) : ImagePsf(gridDimensions.getX()*gridDimensions.getY() == 1),
+    _images(images),
+    _bbox(bbox),
+    _gridDimensions(gridDimensions),
+    _averagePosition(averagePosition)
+{
+    checkGrid(bbox, gridDimensions);
+    if (static_cast<int>(images.size()) != gridDimensions.getX()*gridDimensions.getY()) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          (boost::format("Need one image per node of a %dx%d grid; saw %d")
+                           % gridDimensions.getX() % gridDimensions.getY() % images.size()).str());
+    }
+    for (std::size_t i = 0; i != images.size(); ++i) {
+        if (!images[i]) {
+            throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                              "TabulatedPsf images must not be null");
+        }
+        if (images[i]->getBBox() != images.front()->getBBox()) {
+            throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                              (boost::format("Image %d has bounding box %s, not %s")
+                               % i % images[i]->getBBox() % images.front()->getBBox()).str());
+        }
+    }
+}
+
+PTR(afw::detection::Psf) TabulatedPsf::clone() const {
+    return boost::make_shared<TabulatedPsf>(*this);
+}
+
+afw::geom::Point2D TabulatedPsf::getNodePosition(int ix, int iy) const {
+    afw::geom::Box2D const bbox(_bbox);
+    return afw::geom::Point2D(bbox.getMinX() + (ix + 0.5)*bbox.getWidth()/_gridDimensions.getX(),
+                              bbox.getMinY() + (iy + 0.5)*bbox.getHeight()/_gridDimensions.getY());
+}
+
+PTR(afw::detection::Psf::Image const) TabulatedPsf::getNodeImage(int ix, int iy) const {
+    return _images[_index(ix, iy)];
+}
+
+int TabulatedPsf::_index(int ix, int iy) const {
+    if (ix < 0 || ix >= _gridDimensions.getX() || iy < 0 || iy >= _gridDimensions.getY()) {
+        throw LSST_EXCEPT(pex::exceptions::OutOfRangeError,
+                          (boost::format("Node (%d, %d) is not in a %dx%d grid")
+                           % ix % iy % _gridDimensions.getX() % _gridDimensions.getY()).str());
+    }
+    return iy*_gridDimensions.getX() + ix;
+}
+
+PTR(afw::detection::Psf::Image) TabulatedPsf::doComputeKernelImage(
+    afw::geom::Point2D const & position,
+    afw::image::Color const &
+) const {
+    afw::geom::Box2D const bbox(_bbox);
+    int ix0, ix1, iy0, iy1;
+    double tx, ty;
+    findNodes(position.getX(), bbox.getMinX(), bbox.getWidth(), _gridDimensions.getX(), ix0, ix1, tx);
+    findNodes(position.getY(), bbox.getMinY(), bbox.getHeight(), _gridDimensions.getY(), iy0, iy1, ty);
+
+    int const index[4] = {_index(ix0, iy0), _index(ix1, iy0), _index(ix0, iy1), _index(ix1, iy1)};
+    double const weight[4] = {(1.0 - tx)*(1.0 - ty), tx*(1.0 - ty), (1.0 - tx)*ty, tx*ty};
+
+    PTR(Image) image = boost::make_shared<Image>(_images.front()->getBBox());
+    *image = 0.0;
+    for (int i = 0; i != 4; ++i) {
+        if (weight[i] != 0.0) {
+            image->scaledPlus(weight[i], *_images[index[i]]);
+        }
+    }
+    return image;
+}
+
+// ---------------------------------------------------------------------------------------------------------
+// Persistence
+// ---------------------------------------------------------------------------------------------------------
+
+namespace {
+
+namespace tbl = afw::table;
+
+/*
+ * Persisted as a single record; the schema depends on the size and number of the images,
+ * so the keys are looked up by name when reading.
+ */
+class TabulatedPsfFactory : public tbl::io::PersistableFactory {
+public:
+
+    virtual PTR(tbl::io::Persistable)
+    read(tbl::io::InputArchive const & archive, tbl::io::CatalogVector const & catalogs) const {
+        LSST_ARCHIVE_ASSERT(catalogs.size() == 1u);
+        LSST_ARCHIVE_ASSERT(catalogs.front().size() == 1u);
+        tbl::BaseRecord const & record = catalogs.front().front();
+        tbl::Schema const schema = record.getSchema();
+        tbl::PointKey<double> const averagePositionKey(schema["averagePosition"]);
+        tbl::PointKey<int> const bboxMinKey(schema["bboxMin"]);
+        tbl::PointKey<int> const bboxMaxKey(schema["bboxMax"]);
+        tbl::PointKey<int> const gridDimensionsKey(schema["gridDimensions"]);
+        tbl::PointKey<int> const imageMinKey(schema["imageMin"]);
+        tbl::PointKey<int> const imageMaxKey(schema["imageMax"]);
+        tbl::Key< tbl::Array<float> > const imagesKey = schema["images"];
+
+        afw::geom::Point2I const gridDimensions = record.get(gridDimensionsKey);
+        afw::geom::Box2I const imageBBox(record.get(imageMinKey), record.get(imageMaxKey));
+        int const nNode = gridDimensions.getX()*gridDimensions.getY();
+        LSST_ARCHIVE_ASSERT(nNode > 0);
+        LSST_ARCHIVE_ASSERT(imagesKey.getSize() == nNode*imageBBox.getArea());
+
+        ndarray::Array<float const,1,1> const imagesArray = record.get(imagesKey);
+        ndarray::Array<float const,1,1>::Iterator pixel = imagesArray.begin();
+        std::vector<PTR(TabulatedPsf::Image)> images;
+        images.reserve(nNode);
+        for (int i = 0; i != nNode; ++i) {
+            PTR(TabulatedPsf::Image) image = boost::make_shared<TabulatedPsf::Image>(imageBBox);
+            for (int y = 0; y != image->getHeight(); ++y) {
+                for (TabulatedPsf::Image::x_iterator ptr = image->row_begin(y), end = image->row_end(y);
+                     ptr != end; ++ptr, ++pixel) {
+                    *ptr = *pixel;
+                }
+            }
+            images.push_back(image);
+        }
+        return boost::make_shared<TabulatedPsf>(
+            images,
+            afw::geom::Box2I(record.get(bboxMinKey), record.get(bboxMaxKey)),
+            afw::geom::Extent2I(gridDimensions),
+            record.get(averagePositionKey)
+        );
+    }
+
+    TabulatedPsfFactory(std::string const & name) : tbl::io::PersistableFactory(name) {}
+
+};
+
+std::string getTabulatedPsfPersistenceName() { return "TabulatedPsf"; }
+
+TabulatedPsfFactory registration(getTabulatedPsfPersistenceName());
+
+} // anonymous
+
+std::string TabulatedPsf::getPersistenceName() const { return getTabulatedPsfPersistenceName(); }
+
+std::string TabulatedPsf::getPythonModule() const { return "lsst.meas.algorithms"; }
+
+void TabulatedPsf::write(OutputArchiveHandle & handle) const {
+    afw::geom::Box2I const imageBBox = _images.front()->getBBox();
+
+    tbl::Schema schema;
+    tbl::PointKey<double> const averagePositionKey = tbl::PointKey<double>::addFields(
+        schema, "averagePosition", "average position of stars used to make the PSF", "pixels"
+    );
+    tbl::PointKey<int> const bboxMinKey = tbl::PointKey<int>::addFields(
+        schema, "bboxMin", "minimum corner of the region over which the PSF was tabulated", "pixels"
+    );
+    tbl::PointKey<int> const bboxMaxKey = tbl::PointKey<int>::addFields(
+        schema, "bboxMax", "maximum corner of the region over which the PSF was tabulated", "pixels"
+    );
+    tbl::PointKey<int> const gridDimensionsKey = tbl::PointKey<int>::addFields(
+        schema, "gridDimensions", "number of nodes in each dimension", ""
+    );
+    tbl::PointKey<int> const imageMinKey = tbl::PointKey<int>::addFields(
+        schema, "imageMin", "minimum corner of the kernel images", "pixels"
+    );
+    tbl::PointKey<int> const imageMaxKey = tbl::PointKey<int>::addFields(
+        schema, "imageMax", "maximum corner of the kernel images", "pixels"
+    );
+    tbl::Key< tbl::Array<float> > const imagesKey = schema.addField< tbl::Array<float> >(
+        "images", "kernel images at the nodes, each in row-major order", _images.size()*imageBBox.getArea()
+    );
+
+    tbl::BaseCatalog catalog = handle.makeCatalog(schema);
+    PTR(tbl::BaseRecord) record = catalog.addNew();
+    record->set(averagePositionKey, _averagePosition);
+    record->set(bboxMinKey, _bbox.getMin());
+    record->set(bboxMaxKey, _bbox.getMax());
+    record->set(gridDimensionsKey, afw::geom::Point2I(_gridDimensions));
+    record->set(imageMinKey, imageBBox.getMin());
+    record->set(imageMaxKey, imageBBox.getMax());
+    ndarray::ArrayRef<float,1,1> const images = (*record)[imagesKey];
+    ndarray::ArrayRef<float,1,1>::Iterator pixel = images.begin();
+    for (std::size_t i = 0; i != _images.size(); ++i) {
+        Image const & image = *_images[i];
+        for (int y = 0; y != image.getHeight(); ++y) {
+            for (Image::const_x_iterator ptr = image.row_begin(y), end = image.row_end(y);
+                 ptr != end; ++ptr, ++pixel) {
+                *pixel = *ptr;
+            }
+        }
+    }
+    handle.saveCatalog(catalog);
+}
+
+}}} // namespace lsst::meas::algorithms
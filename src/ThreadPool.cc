@@ -0,0 +1,317 @@
+// -*- LSST-C++ -*-
+
+/*
+ * LSST Data Management System
+ * Copyright 2008-2016 AURA/LSST.
+ *
+ * This product includes software developed by the
+ * LSST Project (http://www.lsst.org/).
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the LSST License Statement and
+ * the GNU General Public License along with this program.  If not,
+ * see <https://www.lsstcorp.org/LegalNotices/>.
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <exception>
+#include <string>
+#include <vector>
+
+#include "boost/format.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/meas/algorithms/ThreadPool.h"
+
+namespace lsst {
+namespace meas {
+namespace algorithms {
+
+namespace {
+
+/// True while this thread is running a chunk of a parallelFor
+__thread bool inParallelRegion = false;
+
+int getNumProcessors() {
+    long const n = sysconf(_SC_NPROCESSORS_ONLN);
+    return (n > 0) ? static_cast<int>(n) : 1;
+}
+
+int initialNumThreads() {
+    char const * env = std::getenv("MEAS_ALGORITHMS_NUM_THREADS");
+    if (!env || !*env) {
+        return 1;
+    }
+    int const n = std::atoi(env);
+    if (n < 0) {
+        return 1;
+    }
+    return (n == 0) ? getNumProcessors() : n;
+}
+
+/// One call of parallelFor; lives on the stack of the calling thread
+struct Job {
+    Job(ParallelTask & task_, int n_, int grainSize_) :
+        task(task_), n(n_), grainSize(grainSize_), numChunks((n_ + grainSize_ - 1)/grainSize_),
+        nextChunk(0), participants(0), failed(false), error()
+    {}
+
+    ParallelTask & task;
+    int const n;
+    int const grainSize;
+    int const numChunks;
+    int volatile nextChunk;             // next chunk to claim; updated atomically
+    int participants;                   // worker threads working on this job; guarded by the pool mutex
+    bool volatile failed;               // set once a chunk has thrown
+    std::string error;                  // message of the first exception; guarded by the pool mutex
+};
+
+/*
+ * Idle workers wait on a condition variable for a job to be posted.  The threads working on a job
+ * (the caller and any workers that wake in time) claim chunks from a shared atomic counter until
+ * none remain, so faster threads simply take more chunks.  Only one job runs on the pool at a time;
+ * a parallelFor called while the pool is busy runs serially in its own thread rather than waiting.
+ */
+class Pool {
+public:
+    static Pool & getInstance() {
+        static Pool * instance = new Pool(); // never deleted: workers may outlive static destruction
+        return *instance;
+    }
+
+    int getNumThreads() {
+        pthread_mutex_lock(&_mutex);
+        int const n = _numThreads;
+        pthread_mutex_unlock(&_mutex);
+        return n;
+    }
+
+    void setNumThreads(int numThreads) {
+        pthread_mutex_lock(&_mutex);
+        while (_busy) {
+            pthread_cond_wait(&_done, &_mutex);
+        }
+        _numThreads = numThreads;
+        _busy = true;                   // keep jobs off the pool while its workers exit
+        _stopWorkers();                 // restarted with the new size by the next job
+        _busy = false;
+        pthread_cond_broadcast(&_done);
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    /// Run the job on the pool; return false (without running it) if the pool is in use or serial
+    bool run(Job & job) {
+        pthread_mutex_lock(&_mutex);
+        if (_busy || _numThreads <= 1) {
+            pthread_mutex_unlock(&_mutex);
+            return false;
+        }
+        _busy = true;
+        if (_workers.empty()) {
+            _startWorkers(_numThreads - 1);
+        }
+        _job = &job;
+        ++_generation;
+        pthread_cond_broadcast(&_wake);
+        pthread_mutex_unlock(&_mutex);
+
+        work(job);
+
+        pthread_mutex_lock(&_mutex);
+        _job = 0;                       // no more workers may join
+        while (job.participants > 0) {
+            pthread_cond_wait(&_done, &_mutex);
+        }
+        _busy = false;
+        pthread_cond_broadcast(&_done);
+        pthread_mutex_unlock(&_mutex);
+        return true;
+    }
+
+private:
+    Pool() :
+        _numThreads(initialNumThreads()), _job(0), _generation(0), _startGeneration(0),
+        _busy(false), _stop(false)
+    {
+        pthread_mutex_init(&_mutex, 0);
+        pthread_cond_init(&_wake, 0);
+        pthread_cond_init(&_done, 0);
+    }
+
+    /// Claim and run chunks of the job until none remain
+    void work(Job & job) {
+        bool const wasInParallelRegion = inParallelRegion;
+        inParallelRegion = true;
+        for (;;) {
+            int const chunk = __sync_fetch_and_add(&job.nextChunk, 1);
+            if (chunk >= job.numChunks) {
+                break;
+            }
+            if (job.failed) {
+                continue;
+            }
+            int const begin = chunk*job.grainSize;
+            int const end = std::min(begin + job.grainSize, job.n);
+            try {
+                job.task(begin, end);
+            } catch (std::exception & err) {
+                _fail(job, err.what());
+            } catch (...) {
+                _fail(job, "unknown exception");
+            }
+        }
+        inParallelRegion = wasInParallelRegion;
+    }
+
+    void _fail(Job & job, std::string const & what) {
+        pthread_mutex_lock(&_mutex);
+        if (!job.failed) {
+            job.error = what;
+            job.failed = true;
+        }
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    static void * _workerMain(void * arg) {
+        static_cast<Pool *>(arg)->_workerLoop();
+        return 0;
+    }
+
+    void _workerLoop() {
+        pthread_mutex_lock(&_mutex);
+        unsigned long seen = _startGeneration;    // so a new worker joins the job that started it
+        for (;;) {
+            while (!_stop && (_job == 0 || _generation == seen)) {
+                pthread_cond_wait(&_wake, &_mutex);
+            }
+            if (_stop) {
+                break;
+            }
+            seen = _generation;
+            Job & job = *_job;
+            ++job.participants;
+            pthread_mutex_unlock(&_mutex);
+
+            work(job);
+
+            pthread_mutex_lock(&_mutex);
+            if (--job.participants == 0) {
+                pthread_cond_broadcast(&_done);
+            }
+        }
+        pthread_mutex_unlock(&_mutex);
+    }
+
+    // Must be called with the mutex held
+    void _startWorkers(int numWorkers) {
+        _stop = false;
+        _startGeneration = _generation;
+        for (int i = 0; i < numWorkers; ++i) {
+            pthread_t thread;
+            if (pthread_create(&thread, 0, &Pool::_workerMain, this) != 0) {
+                break;                  // run with the workers we have; the caller always participates
+            }
+            _workers.push_back(thread);
+        }
+    }
+
+    // Must be called with the mutex held and _busy set; releases the mutex while joining the workers
+    void _stopWorkers() {
+        if (_workers.empty()) {
+            return;
+        }
+        _stop = true;
+        pthread_cond_broadcast(&_wake);
+        std::vector<pthread_t> workers;
+        workers.swap(_workers);
+        pthread_mutex_unlock(&_mutex);
+        for (std::vector<pthread_t>::iterator iter = workers.begin(); iter != workers.end(); ++iter) {
+            pthread_join(*iter, 0);
+        }
+        pthread_mutex_lock(&_mutex);
+        _stop = false;
+    }
+
+    pthread_mutex_t _mutex;
+    pthread_cond_t _wake;               // a job was posted, or workers are to stop
+    pthread_cond_t _done;               // a job's workers have finished, or the pool became idle
+    std::vector<pthread_t> _workers;
+    int _numThreads;
+    Job * _job;                         // job that idle workers may join, if any
+    unsigned long _generation;          // incremented for each job, so a worker joins each job at most once
+    unsigned long _startGeneration;     // value of _generation when the workers were started
+    bool _busy;
+    bool _stop;
+};
+
+void runSerially(int n, ParallelTask & task, int grainSize) {
+    bool const wasInParallelRegion = inParallelRegion;
+    inParallelRegion = true;
+    try {
+        for (int begin = 0; begin < n; begin += grainSize) {
+            task(begin, std::min(begin + grainSize, n));
+        }
+    } catch (...) {
+        inParallelRegion = wasInParallelRegion;
+        throw;
+    }
+    inParallelRegion = wasInParallelRegion;
+}
+
+} // anonymous namespace
+
+int getNumThreads() {
+    return Pool::getInstance().getNumThreads();
+}
+
+void setNumThreads(int numThreads) {
+    if (numThreads < 0) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          (boost::format("Number of threads must be >= 0; saw %d") % numThreads).str());
+    }
+    if (inParallelRegion) {
+        throw LSST_EXCEPT(pex::exceptions::LogicError, "Cannot resize the thread pool from a parallel task");
+    }
+    Pool::getInstance().setNumThreads(numThreads == 0 ? getNumProcessors() : numThreads);
+}
+
+bool isInParallelRegion() {
+    return inParallelRegion;
+}
+
+void parallelFor(int n, ParallelTask & task, int grainSize) {
+    if (grainSize < 1) {
+        throw LSST_EXCEPT(pex::exceptions::InvalidParameterError,
+                          (boost::format("Grain size must be >= 1; saw %d") % grainSize).str());
+    }
+    if (n <= 0) {
+        return;
+    }
+    if (n <= grainSize || inParallelRegion) {
+        runSerially(n, task, grainSize);
+        return;
+    }
+    Job job(task, n, grainSize);
+    if (!Pool::getInstance().run(job)) {
+        runSerially(n, task, grainSize);
+        return;
+    }
+    if (job.failed) {
+        throw LSST_EXCEPT(pex::exceptions::RuntimeError, "Exception in parallel task: " + job.error);
+    }
+}
+
+}}} // namespace lsst::meas::algorithms
@@ -23,7 +23,9 @@
  */
 
 #include "lsst/pex/exceptions.h"
+#include "lsst/meas/algorithms/KernelPsf.h"
 #include "lsst/meas/algorithms/WarpedPsf.h"
+#include "lsst/afw/math/FunctionLibrary.h"
 #include "lsst/afw/math/warpExposure.h"
 #include "lsst/afw/image/Image.h"
 
@@ -124,6 +126,39 @@ PTR(afw::detection::Psf::Image) warpAffine(
     return ret;
 }
 
+/*
+ * Is a Psf the same everywhere?  We only recognize KernelPsfs (which ignore the color) whose Kernel
+ * isn't spatially varying, or whose spatial functions are all constant polynomials, as PcaPsfs
+ * fit with spatialOrder=0 are.
+ */
+bool isSpatiallyConstant(afw::detection::Psf const & psf) {
+    KernelPsf const * kernelPsf = dynamic_cast<KernelPsf const *>(&psf);
+    if (!kernelPsf) {
+        return false;
+    }
+    afw::math::Kernel const & kernel = *kernelPsf->getKernel();
+    if (!kernel.isSpatiallyVarying()) {
+        return true;
+    }
+    std::vector<afw::math::Kernel::SpatialFunctionPtr> const functions = kernel.getSpatialFunctionList();
+    for (std::size_t i = 0; i < functions.size(); ++i) {
+        int order;
+        if (PTR(afw::math::PolynomialFunction2<double> const) poly =
+                boost::dynamic_pointer_cast<afw::math::PolynomialFunction2<double> const>(functions[i])) {
+            order = poly->getOrder();
+        } else if (PTR(afw::math::Chebyshev1Function2<double> const) cheby =
+                boost::dynamic_pointer_cast<afw::math::Chebyshev1Function2<double> const>(functions[i])) {
+            order = cheby->getOrder();
+        } else {
+            return false;
+        }
+        if (order != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
 } // anonymous
 
 WarpedPsf::WarpedPsf(
@@ -173,6 +208,9 @@ void WarpedPsf::_init()
             "WarpingControl passed to WarpedPsf must not be None/NULL"
         );
     }
+    if (isSpatiallyConstant(*_undistortedPsf)) {
+        _undistortedImage = _undistortedPsf->computeKernelImage(_undistortedPsf->getAveragePosition());
+    }
 }
 
 afw::geom::Point2D WarpedPsf::getAveragePosition() const {
@@ -189,7 +227,7 @@ PTR(afw::detection::Psf::Image) WarpedPsf::doComputeKernelImage(
     afw::geom::AffineTransform t = _distortion->linearizeReverseTransform(position);
     afw::geom::Point2D tp = t(position);
 
-    PTR(Image) im = _undistortedPsf->computeKernelImage(tp, color);
+    PTR(Image) im = _undistortedImage ? _undistortedImage : _undistortedPsf->computeKernelImage(tp, color);
 
     // Go to the warped coordinate system with 'p' at the origin
     PTR(afw::detection::Psf::Psf::Image) ret
@@ -546,6 +546,57 @@ class CoaddPsfTest(utilsTests.TestCase):
         predPos = afwGeom.Point2D(xwsum/wsum, ywsum/wsum)
         self.assertPairsNearlyEqual(predPos, mypsf.getAveragePosition())
 
+    def testTruncate(self):
+        """Test that a truncated CoaddPsf omits, and reports, its lightest components"""
+        cd11, cd12, cd21, cd22  = 5.55555555e-05, 0.0, 0.0, 5.55555555e-05
+        crpix = afwGeom.PointD(1000, 1000)
+        crval = afwCoord.Coord(afwGeom.Point2D(0.0, 0.0))
+        wcsref = afwImage.makeWcs(crval, crpix, cd11, cd12, cd21, cd22)
+
+        schema = afwTable.ExposureTable.makeMinimalSchema()
+        schema.addField("weight", type="D", doc="Coadd weight")
+        mycatalog = afwTable.ExposureCatalog(schema)
+        heaviest = afwTable.ExposureCatalog(schema)
+        weights = [1.0, 100.0, 3.0, 2.0]
+        for i, weight in enumerate(weights):
+            record = mycatalog.getTable().makeRecord()
+            record.setPsf(measAlg.DoubleGaussianPsf(25, 25, 2.0 + i, 1.00, 0.0))
+            record.setWcs(wcsref)
+            record['weight'] = weight
+            record['id'] = i
+            record.setBBox(afwGeom.Box2I(afwGeom.Point2I(0, 0), afwGeom.Extent2I(2000, 2000)))
+            mycatalog.append(record)
+            if weight == max(weights):
+                heaviest.append(record)
+
+        point = afwGeom.Point2D(1000, 1000)
+        mypsf = measAlg.CoaddPsf(mycatalog, wcsref, 'weight')
+        self.assertEqual(mypsf.getMaxTruncatedWeightFraction(), 0.0)
+        self.assertEqual(mypsf.computeTruncatedWeightFraction(point), 0.0)
+        self.assertEqual(mypsf.truncate(0.0).computeKernelImage(point).getArray().tolist(),
+                         mypsf.computeKernelImage(point).getArray().tolist())
+        # a clone, which makes its own warped Psfs, agrees with the original
+        self.assertEqual(mypsf.clone().computeKernelImage(point).getArray().tolist(),
+                         mypsf.computeKernelImage(point).getArray().tolist())
+
+        truncated = mypsf.truncate(0.05)
+        self.assertAlmostEqual(truncated.computeTruncatedWeightFraction(point), 3.0/106.0, places=12)
+
+        truncated = mypsf.truncate(0.1)
+        self.assertEqual(truncated.getMaxTruncatedWeightFraction(), 0.1)
+        self.assertAlmostEqual(truncated.computeTruncatedWeightFraction(point), 6.0/106.0, places=12)
+        image = truncated.computeKernelImage(point)
+        expected = measAlg.CoaddPsf(heaviest, wcsref, 'weight').computeKernelImage(point)
+        self.assertEqual(image.getBBox(), expected.getBBox())
+        self.assertLess(abs(image.getArray() - expected.getArray()).max(), 1e-14)
+        self.assertAlmostEqual(image.getArray().sum(), 1.0, places=12)
+        # the original is untouched
+        self.assertGreater(abs(mypsf.computeKernelImage(point).getArray() - image.getArray()).max(), 1e-5)
+        self.assertEqual(mypsf.getMaxTruncatedWeightFraction(), 0.0)
+
+        self.assertRaises(pexExceptions.InvalidParameterError, mypsf.truncate, 1.0)
+        self.assertRaises(pexExceptions.InvalidParameterError, mypsf.truncate, -0.1)
+
 
 
 #-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
@@ -192,6 +192,149 @@ class CosmicRayNullTestCase(unittest.TestCase):
         self.assertEqual(len(crs), 0, "Found %d CRs in empty image" % len(crs))
         
 
+class CosmicRayIntegerTestCase(unittest.TestCase):
+    """A test case for Cosmic Ray detection in integer images"""
+    def setUp(self):
+        self.FWHM = 5                   # pixels
+        self.bkgd = 1000
+        self.psf = algorithms.DoubleGaussianPsf(29, 29, self.FWHM/(2*sqrt(2*log(2))))
+        self.crPixels = [(20, 30), (64, 64), (66, 90), (100, 40)]
+
+    def tearDown(self):
+        del self.psf
+
+    def makeMaskedImage(self, MaskedImage):
+        mi = MaskedImage(128, 128)
+        mi.set((self.bkgd, 0, self.bkgd))
+        for x, y in self.crPixels:
+            mi.getImage().set(x, y, 5*self.bkgd)
+        return mi
+
+    def testDetection(self):
+        """Test that CRs in uint16 and int images are found, and removed, as in float images"""
+        crConfig = algorithms.FindCosmicRaysConfig()
+        miF = self.makeMaskedImage(afwImage.MaskedImageF)
+        crsF = algorithms.findCosmicRays(miF, self.psf, self.bkgd, pexConfig.makePolicy(crConfig))
+        self.assertEqual(len(crsF), len(self.crPixels))
+
+        for MaskedImage in (afwImage.MaskedImageU, afwImage.MaskedImageI):
+            mi = self.makeMaskedImage(MaskedImage)
+            crs = algorithms.findCosmicRays(mi, self.psf, self.bkgd, pexConfig.makePolicy(crConfig))
+            self.assertEqual([cr.getBBox() for cr in crs], [cr.getBBox() for cr in crsF])
+            for x, y in self.crPixels:
+                self.assertLessEqual(abs(mi.getImage().get(x, y) - miF.getImage().get(x, y)), 0.5)
+                self.assertEqual(mi.getMask().get(x, y), miF.getMask().get(x, y))
+
+    def testInterpolateOverDefects(self):
+        """Test that interpolated values in uint16 images are rounded and clamped"""
+        mi = afwImage.MaskedImageU(80, 30)
+        mi.set((10, 0, 10))
+        for x in range(80):
+            mi.getImage().set(x, 15, 65535 if x%2 else 0)   # makes the interpolant overshoot
+        badPixels = [algorithms.Defect(afwGeom.BoxI(afwGeom.PointI(40, 10), afwGeom.ExtentI(2, 10)))]
+        algorithms.interpolateOverDefects(mi, self.psf, badPixels)
+        for y in range(10, 20):
+            for x in (40, 41):
+                self.assertGreaterEqual(mi.getImage().get(x, y), 0)
+                self.assertLessEqual(mi.getImage().get(x, y), 65535)
+        self.assertEqual(mi.getImage().get(40, 12), 10)
+
+class CosmicRayMaskOnlyTestCase(unittest.TestCase):
+    """A test case for Cosmic Ray detection without Footprints"""
+    def setUp(self):
+        self.FWHM = 5                   # pixels
+        self.bkgd = 1000
+        self.psf = algorithms.DoubleGaussianPsf(29, 29, self.FWHM/(2*sqrt(2*log(2))))
+        self.crPixels = [(20, 30), (21, 30), (21, 31), (64, 64), (66, 90), (100, 40)]
+
+    def tearDown(self):
+        del self.psf
+
+    def makeMaskedImage(self):
+        mi = afwImage.MaskedImageF(afwGeom.BoxI(afwGeom.PointI(10, 20), afwGeom.ExtentI(128, 128)))
+        mi.set((self.bkgd, 0, self.bkgd))
+        for x, y in self.crPixels:
+            mi.getImage().set(x, y, 5*self.bkgd)
+        return mi
+
+    def testDetection(self):
+        """Test that findCosmicRaysMaskOnly sets the same pixels and mask bits as findCosmicRays"""
+        crConfig = algorithms.FindCosmicRaysConfig()
+        for keep in (False, True):
+            mi = self.makeMaskedImage()
+            crs = algorithms.findCosmicRays(mi, self.psf, self.bkgd, pexConfig.makePolicy(crConfig), keep)
+
+            miMaskOnly = self.makeMaskedImage()
+            stats = algorithms.findCosmicRaysMaskOnly(miMaskOnly, self.psf, self.bkgd,
+                                                      pexConfig.makePolicy(crConfig), keep)
+            self.assertEqual(stats.nCr, len(crs))
+            self.assertEqual(stats.nPixel, sum(cr.getNpix() for cr in crs))
+
+            for y in range(mi.getHeight()):
+                for x in range(mi.getWidth()):
+                    self.assertEqual(miMaskOnly.getImage().get(x, y), mi.getImage().get(x, y))
+                    self.assertEqual(miMaskOnly.getMask().get(x, y), mi.getMask().get(x, y))
+
+class CosmicRaySnapsTestCase(unittest.TestCase):
+    """A test case for Cosmic Ray detection in a pair of snaps"""
+    def setUp(self):
+        self.FWHM = 5                   # pixels
+        self.bkgd = 100.0
+        self.psf = algorithms.DoubleGaussianPsf(29, 29, self.FWHM/(2*sqrt(2*log(2))))
+        self.snaps = []
+        for i in range(2):
+            mi = afwImage.MaskedImageF(128, 128)
+            mi.set((self.bkgd, 0, self.bkgd))
+            # a star, which is the same in both snaps
+            sigma = self.FWHM/(2*sqrt(2*log(2)))
+            for y in range(50, 79):
+                for x in range(50, 79):
+                    r2 = (x - 64)**2 + (y - 64)**2
+                    mi.getImage().set(x, y, self.bkgd + 1e4*exp(-0.5*r2/sigma**2))
+            self.snaps.append(mi)
+        # CRs in each snap, one of them on the star
+        self.crs = [[(20, 30), (64, 66)], [(100, 40), (101, 40), (100, 41)]]
+        for mi, crs in zip(self.snaps, self.crs):
+            for x, y in crs:
+                mi.getImage().set(x, y, mi.getImage().get(x, y) + 2000)
+
+    def tearDown(self):
+        del self.psf
+        del self.snaps
+
+    def testDetection(self):
+        """Test that CRs are found in the right snap, and removed"""
+        crConfig = algorithms.FindCosmicRaysConfig()
+        crs0, crs1 = algorithms.findCosmicRaysInSnaps(self.snaps[0], self.snaps[1], self.psf, self.bkgd,
+                                                      pexConfig.makePolicy(crConfig))
+        self.assertEqual(len(crs0), 2)
+        self.assertEqual(len(crs1), 1)
+        self.assertEqual(crs1[0].getNpix(), 3)
+
+        crBit = afwImage.MaskU.getPlaneBitMask("CR")
+        for mi, crs in zip(self.snaps, self.crs):
+            for x, y in crs:
+                self.assertTrue(mi.getMask().get(x, y) & crBit)
+        # the star is untouched, and the CR next to it has been removed
+        self.assertEqual(self.snaps[1].getMask().get(64, 66), 0)
+        self.assertLess(self.snaps[0].getImage().get(20, 30), self.bkgd + 1000)
+
+    def testKeep(self):
+        """Test that keep=True masks CRs without changing the pixels"""
+        crConfig = algorithms.FindCosmicRaysConfig()
+        value = self.snaps[0].getImage().get(20, 30)
+        crs0, crs1 = algorithms.findCosmicRaysInSnaps(self.snaps[0], self.snaps[1], self.psf, self.bkgd,
+                                                      pexConfig.makePolicy(crConfig), True)
+        self.assertEqual(self.snaps[0].getImage().get(20, 30), value)
+        self.assertTrue(self.snaps[0].getMask().get(20, 30) & afwImage.MaskU.getPlaneBitMask("CR"))
+
+    def testDimensions(self):
+        """Test that snaps must have the same dimensions"""
+        crConfig = algorithms.FindCosmicRaysConfig()
+        other = afwImage.MaskedImageF(100, 128)
+        self.assertRaises(Exception, algorithms.findCosmicRaysInSnaps, self.snaps[0], other, self.psf,
+                          self.bkgd, pexConfig.makePolicy(crConfig))
+
 #-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
 def suite():
@@ -201,6 +344,9 @@ def suite():
     suites = []
     suites += unittest.makeSuite(CosmicRayTestCase)
     suites += unittest.makeSuite(CosmicRayNullTestCase)
+    suites += unittest.makeSuite(CosmicRayIntegerTestCase)
+    suites += unittest.makeSuite(CosmicRayMaskOnlyTestCase)
+    suites += unittest.makeSuite(CosmicRaySnapsTestCase)
     suites += unittest.makeSuite(tests.MemoryTestCase)
     return unittest.TestSuite(suites)
 
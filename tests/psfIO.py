@@ -369,6 +369,27 @@ class SpatialModelPsfTestCase(unittest.TestCase):
         self.assert_(afwMath.LinearCombinationKernel.swigConvert(psf2.getKernel()) is not None)
         os.remove(filename)
 
+        # The compact format stores the basis in single precision in one record
+        self.assertFalse(algorithms.PcaPsf.getCompactPersistence())
+        algorithms.PcaPsf.setCompactPersistence(True)
+        try:
+            psf1.writeFits(filename)
+        finally:
+            algorithms.PcaPsf.setCompactPersistence(False)
+        psf3 = algorithms.PcaPsf.readFits(filename)
+        os.remove(filename)
+        kernel1 = afwMath.LinearCombinationKernel.swigConvert(psf1.getKernel())
+        kernel3 = afwMath.LinearCombinationKernel.swigConvert(psf3.getKernel())
+        self.assertEqual(kernel3.getNKernelParameters(), kernel1.getNKernelParameters())
+        self.assertEqual(kernel3.getDimensions(), kernel1.getDimensions())
+        self.assertEqual(kernel3.getCtr(), kernel1.getCtr())
+        self.assertEqual(psf3.getAveragePosition(), psf1.getAveragePosition())
+        for x, y in ((0.0, 0.0), (20.5, 100.0), (300.0, 250.25)):
+            point = afwGeom.Point2D(x, y)
+            im1 = psf1.computeImage(point).getArray()
+            im3 = psf3.computeImage(point).getArray()
+            self.assertTrue(numpy.allclose(im1, im3, rtol=0, atol=1e-6*numpy.abs(im1).max()))
+
 #-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 
 class SingleGaussianPsfTestCase(unittest.TestCase):
@@ -0,0 +1,137 @@
+#!/usr/bin/env python
+#
+# LSST Data Management System
+# Copyright 2008-2016 AURA/LSST.
+#
+# This product includes software developed by the
+# LSST Project (http://www.lsst.org/).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the LSST License Statement and
+# the GNU General Public License along with this program.  If not,
+# see <https://www.lsstcorp.org/LegalNotices/>.
+#
+"""
+Tests for addPsfImages
+
+Run with:
+   python testAddPsfImages.py
+or
+   python
+   >>> import testAddPsfImages; testAddPsfImages.run()
+"""
+import unittest
+
+import numpy
+
+import lsst.utils.tests as utilsTests
+import lsst.pex.exceptions as pexExceptions
+import lsst.afw.geom as afwGeom
+import lsst.afw.image as afwImage
+import lsst.meas.algorithms as measAlg
+
+class AddPsfImagesTestCase(unittest.TestCase):
+
+    def setUp(self):
+        self.psf = measAlg.SingleGaussianPsf(21, 21, 2.0)
+        self.bbox = afwGeom.Box2I(afwGeom.Point2I(-10, 20), afwGeom.Extent2I(150, 120))
+        numpy.random.seed(1)
+        n = 200
+        # some sources lie partly, or wholly, off the image
+        self.x = list(numpy.random.uniform(-25, 150, n))
+        self.y = list(numpy.random.uniform(5, 150, n))
+        self.flux = list(numpy.random.uniform(100, 1000, n))
+
+    def tearDown(self):
+        del self.psf
+
+    def makeExpected(self, gain=0.0):
+        expected = afwImage.MaskedImageF(self.bbox)
+        expected.set(0.0)
+        for x, y, flux in zip(self.x, self.y, self.flux):
+            stamp = self.psf.computeImage(afwGeom.Point2D(x, y))
+            bbox = stamp.getBBox(afwImage.PARENT)
+            bbox.clip(self.bbox)
+            if bbox.isEmpty():
+                continue
+            sub = afwImage.MaskedImageF(expected, bbox, afwImage.PARENT)
+            values = flux*afwImage.ImageD(stamp, bbox, afwImage.PARENT).getArray()
+            sub.getImage().getArray()[:] += values
+            if gain > 0:
+                sub.getVariance().getArray()[:] += values/gain
+        return expected
+
+    def testExact(self):
+        """Test that every source is added at its exact position when no tolerance is given"""
+        gain = 2.0
+        expected = self.makeExpected(gain)
+        image = afwImage.MaskedImageF(self.bbox)
+        image.set(0.0)
+        nRealization = measAlg.addPsfImages(image, self.psf, self.x, self.y, self.flux, 0.0, 32, gain)
+        self.assertEqual(nRealization, len(self.x))
+        self.assertLess(numpy.abs(image.getImage().getArray() - expected.getImage().getArray()).max(), 1e-3)
+        self.assertLess(numpy.abs(image.getVariance().getArray() -
+                                  expected.getVariance().getArray()).max(), 1e-3)
+
+    def testReuse(self):
+        """Test that realizations are shared within cells and sub-pixel phases"""
+        expected = self.makeExpected()
+        image = afwImage.MaskedImageF(self.bbox)
+        image.set(0.0)
+        nRealization = measAlg.addPsfImages(image, self.psf, self.x, self.y, self.flux, 0.1, 64)
+        self.assertLess(nRealization, len(self.x))
+        self.assertEqual(numpy.abs(image.getVariance().getArray()).max(), 0.0)
+        # A spatially-invariant PSF is only displaced by the rounding of the positions
+        diff = numpy.abs(image.getImage().getArray() - expected.getImage().getArray()).max()
+        self.assertLess(diff, 0.05*max(self.flux)*self.psf.computePeak(afwGeom.Point2D(0, 0)))
+        self.assertAlmostEqual(image.getImage().getArray().sum()/expected.getImage().getArray().sum(),
+                               1.0, places=2)
+
+    def testThreads(self):
+        """Test that the result doesn't depend on the number of threads"""
+        nThreads = measAlg.getNumThreads()
+        try:
+            images = []
+            for n in (1, 4):
+                measAlg.setNumThreads(n)
+                image = afwImage.MaskedImageF(self.bbox)
+                image.set(0.0)
+                measAlg.addPsfImages(image, self.psf, self.x, self.y, self.flux, 0.05, 16)
+                images.append(image)
+            self.assertTrue(numpy.all(images[0].getImage().getArray() == images[1].getImage().getArray()))
+        finally:
+            measAlg.setNumThreads(nThreads)
+
+    def testErrors(self):
+        image = afwImage.MaskedImageF(self.bbox)
+        self.assertRaises(pexExceptions.LengthError, measAlg.addPsfImages,
+                          image, self.psf, self.x, self.y[:-1], self.flux)
+        self.assertRaises(pexExceptions.InvalidParameterError, measAlg.addPsfImages,
+                          image, self.psf, self.x, self.y, self.flux, 0.1, 0)
+
+#-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+def suite():
+    """Returns a suite containing all the test cases in this module."""
+    utilsTests.init()
+
+    suites = []
+    suites += unittest.makeSuite(AddPsfImagesTestCase)
+    suites += unittest.makeSuite(utilsTests.MemoryTestCase)
+    return unittest.TestSuite(suites)
+
+def run(exit = False):
+    """Run the utilsTests"""
+    utilsTests.run(suite(), exit)
+
+if __name__ == "__main__":
+    run(True)
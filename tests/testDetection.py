@@ -37,7 +37,8 @@ import lsst.afw.image           as afwImage
 import lsst.afw.detection       as afwDet
 import lsst.afw.geom            as afwGeom
 import lsst.afw.table           as afwTable
-from lsst.meas.algorithms import SourceDetectionTask
+from lsst.meas.algorithms import (SourceDetectionTask, addExposures, MaskedImageAccumulatorF,
+                                  setMaskFromGrownFootprints)
 from lsst.meas.algorithms.testUtils import plantSources
 
 import lsst.utils.tests         as utilsTests
@@ -85,6 +86,76 @@ class DetectionTestCase(unittest.TestCase):
             self.assertEqual(res.numPos, numX * numY)
             self.assertEqual(res.numNeg, 0)
     
+    def testAddExposures(self):
+        """Test that addExposures sums images and variances and ORs masks"""
+        bbox = afwGeom.Box2I(afwGeom.Point2I(10, 20), afwGeom.Extent2I(31, 17))
+        exposureList = []
+        for i in range(3):
+            exposure = afwImage.ExposureF(bbox)
+            mi = exposure.getMaskedImage()
+            mi.getImage().getArray()[:] = numpy.random.normal(size=(17, 31))
+            mi.getVariance().getArray()[:] = numpy.random.uniform(1.0, 2.0, size=(17, 31))
+            mi.getMask().getArray()[:] = 1 << i
+            exposureList.append(exposure)
+
+        added = addExposures(exposureList).getMaskedImage()
+        self.assertEqual(added.getXY0(), bbox.getMin())
+        arrays = [exp.getMaskedImage().getArrays() for exp in exposureList]
+        imArr, maskArr, varArr = added.getArrays()
+        self.assertTrue(numpy.allclose(imArr, sum(a[0] for a in arrays), atol=1e-6))
+        self.assertTrue(numpy.allclose(varArr, sum(a[2] for a in arrays), atol=1e-6))
+        self.assertTrue(numpy.all(maskArr == 7))
+        # the inputs are not modified
+        self.assertTrue(numpy.all(arrays[0][1] == 1))
+
+        # partial sums over row bands, merged, give the same result
+        acc1 = MaskedImageAccumulatorF(bbox.getDimensions(), bbox.getMin())
+        acc2 = MaskedImageAccumulatorF(bbox.getDimensions(), bbox.getMin())
+        for i, exposure in enumerate(exposureList):
+            mi = exposure.getMaskedImage()
+            for y0, y1 in ((0, 5), (5, 17)):
+                band = mi.Factory(mi, afwGeom.Box2I(afwGeom.Point2I(0, y0), afwGeom.Extent2I(31, y1 - y0)),
+                                  afwImage.LOCAL)
+                (acc1 if i == 0 else acc2).addRows(band, y0)
+        acc1.merge(acc2)
+        mergedArr = acc1.getResult().getArrays()
+        for merged, expected in zip(mergedArr, (imArr, maskArr, varArr)):
+            self.assertTrue(numpy.allclose(merged, expected, atol=1e-6))
+
+        self.assertRaises(pexEx.LengthError, acc1.add, afwImage.MaskedImageF(afwGeom.Extent2I(30, 17)))
+        self.assertRaises(pexEx.LengthError, acc1.addRows, afwImage.MaskedImageF(afwGeom.Extent2I(31, 5)), 13)
+
+    def testGrownFootprintMask(self):
+        """Test that mask bits set from grown footprints match those of a grown FootprintSet"""
+        bbox = afwGeom.Box2I(afwGeom.Point2I(5, 7), afwGeom.Extent2I(60, 50))
+        image = afwImage.ImageF(bbox)
+        image.set(0)
+        for x, y in ((6, 8), (30, 30), (33, 31), (63, 55), (45, 12)):
+            image.set(x - 5, y - 7, 100)
+        fpSet = afwDet.FootprintSet(image, afwDet.Threshold(10))
+        fpSet.setRegion(bbox)
+        for isotropic in (False, True):
+            for nGrow in (0, 1, 4):
+                expected = afwImage.MaskU(bbox)
+                expected.set(0)
+                grown = afwDet.FootprintSet(fpSet, nGrow, isotropic) if nGrow > 0 else fpSet
+                grown.setMask(expected, "DETECTED")
+                mask = afwImage.MaskU(bbox)
+                mask.set(0)
+                setMaskFromGrownFootprints(mask, fpSet, nGrow, isotropic, mask.getPlaneBitMask("DETECTED"))
+                self.assertTrue(numpy.all(mask.getArray() == expected.getArray()))
+
+    def testSetEdgeBits(self):
+        """Test that setEdgeBits sets bits outside a box given in PARENT coordinates"""
+        bbox = afwGeom.Box2I(afwGeom.Point2I(10, 20), afwGeom.Extent2I(30, 25))
+        mi = afwImage.MaskedImageF(bbox)
+        mi.getMask().set(1)
+        goodBBox = afwGeom.Box2I(afwGeom.Point2I(13, 22), afwGeom.Extent2I(20, 15))
+        SourceDetectionTask.setEdgeBits(mi, goodBBox, 4)
+        expected = numpy.zeros((25, 30), dtype=numpy.uint16) + 5
+        expected[2:17, 3:23] = 1
+        self.assertTrue(numpy.all(mi.getMask().getArray() == expected))
+
     def makeCoordList(self, bbox, numX, numY, minCounts, maxCounts, sigma):
         """Make a coordList for plantSources
 
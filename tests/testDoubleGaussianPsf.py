@@ -151,18 +151,68 @@ class DoubleGaussianPsfTestCase(unittest.TestCase):
         dgPsf = measAlg.DoubleGaussianPsf(ksize, ksize, sigma1)
         dgIm = dgPsf.computeImage(afwGeom.Point2D(x, y))
         #
-        # Check that they're the same
+        # Check that they're the same; the kernel images are identical, but the dgPsf shifts its
+        # image analytically while the KernelPsf resamples it
         #
-        diff = type(kIm)(kIm, True); diff -= dgIm
+        diff = kPsf.computeKernelImage(afwGeom.Point2D(x, y))
+        diff -= dgPsf.computeKernelImage(afwGeom.Point2D(x, y))
         stats = afwMath.makeStatistics(diff, afwMath.MAX | afwMath.MIN)
         self.assertAlmostEqual(stats.getValue(afwMath.MAX), 0.0, places=16)
         self.assertAlmostEqual(stats.getValue(afwMath.MIN), 0.0, places=16)
 
+        diff = type(kIm)(kIm, True); diff -= dgIm
+        stats = afwMath.makeStatistics(diff, afwMath.MAX | afwMath.MIN)
+        self.assertAlmostEqual(stats.getValue(afwMath.MAX), 0.0, places=3)
+        self.assertAlmostEqual(stats.getValue(afwMath.MIN), 0.0, places=3)
+
         if display:
             mos = displayUtils.Mosaic()
             mos.setBackground(-0.1)
             ds9.mtv(mos.makeMosaic([kIm, dgIm, diff], mode="x"), frame=1)
 
+    def testSeparableKernelPsf(self):
+        """Test a Psf made from a separable Kernel"""
+        ksize = 19
+        sigma = 1.7
+        gaussFunc = afwMath.GaussianFunction1D(sigma)
+        kPsf = measAlg.KernelPsf(afwMath.SeparableKernel(ksize, ksize, gaussFunc, gaussFunc))
+        self.assertTrue(kPsf.isSeparable())
+        self.assertFalse(self.psf.isSeparable())
+        self.assertRaises(pexExceptions.LogicError, self.psf.computeKernelVectors)
+
+        cols, rows = kPsf.computeKernelVectors(afwGeom.Point2D(10, 20))
+        self.assertAlmostEqual(sum(cols), 1.0, places=12)
+        self.assertAlmostEqual(sum(rows), 1.0, places=12)
+        kIm = kPsf.computeKernelImage(afwGeom.Point2D(10, 20))
+        self.assertLess(numpy.abs(kIm.getArray() - numpy.outer(rows, cols)).max(), 1e-14)
+        #
+        # Shifted images are evaluated, not interpolated, so agree with the SingleGaussianPsf
+        #
+        sgPsf = measAlg.SingleGaussianPsf(ksize, ksize, sigma)
+        for x, y in ([10, 10], [9.4999, 10.4999], [-3.3, 7.8]):
+            im = kPsf.computeImage(afwGeom.Point2D(x, y))
+            sgIm = sgPsf.computeImage(afwGeom.Point2D(x, y))
+            self.assertEqual(im.getXY0(), sgIm.getXY0())
+            self.assertLess(numpy.abs(im.getArray() - sgIm.getArray()).max(), 1e-14)
+
+    def testShiftedImage(self):
+        """Test that images at sub-pixel positions are the analytic, shifted, Gaussians"""
+        sigma1, sigma2, b = 1.5, 4.0, 0.1
+        ksize = 21
+        psfs = [(measAlg.DoubleGaussianPsf(ksize, ksize, sigma1, sigma2, b), b),
+                (measAlg.DoubleGaussianPsf(ksize, ksize, sigma1), 0.0),
+                (measAlg.SingleGaussianPsf(ksize, ksize, sigma1), 0.0)]
+        for psf, b in psfs:
+            for x, y in ([10, 10], [9.4999, 10.4999], [10.5001, 10.2], [-3.3, 7.8]):
+                im = psf.computeImage(afwGeom.Point2D(x, y))
+                self.assertEqual(im.getDimensions(), afwGeom.Extent2I(ksize, ksize))
+                xx, yy = numpy.meshgrid(numpy.arange(im.getX0(), im.getX0() + ksize) - x,
+                                        numpy.arange(im.getY0(), im.getY0() + ksize) - y)
+                rSq = xx**2 + yy**2
+                expected = numpy.exp(-0.5*rSq/sigma1**2) + b*numpy.exp(-0.5*rSq/sigma2**2)
+                expected /= expected.sum()
+                self.assertLess(numpy.abs(im.getArray() - expected).max(), 1e-12)
+
     def testCast(self):
         base1 = self.psf.clone()
         self.assertEqual(type(base1), afwDetect.Psf)
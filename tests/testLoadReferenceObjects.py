@@ -25,9 +25,11 @@ from __future__ import absolute_import, division, print_function
 import itertools
 import unittest
 
+import numpy
+
 import lsst.afw.table as afwTable
 import lsst.utils.tests as utilsTests
-from lsst.meas.algorithms import LoadReferenceObjectsTask, getRefFluxField, getRefFluxKeys
+from lsst.meas.algorithms import LoadReferenceObjectsTask, ReferenceObjectCache, getRefFluxField, getRefFluxKeys
 
 class TrivialLoader(LoadReferenceObjectsTask):
     """Minimal subclass of LoadReferenceObjectsTask to allow instantiation
@@ -126,8 +128,65 @@ class TestLoadReferenceObjects(unittest.TestCase):
                     else:
                         self.assertRaises(RuntimeError, getRefFluxKeys, refSchema, "camr")
 
-
-
+class ReferenceObjectCacheTestCase(unittest.TestCase):
+    """Test case for the LRU tile cache used by LoadReferenceObjectsTask"""
+
+    def testEviction(self):
+        cache = ReferenceObjectCache(maxBytes=100)
+        cache.put("a", "tileA", 40)
+        cache.put("b", "tileB", 40)
+        self.assertEqual(cache.get("a"), "tileA") # "b" is now least recently used
+        cache.put("c", "tileC", 40)
+        self.assertIsNone(cache.get("b"))
+        self.assertEqual(cache.get("a"), "tileA")
+        self.assertEqual(cache.get("c"), "tileC")
+        self.assertEqual(cache.getNBytes(), 80)
+
+        cache.put("huge", "tileHuge", 1000)   # larger than the budget; not cached
+        self.assertIsNone(cache.get("huge"))
+        self.assertEqual(len(cache), 2)
+
+        cache.setMaxBytes(50)
+        self.assertEqual(len(cache), 1)
+        self.assertEqual(cache.get("c"), "tileC")
+
+        cache.setMaxBytes(0)
+        self.assertEqual(len(cache), 0)
+        self.assertEqual(cache.getNBytes(), 0)
+
+    def testGetCachedTile(self):
+        cache = ReferenceObjectCache.getInstance()
+        maxBytes = cache.getMaxBytes()
+        try:
+            cache.setMaxBytes(0)
+            config = TrivialLoader.ConfigClass()
+            config.tileCacheMB = 1.0
+            loader = TrivialLoader(config=config)
+            self.assertIs(loader.tileCache, cache)
+            self.assertTrue(loader.isTileCacheEnabled())
+            self.assertEqual(cache.getMaxBytes(), 1024**2)
+            loader.tileCache.clear()
+            nLoad = [0]
+            def loadTile():
+                nLoad[0] += 1
+                return {"x": numpy.arange(10)}
+            for i in range(3):
+                tile = loader._getCachedTile(("test", 1), loadTile)
+                self.assertEqual(list(tile["x"]), range(10))
+            self.assertEqual(nLoad[0], 1)
+            self.assertEqual(loader.metadata.get("tileCacheHits"), 2)
+            self.assertEqual(loader.metadata.get("tileCacheMisses"), 1)
+            # a loader asking for less (or nothing) doesn't shrink the budget; one asking for more grows it
+            config.tileCacheMB = 0.0
+            self.assertFalse(TrivialLoader(config=config).isTileCacheEnabled())
+            self.assertEqual(cache.getMaxBytes(), 1024**2)
+            self.assertTrue(loader.isTileCacheEnabled())
+            config.tileCacheMB = 2.0
+            TrivialLoader(config=config)
+            self.assertEqual(cache.getMaxBytes(), 2*1024**2)
+        finally:
+            cache.setMaxBytes(maxBytes)
+            cache.clear()
 
 def suite():
     """Returns a suite containing all the test cases in this module."""
@@ -135,6 +194,7 @@ def suite():
 
     suites = []
     suites += unittest.makeSuite(TestLoadReferenceObjects)
+    suites += unittest.makeSuite(ReferenceObjectCacheTestCase)
     suites += unittest.makeSuite(utilsTests.MemoryTestCase)
 
     return unittest.TestSuite(suites)
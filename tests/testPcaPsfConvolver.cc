@@ -0,0 +1,163 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE PcaPsfConvolver
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+#include "boost/test/floating_point_comparison.hpp"
+
+#include <cmath>
+#include <vector>
+
+#include "boost/make_shared.hpp"
+
+#include "lsst/utils/ieee.h"
+#include "lsst/pex/exceptions.h"
+#include "lsst/afw/image/Image.h"
+#include "lsst/afw/math/ConvolveImage.h"
+#include "lsst/afw/math/FunctionLibrary.h"
+#include "lsst/afw/math/Kernel.h"
+#include "lsst/meas/algorithms/PcaPsf.h"
+#include "lsst/meas/algorithms/PcaPsfConvolver.h"
+#include "lsst/meas/algorithms/ThreadPool.h"
+
+namespace {
+
+namespace afwGeom = lsst::afw::geom;
+namespace afwImage = lsst::afw::image;
+namespace afwMath = lsst::afw::math;
+
+typedef afwImage::Image<float> ImageT;
+
+// A PcaPsf with three (not necessarily positive) basis images whose weights vary linearly
+PTR(lsst::meas::algorithms::PcaPsf) makePsf(int width, int height) {
+    afwMath::KernelList basis;
+    std::vector<afwMath::Kernel::SpatialFunctionPtr> functions;
+    for (int k = 0; k != 3; ++k) {
+        afwImage::Image<double> image(width, height);
+        for (int y = 0; y != height; ++y) {
+            for (int x = 0; x != width; ++x) {
+                double const dx = x - width/2, dy = y - height/2;
+                image(x, y) = std::exp(-0.5*(dx*dx + dy*dy)/(1.0 + k)) + 0.1*k*dx;
+            }
+        }
+        basis.push_back(boost::make_shared<afwMath::FixedKernel>(image));
+
+        PTR(afwMath::PolynomialFunction2<double>) function =
+            boost::make_shared<afwMath::PolynomialFunction2<double> >(1);
+        std::vector<double> parameters(3);
+        parameters[0] = (k == 0) ? 1.0 : 0.1;
+        parameters[1] = 0.002*k;
+        parameters[2] = -0.001*(k + 1);
+        function->setParameters(parameters);
+        functions.push_back(function);
+    }
+    PTR(afwMath::LinearCombinationKernel) kernel =
+        boost::make_shared<afwMath::LinearCombinationKernel>(basis, functions);
+    return boost::make_shared<lsst::meas::algorithms::PcaPsf>(kernel);
+}
+
+PTR(ImageT) makeImage() {
+    PTR(ImageT) image = boost::make_shared<ImageT>(afwGeom::Box2I(afwGeom::Point2I(30, -20),
+                                                                  afwGeom::Extent2I(97, 75)));
+    for (int y = 0; y != image->getHeight(); ++y) {
+        for (int x = 0; x != image->getWidth(); ++x) {
+            (*image)(x, y) = 100.0*std::sin(0.37*x)*std::cos(0.23*y) + ((x*7 + y*13)%17);
+        }
+    }
+    return image;
+}
+
+class NumThreadsGuard {
+public:
+    NumThreadsGuard() : _numThreads(lsst::meas::algorithms::getNumThreads()) {}
+    ~NumThreadsGuard() { lsst::meas::algorithms::setNumThreads(_numThreads); }
+private:
+    int _numThreads;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(ConvolveMatchesDirect) {
+    PTR(lsst::meas::algorithms::PcaPsf) psf = makePsf(11, 9);
+    PTR(ImageT) image = makeImage();
+    afwMath::LinearCombinationKernel const & kernel = *psf->getKernel();
+
+    for (int normalize = 0; normalize != 2; ++normalize) {
+        for (int copyEdge = 0; copyEdge != 2; ++copyEdge) {
+            afwMath::ConvolutionControl const control(normalize, copyEdge, 0); // no kernel interpolation
+            ImageT direct(image->getBBox());
+            afwMath::convolve(direct, *image, kernel, control);
+
+            lsst::meas::algorithms::PcaPsfConvolver const convolver(*psf, 32); // several tiles each way
+            ImageT convolved(image->getBBox());
+            convolved = -1.0;
+            convolver.convolve(convolved, *image, control);
+
+            // the whole image, including the edge pixels, matches
+            for (int y = 0; y != image->getHeight(); ++y) {
+                for (int x = 0; x != image->getWidth(); ++x) {
+                    if (lsst::utils::isnan(direct(x, y))) {
+                        BOOST_CHECK(lsst::utils::isnan(convolved(x, y)));
+                    } else {
+                        BOOST_CHECK_SMALL(convolved(x, y) - direct(x, y), 1e-3f);
+                    }
+                }
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvolveEdge) {
+    PTR(lsst::meas::algorithms::PcaPsf) psf = makePsf(11, 9);
+    PTR(ImageT) image = makeImage();
+    afwGeom::Box2I const goodBBox = psf->getKernel()->shrinkBBox(image->getBBox(afwImage::LOCAL));
+
+    lsst::meas::algorithms::PcaPsfConvolver const convolver(*psf, 64);
+    ImageT convolved(image->getBBox()), copied(image->getBBox());
+    convolver.convolve(convolved, *image, afwMath::ConvolutionControl(true, false));
+    convolver.convolve(copied, *image, afwMath::ConvolutionControl(true, true));
+    for (int y = 0; y != image->getHeight(); ++y) {
+        for (int x = 0; x != image->getWidth(); ++x) {
+            if (goodBBox.contains(afwGeom::Point2I(x, y))) {
+                BOOST_CHECK(!lsst::utils::isnan(convolved(x, y)));
+                BOOST_CHECK_EQUAL(copied(x, y), convolved(x, y));
+            } else {
+                BOOST_CHECK(lsst::utils::isnan(convolved(x, y)));
+                BOOST_CHECK_EQUAL(copied(x, y), (*image)(x, y));
+            }
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvolveThreaded) {
+    NumThreadsGuard guard;
+    PTR(lsst::meas::algorithms::PcaPsf) psf = makePsf(11, 9);
+    PTR(ImageT) image = makeImage();
+    lsst::meas::algorithms::PcaPsfConvolver const convolver(*psf, 24);
+
+    lsst::meas::algorithms::setNumThreads(1);
+    ImageT serial(image->getBBox());
+    convolver.convolve(serial, *image);
+
+    lsst::meas::algorithms::setNumThreads(4);
+    ImageT parallel(image->getBBox());
+    convolver.convolve(parallel, *image);
+    for (int y = 0; y != image->getHeight(); ++y) {
+        for (int x = 0; x != image->getWidth(); ++x) {
+            BOOST_CHECK_EQUAL(parallel(x, y), serial(x, y));
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ConvolveErrors) {
+    PTR(lsst::meas::algorithms::PcaPsf) psf = makePsf(11, 9);
+    BOOST_CHECK_THROW(lsst::meas::algorithms::PcaPsfConvolver(*psf, 10),
+                      lsst::pex::exceptions::InvalidParameterError);
+
+    lsst::meas::algorithms::PcaPsfConvolver const convolver(*psf, 32);
+    ImageT small(8, 8), smallOut(8, 8);
+    BOOST_CHECK_THROW(convolver.convolve(smallOut, small), lsst::pex::exceptions::InvalidParameterError);
+    ImageT in(40, 40), out(41, 40);
+    BOOST_CHECK_THROW(convolver.convolve(out, in), lsst::pex::exceptions::InvalidParameterError);
+}
@@ -33,6 +33,7 @@ or
 """
 
 import math
+import os
 import numpy
 import unittest
 import lsst.utils.tests as utilsTests
@@ -315,6 +316,184 @@ class SpatialModelPsfTestCase(unittest.TestCase):
             chi_lim = 5.0
             self.subtractStars(self.exposure, self.catalog, chi_lim)
 
+    def testPsfDeterminerInstrumentation(self):
+        """Test that instrumentation of PSF determination is collected into the metadata"""
+        starSelector, psfDeterminer = \
+            SpatialModelPsfTestCase.setupDeterminer(self.exposure, nEigenComponents=2)
+        psfCandidateList = starSelector.selectStars(self.exposure, self.catalog)
+        wasEnabled = measAlg.isInstrumentationEnabled()
+        try:
+            measAlg.setInstrumentationEnabled(False)
+            metadata = dafBase.PropertyList()
+            psfDeterminer.determinePsf(self.exposure, psfCandidateList, metadata)
+            self.assertFalse([name for name in metadata.names() if name.startswith("instrumentation.")])
+
+            measAlg.setInstrumentationEnabled(True)
+            metadata = dafBase.PropertyList()
+            psfDeterminer.determinePsf(self.exposure, psfCandidateList, metadata)
+            self.assertGreater(metadata.get("instrumentation.createKernelFromPsfCandidates.calls"), 0)
+            self.assertGreaterEqual(metadata.get("instrumentation.createKernelFromPsfCandidates.seconds"), 0.0)
+            self.assertGreater(metadata.get("instrumentation.PsfImagePca.stamps.count"), 0)
+
+            # the process-wide probes are not reset, and each call only records its own work
+            metadata2 = dafBase.PropertyList()
+            psfDeterminer.determinePsf(self.exposure, psfCandidateList, metadata2)
+            name = "createKernelFromPsfCandidates.calls"
+            calls = metadata.get("instrumentation." + name)
+            self.assertEqual(metadata2.get("instrumentation." + name), calls)
+            total = dafBase.PropertySet()
+            measAlg.collectInstrumentation(total)
+            self.assertGreaterEqual(total.get(name), 2*calls)
+        finally:
+            measAlg.setInstrumentationEnabled(wasEnabled)
+            measAlg.resetInstrumentation()
+
+    def testVisitPsfDeterminer(self):
+        """Test that determining several exposures' PSFs at once reproduces determinePsf"""
+        exposures = [self.exposure, self.exposure.Factory(self.exposure, True)]
+        starSelector, psfDeterminer = \
+            SpatialModelPsfTestCase.setupDeterminer(self.exposure, nEigenComponents=2)
+
+        expected = []
+        for exposure in exposures:
+            metadata = dafBase.PropertyList()
+            psf, cellSet = psfDeterminer.determinePsf(exposure, starSelector.selectStars(exposure, self.catalog),
+                                                      metadata)
+            expected.append((psf, metadata))
+
+        numThreads = measAlg.getNumThreads()
+        try:
+            for nThread in (1, 2):
+                measAlg.setNumThreads(nThread)
+                metadataList = [dafBase.PropertyList() for exposure in exposures]
+                results = psfDeterminer.determineVisitPsfs(
+                    exposures, [starSelector.selectStars(exposure, self.catalog) for exposure in exposures],
+                    metadataList)
+                self.assertEqual(len(results), len(exposures))
+                for (psf, metadata), result, visitMetadata in zip(expected, results, metadataList):
+                    self.assertIsNone(result.error)
+                    self.assertIsInstance(result.psf, measAlg.PcaPsf)
+                    for name in ("spatialFitChi2", "numGoodStars", "numAvailStars", "avgX", "avgY"):
+                        self.assertEqual(visitMetadata.get(name), metadata.get(name))
+                    for x, y in [(20, 20), (60, 210)]:
+                        position = afwGeom.Point2D(x, y)
+                        self.assertTrue(numpy.all(result.psf.computeImage(position).getArray() ==
+                                                  psf.computeImage(position).getArray()))
+        finally:
+            measAlg.setNumThreads(numThreads)
+
+        # A failure on one exposure doesn't affect the others
+        results = psfDeterminer.determineVisitPsfs(
+            exposures, [starSelector.selectStars(exposures[0], self.catalog), []])
+        self.assertIsNone(results[0].error)
+        self.assertIsNotNone(results[0].psf)
+        self.assertIsInstance(results[1].error, RuntimeError)
+        self.assertIsNone(results[1].psf)
+
+    def testFitPsfsMixedKernelSizes(self):
+        """Test that fitPsfsFromPsfCandidates fits mixed kernel sizes as if each were fit alone"""
+        starSelector, psfDeterminer = \
+            SpatialModelPsfTestCase.setupDeterminer(self.exposure, nEigenComponents=2)
+        config = psfDeterminer.config
+        bbox = afwGeom.Box2I(self.exposure.getXY0(), self.exposure.getDimensions())
+        ksizes = [31, 25, 31, 21]       # the two 31s are fit together, but aren't adjacent
+
+        def makeCellSet():
+            cellSet = afwMath.SpatialCellSet(bbox, config.sizeCellX, config.sizeCellY)
+            for cand in starSelector.selectStars(self.exposure, self.catalog):
+                cellSet.insertCandidate(cand)
+            return cellSet
+
+        expected = []
+        for ksize in ksizes:
+            cellSet = makeCellSet()
+            kernel, eigenValues = measAlg.createKernelFromPsfCandidates(
+                cellSet, bbox.getDimensions(), bbox.getMin(), 2, config.spatialOrder, ksize,
+                config.nStarPerCell, bool(config.constantWeight))
+            status, chi2 = measAlg.fitSpatialKernelFromPsfCandidates(
+                kernel, cellSet, bool(config.nonLinearSpatialFit), config.nStarPerCellSpatialFit,
+                config.tolerance, config.lam)
+            expected.append((measAlg.PcaPsf(kernel), list(eigenValues), chi2))
+        self.assertEqual(len(set(psf.getKernel().getWidth() for psf, eigenValues, chi2 in expected)), 3)
+
+        numThreads = measAlg.getNumThreads()
+        try:
+            for nThread in (1, 2):
+                measAlg.setNumThreads(nThread)
+                fits = measAlg.fitPsfsFromPsfCandidates(
+                    [makeCellSet() for ksize in ksizes], [bbox]*len(ksizes), [2]*len(ksizes), ksizes,
+                    config.spatialOrder, config.nStarPerCell, bool(config.constantWeight),
+                    bool(config.nonLinearSpatialFit), config.nStarPerCellSpatialFit,
+                    config.tolerance, config.lam)
+                self.assertEqual(len(fits), len(ksizes))
+                for (psf, eigenValues, chi2), fit in zip(expected, fits):
+                    self.assertEqual(fit.error, "")
+                    self.assertEqual(fit.kernel.getWidth(), psf.getKernel().getWidth())
+                    self.assertEqual(list(fit.eigenValues), eigenValues)
+                    self.assertEqual(fit.spatialFitChi2, chi2)
+                    fitPsf = measAlg.PcaPsf(fit.kernel)
+                    for x, y in [(20, 20), (60, 210)]:
+                        position = afwGeom.Point2D(x, y)
+                        self.assertTrue(numpy.all(fitPsf.computeImage(position).getArray() ==
+                                                  psf.computeImage(position).getArray()))
+        finally:
+            measAlg.setNumThreads(numThreads)
+
+    def testOversampledPsfDeterminer(self):
+        """Test the (PCA) psfDeterminer with an oversampled PSF model"""
+        starSelector, psfDeterminer = \
+            SpatialModelPsfTestCase.setupDeterminer(self.exposure, nEigenComponents=2)
+        psfDeterminer.config.oversampling = 3
+        psfCandidateList = starSelector.selectStars(self.exposure, self.catalog)
+        psf, cellSet = psfDeterminer.determinePsf(self.exposure, psfCandidateList)
+        self.assertIsInstance(psf, measAlg.OversampledPcaPsf)
+        self.assertEqual(psf.getOversampling(), 3)
+
+        for x, y in [(20, 20), (50, 120), (60, 210)]:
+            kernelImage = psf.computeKernelImage(afwGeom.Point2D(x, y))
+            self.assertAlmostEqual(numpy.sum(kernelImage.getArray()), 1.0, 12)
+            # images at sub-pixel positions are normalised, and centred on the position
+            for dx, dy in [(0.0, 0.0), (0.3, -0.2), (-0.45, 0.4)]:
+                position = afwGeom.Point2D(x + dx, y + dy)
+                image = psf.computeImage(position)
+                array = image.getArray()
+                self.assertAlmostEqual(numpy.sum(array), 1.0, 12)
+                yy, xx = numpy.mgrid[0:image.getHeight(), 0:image.getWidth()]
+                self.assertAlmostEqual(numpy.sum(array*xx)/numpy.sum(array) + image.getX0(),
+                                       position.getX(), 1)
+                self.assertAlmostEqual(numpy.sum(array*yy)/numpy.sum(array) + image.getY0(),
+                                       position.getY(), 1)
+
+        self.exposure.setPsf(psf)
+        self.subtractStars(self.exposure, self.catalog, chi_lim=5.0)
+
+    def testOversampledPsfPersistence(self):
+        """Test that an OversampledPcaPsf survives a round trip through a table archive"""
+        starSelector, psfDeterminer = \
+            SpatialModelPsfTestCase.setupDeterminer(self.exposure, nEigenComponents=2)
+        psfDeterminer.config.oversampling = 2
+        psfCandidateList = starSelector.selectStars(self.exposure, self.catalog)
+        psf1, cellSet = psfDeterminer.determinePsf(self.exposure, psfCandidateList)
+        self.assertIsInstance(psf1, measAlg.OversampledPcaPsf)
+
+        filename = "OversampledPcaPsf.fits"
+        psf1.writeFits(filename)
+        try:
+            psf2 = measAlg.OversampledPcaPsf.readFits(filename)
+        finally:
+            os.remove(filename)
+        self.assertEqual(psf2.getOversampling(), psf1.getOversampling())
+        self.assertEqual(psf2.getDimensions(), psf1.getDimensions())
+        self.assertEqual(psf2.getAveragePosition(), psf1.getAveragePosition())
+        for x, y in [(20, 20), (50.3, 120.6), (60, 210)]:
+            position = afwGeom.Point2D(x, y)
+            self.assertTrue(numpy.allclose(psf2.getWeights(position), psf1.getWeights(position)))
+            for compute in ("computeKernelImage", "computeImage"):
+                image1 = getattr(psf1, compute)(position)
+                image2 = getattr(psf2, compute)(position)
+                self.assertEqual(image2.getBBox(afwImage.PARENT), image1.getBBox(afwImage.PARENT))
+                self.assertTrue(numpy.allclose(image2.getArray(), image1.getArray(), rtol=0, atol=1e-12))
+
     def testPsfDeterminerSubimage(self):
         """Test the (PCA) psfDeterminer on subImages"""
 
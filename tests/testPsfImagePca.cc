@@ -0,0 +1,166 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE PsfImagePca
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+
+#include <cmath>
+#include <vector>
+
+#include "boost/make_shared.hpp"
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/afw/image/MaskedImage.h"
+#include "lsst/meas/algorithms/ImagePca.h"
+
+namespace {
+
+typedef lsst::afw::image::MaskedImage<float> MaskedImageT;
+
+int const size = 15;
+
+// A Gaussian of the given flux, with a linear gradient of amplitude slope; bad pixels are set to 1000
+PTR(MaskedImageT) makeStamp(double flux, double slope, std::vector<int> const & badPixels) {
+    PTR(MaskedImageT) mi = boost::make_shared<MaskedImageT>(lsst::afw::geom::Extent2I(size, size));
+    *mi->getMask() = 0;
+    *mi->getVariance() = 1.0;
+    for (int y = 0; y != size; ++y) {
+        for (int x = 0; x != size; ++x) {
+            double const dx = x - size/2, dy = y - size/2;
+            (*mi->getImage())(x, y) = flux*(std::exp(-0.5*(dx*dx + dy*dy)/4.0) + slope*dx);
+        }
+    }
+    lsst::afw::image::MaskPixel const bad = MaskedImageT::Mask::getPlaneBitMask("BAD");
+    for (std::vector<int>::const_iterator ptr = badPixels.begin(); ptr != badPixels.end(); ++ptr) {
+        (*mi->getImage())(*ptr%size, *ptr/size) = 1000.0;
+        (*mi->getMask())(*ptr%size, *ptr/size) = bad;
+    }
+    return mi;
+}
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(UpdateBadPixelsMean) {
+    lsst::meas::algorithms::PsfImagePca<MaskedImageT> imagePca(true, 0);
+    std::vector<int> bad;
+    bad.push_back(3 + 4*size);
+    bad.push_back(7 + 7*size);
+    std::vector<PTR(MaskedImageT)> stamps;
+    for (int i = 0; i != 4; ++i) {
+        stamps.push_back(makeStamp(10.0*(i + 1), 0.0, (i == 1) ? bad : std::vector<int>()));
+        imagePca.addImage(stamps.back(), 10.0*(i + 1));
+    }
+    unsigned long const mask = MaskedImageT::Mask::getPlaneBitMask("BAD");
+
+    double const delta = imagePca.updateBadPixels(mask, 0);
+    PTR(MaskedImageT) expected = makeStamp(20.0, 0.0, std::vector<int>());
+    for (std::vector<int>::const_iterator ptr = bad.begin(); ptr != bad.end(); ++ptr) {
+        BOOST_CHECK_CLOSE((*stamps[1]->getImage())(*ptr%size, *ptr/size),
+                          (*expected->getImage())(*ptr%size, *ptr/size), 1e-4);
+    }
+    BOOST_CHECK_GT(delta, 900.0);
+    // the pixels are now good, so a second pass changes nothing
+    BOOST_CHECK_SMALL(imagePca.updateBadPixels(mask, 0), 1e-3);
+}
+
+BOOST_AUTO_TEST_CASE(UpdateBadPixelsEigenImages) {
+    lsst::meas::algorithms::PsfImagePca<MaskedImageT> imagePca(true, 0);
+    std::vector<int> bad;
+    bad.push_back(5 + 6*size);
+    bad.push_back(8 + 9*size);
+    bad.push_back(8 + 10*size);
+    std::vector<PTR(MaskedImageT)> stamps;
+    for (int i = 0; i != 6; ++i) {
+        stamps.push_back(makeStamp(10.0, 0.01*(i - 3), (i == 2) ? bad : std::vector<int>()));
+        imagePca.addImage(stamps.back(), 10.0);
+    }
+    unsigned long const mask = MaskedImageT::Mask::getPlaneBitMask("BAD");
+
+    imagePca.updateBadPixels(mask, 0);
+    imagePca.analyze();
+    imagePca.updateBadPixels(mask, 2);
+    imagePca.analyze();
+    imagePca.updateBadPixels(mask, 2);
+
+    PTR(MaskedImageT) expected = makeStamp(10.0, 0.01*(2 - 3), std::vector<int>());
+    for (std::vector<int>::const_iterator ptr = bad.begin(); ptr != bad.end(); ++ptr) {
+        BOOST_CHECK_CLOSE((*stamps[2]->getImage())(*ptr%size, *ptr/size),
+                          (*expected->getImage())(*ptr%size, *ptr/size), 1.0);
+    }
+}
+
+namespace {
+
+// Two identical sets of stamps with different fluxes, non-uniform variance and shared and distinct bad pixels
+void makeStamps(std::vector<PTR(MaskedImageT)> & stamps, std::vector<PTR(MaskedImageT)> & copies,
+                std::vector<double> & fluxes) {
+    lsst::afw::image::MaskPixel const bad = MaskedImageT::Mask::getPlaneBitMask("BAD");
+    for (int i = 0; i != 5; ++i) {
+        std::vector<int> badPixels;
+        badPixels.push_back(7 + 7*size);                // bad in every stamp, so has no good data
+        badPixels.push_back((2 + i) + (3 + 2*i)*size);
+        badPixels.push_back(6 + (4 + i%2)*size);        // bad in some stamps
+        fluxes.push_back(5.0*(i + 1));
+        PTR(MaskedImageT) stamp = makeStamp(fluxes.back(), 0.01*(i - 2), badPixels);
+        for (int y = 0; y != size; ++y) {
+            for (int x = 0; x != size; ++x) {
+                (*stamp->getImage())(x, y) += 0.05*std::sin(1.3*x + 0.7*y + i);
+                (*stamp->getVariance())(x, y) = 0.5 + 0.1*((x*7 + y*3 + i*5)%11);
+            }
+        }
+        if (i == 1) {
+            (*stamp->getVariance())(6, 4) = 0.0;        // never used, even though it isn't masked
+        }
+        (*stamp->getMask())(4, 4) |= (i == 3) ? bad : 0;
+        stamps.push_back(stamp);
+        copies.push_back(boost::make_shared<MaskedImageT>(*stamp, true));
+    }
+}
+
+void checkSame(std::vector<PTR(MaskedImageT)> const & stamps, std::vector<PTR(MaskedImageT)> const & copies,
+               double tol) {
+    for (std::size_t i = 0; i != stamps.size(); ++i) {
+        for (int y = 0; y != size; ++y) {
+            for (int x = 0; x != size; ++x) {
+                BOOST_CHECK_SMALL((*stamps[i]->getImage())(x, y) - (*copies[i]->getImage())(x, y), tol);
+            }
+        }
+    }
+}
+
+} // anonymous namespace
+
+// PsfImagePca::updateBadPixels uses the same estimators as afw's ImagePca::updateBadPixels
+BOOST_AUTO_TEST_CASE(UpdateBadPixelsMatchesAfw) {
+    typedef lsst::afw::image::ImagePca<MaskedImageT> AfwImagePca;
+    lsst::meas::algorithms::PsfImagePca<MaskedImageT> imagePca(true, 0), afwImagePca(true, 0);
+    std::vector<PTR(MaskedImageT)> stamps, copies;
+    std::vector<double> fluxes;
+    makeStamps(stamps, copies, fluxes);
+    for (std::size_t i = 0; i != stamps.size(); ++i) {
+        imagePca.addImage(stamps[i], fluxes[i]);
+        afwImagePca.addImage(copies[i], fluxes[i]);
+    }
+    unsigned long const mask = MaskedImageT::Mask::getPlaneBitMask("BAD");
+
+    double const delta = imagePca.updateBadPixels(mask, 0);
+    BOOST_CHECK_CLOSE(delta, afwImagePca.AfwImagePca::updateBadPixels(mask, 0), 1e-4);
+    checkSame(stamps, copies, 1e-4);
+    for (std::size_t i = 0; i != stamps.size(); ++i) {
+        BOOST_CHECK_EQUAL((*stamps[i]->getImage())(7, 7), 0.0);
+    }
+
+    for (int ncomp = 1; ncomp <= 3; ++ncomp) {
+        imagePca.analyze();
+        afwImagePca.analyze();
+        double const delta = imagePca.updateBadPixels(mask, ncomp);
+        BOOST_CHECK_SMALL(delta - afwImagePca.AfwImagePca::updateBadPixels(mask, ncomp), 1e-3);
+        checkSame(stamps, copies, 1e-4);
+    }
+
+    int const nEigen = imagePca.getEigenImages().size();
+    BOOST_CHECK_THROW(imagePca.updateBadPixels(mask, nEigen + 1), lsst::pex::exceptions::LengthError);
+    BOOST_CHECK_THROW(afwImagePca.AfwImagePca::updateBadPixels(mask, nEigen + 1),
+                      lsst::pex::exceptions::LengthError);
+}
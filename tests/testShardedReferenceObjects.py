@@ -0,0 +1,228 @@
+#!/usr/bin/env python
+from __future__ import absolute_import, division, print_function
+
+#
+# LSST Data Management System
+# Copyright 2008-2016 AURA/LSST.
+#
+# This product includes software developed by the
+# LSST Project (http://www.lsst.org/).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the LSST License Statement and
+# the GNU General Public License along with this program.  If not,
+# see <https://www.lsstcorp.org/LegalNotices/>.
+#
+import os
+import shutil
+import tempfile
+import unittest
+
+import numpy
+
+import lsst.afw.coord as afwCoord
+import lsst.daf.base as dafBase
+import lsst.afw.geom as afwGeom
+import lsst.afw.table as afwTable
+import lsst.utils.tests as utilsTests
+from lsst.meas.algorithms import (HtmIndexer, IngestShardedReferenceCatalogTask,
+                                  LoadShardedReferenceObjectsTask, LoadReferenceObjectsTask,
+                                  ReferenceObjectCache)
+
+class ShardedReferenceObjectsTestCase(unittest.TestCase):
+    """Test ingesting and loading a sharded reference catalog"""
+
+    def setUp(self):
+        numpy.random.seed(12345)
+        self.tempDir = tempfile.mkdtemp()
+        self.ctrCoord = afwCoord.IcrsCoord(10.0*afwGeom.degrees, -5.0*afwGeom.degrees)
+
+        schema = LoadReferenceObjectsTask.makeMinimalSchema(["r", "g"], addFluxSigma=True,
+                                                            addIsPhotometric=True)
+        self.inputFiles = []
+        self.refCat = afwTable.SimpleCatalog(schema)
+        idNum = 0
+        for i, numObj in enumerate((1500, 500)):
+            cat = afwTable.SimpleCatalog(schema)
+            for j in range(numObj):
+                rec = cat.addNew()
+                idNum += 1
+                rec.setId(idNum)
+                rec.setCoord(afwCoord.IcrsCoord(
+                    (10.0 + numpy.random.uniform(-2.0, 2.0))*afwGeom.degrees,
+                    (-5.0 + numpy.random.uniform(-2.0, 2.0))*afwGeom.degrees,
+                ))
+                rec.set("r_flux", numpy.random.uniform(1.0, 100.0))
+                rec.set("g_flux", numpy.random.uniform(1.0, 100.0))
+                rec.set("r_fluxSigma", 0.1)
+                rec.set("photometric", bool(j % 2))
+            fileName = os.path.join(self.tempDir, "input%d.fits" % (i,))
+            cat.writeFits(fileName)
+            self.inputFiles.append(fileName)
+            self.refCat.extend(cat)
+
+        self.catalogDir = os.path.join(self.tempDir, "sharded")
+        config = IngestShardedReferenceCatalogTask.ConfigClass()
+        config.description.shardDepth = 7
+        config.description.indexDepth = 10
+        ingestTask = IngestShardedReferenceCatalogTask(config=config)
+        res = ingestTask.run(inputFiles=self.inputFiles, outputDir=self.catalogDir)
+        self.assertEqual(res.numObjects, len(self.refCat))
+        self.assertGreater(res.numShards, 1)
+
+    def tearDown(self):
+        shutil.rmtree(self.tempDir, True)
+        ReferenceObjectCache.getInstance().setMaxBytes(0)
+
+    def makeLoader(self, tileCacheMB=0.0):
+        config = LoadShardedReferenceObjectsTask.ConfigClass()
+        config.catalogDir = self.catalogDir
+        config.tileCacheMB = tileCacheMB
+        config.defaultFilter = "r"
+        config.filterMap = {"camr": "r"}
+        return LoadShardedReferenceObjectsTask(config=config)
+
+    def testLoadSkyCircle(self):
+        """Objects loaded in a circle are exactly those within the radius"""
+        for tileCacheMB in (0.0, 10.0):
+            self.checkLoadSkyCircle(self.makeLoader(tileCacheMB))
+
+    def checkLoadSkyCircle(self, loader):
+        for radiusDeg in (0.05, 0.3, 1.0):
+            radius = radiusDeg*afwGeom.degrees
+            res = loader.loadSkyCircle(self.ctrCoord, radius, "camr")
+            self.assertEqual(res.fluxField, "camr_camFlux")
+            expected = dict((rec.getId(), rec) for rec in self.refCat
+                            if self.ctrCoord.angularSeparation(rec.getCoord()) <= radius)
+            self.assertEqual(sorted(rec.getId() for rec in res.refCat), sorted(expected))
+            self.assertTrue(res.refCat.isContiguous())
+            for rec in res.refCat:
+                inRec = expected[rec.getId()]
+                self.assertAlmostEqual(rec.getCoord().getRa().asRadians(),
+                                       inRec.getCoord().getRa().asRadians())
+                self.assertEqual(rec.get("r_flux"), inRec.get("r_flux"))
+                self.assertEqual(rec.get(res.fluxField), inRec.get("r_flux"))
+                self.assertEqual(rec.get("photometric"), inRec.get("photometric"))
+                self.assertFalse(rec.get("hasCentroid"))
+
+    def testTileCache(self):
+        """Repeated and overlapping queries are served from the tile cache"""
+        ReferenceObjectCache.getInstance().clear()
+        loader = self.makeLoader(tileCacheMB=10.0)
+        res1 = loader.loadSkyCircle(self.ctrCoord, 0.5*afwGeom.degrees, "r")
+        misses = loader.metadata.get("tileCacheMisses")
+        self.assertGreater(misses, 0)
+        self.assertEqual(loader.metadata.get("tileCacheHits"), 0)
+
+        # a second loader in the same process shares the cache, and fluxes are aliased per query
+        loader2 = self.makeLoader(tileCacheMB=10.0)
+        res2 = loader2.loadSkyCircle(self.ctrCoord, 0.5*afwGeom.degrees, "camr")
+        self.assertEqual(loader2.metadata.get("tileCacheHits"), misses)
+        self.assertEqual(loader2.metadata.get("tileCacheMisses"), 0)
+        self.assertEqual(res2.fluxField, "camr_camFlux")
+        self.assertEqual([rec.getId() for rec in res1.refCat], [rec.getId() for rec in res2.refCat])
+        self.assertGreater(loader2.metadata.get("tileCacheBytes"), 0)
+
+        # a loader asking for a tiny budget doesn't shrink the shared cache
+        loader3 = self.makeLoader(tileCacheMB=1e-6)
+        loader3.loadSkyCircle(self.ctrCoord, 0.5*afwGeom.degrees)
+        self.assertEqual(loader3.metadata.get("tileCacheMisses"), 0)
+
+        # but the application may, which evicts everything
+        ReferenceObjectCache.getInstance().setMaxBytes(1)
+        self.assertEqual(len(ReferenceObjectCache.getInstance()), 0)
+
+    def testEmptyRegion(self):
+        """A circle far from all objects returns an empty catalog"""
+        loader = self.makeLoader()
+        farCoord = afwCoord.IcrsCoord(200.0*afwGeom.degrees, 45.0*afwGeom.degrees)
+        res = loader.loadSkyCircle(farCoord, 0.5*afwGeom.degrees)
+        self.assertEqual(len(res.refCat), 0)
+        self.assertEqual(res.fluxField, "camFlux")
+
+    def testLoadObjectsById(self):
+        """Objects are found by ID; unknown IDs are ignored"""
+        loader = self.makeLoader()
+        res = loader.loadObjectsById([5, 1999, 5, 42, 100000], "camr")
+        self.assertEqual(res.fluxField, "camr_camFlux")
+        self.assertEqual(sorted(rec.getId() for rec in res.refCat), [5, 42, 1999])
+        self.assertTrue(res.refCat.isContiguous())
+        for rec in res.refCat:
+            self.assertEqual(rec.get("r_flux"), self.refCat[rec.getId() - 1].get("r_flux"))
+
+    def testJoinMatchListWithCatalog(self):
+        """Packed matches are relinked to sources and reference objects, with or without the ID index"""
+        sourceSchema = afwTable.SourceTable.makeMinimalSchema()
+        sourceCat = afwTable.SourceCatalog(sourceSchema)
+        matches = afwTable.ReferenceMatchVector()
+        for i, refObj in enumerate(self.refCat[::97]):
+            src = sourceCat.addNew()
+            src.setId(1000 - i)
+            matches.append(afwTable.ReferenceMatch(refObj, src, 0.01*i))
+        sourceIds = [src.getId() for src in sourceCat]
+
+        matchCat = afwTable.packMatches(matches)
+        matchmeta = dafBase.PropertyList()
+        matchmeta.add("SMATCHV", 1)
+        matchmeta.add("FILTER", "r")
+        matchmeta.add("RA", self.ctrCoord.getRa().asDegrees())
+        matchmeta.add("DEC", self.ctrCoord.getDec().asDegrees())
+        matchmeta.add("RADIUS", 3.0)
+        matchCat.table.setMetadata(matchmeta)
+
+        for removeIdIndex in (False, True):
+            loader = self.makeLoader()
+            if removeIdIndex:
+                for fileName in loader.catalog.IdIndexFileNames:
+                    os.remove(os.path.join(self.catalogDir, fileName))
+                self.assertIsNone(loader.loadObjectsById([1]))
+            joined = loader.joinMatchListWithCatalog(matchCat, sourceCat)
+            self.assertEqual(len(joined), len(matches))
+            for match, joinedMatch in zip(matches, joined):
+                self.assertEqual(joinedMatch.first.getId(), match.first.getId())
+                self.assertEqual(joinedMatch.first.get("r_flux"), match.first.get("r_flux"))
+                self.assertEqual(joinedMatch.second.getId(), match.second.getId())
+                self.assertAlmostEqual(joinedMatch.distance, match.distance)
+            self.assertEqual([src.getId() for src in sourceCat], sourceIds)
+
+    def testHtmIndexer(self):
+        """Every point inside a circle lies in one of the circle's intersecting trixels"""
+        indexer = HtmIndexer(8)
+        ra = numpy.random.uniform(0, 2*numpy.pi, 10000)
+        dec = numpy.arcsin(numpy.random.uniform(-1, 1, 10000))
+        ids = indexer.indexPoints(ra, dec)
+        self.assertTrue(numpy.all(ids >= 8*4**8))
+        self.assertTrue(numpy.all(ids < 16*4**8))
+        for ctrRa, ctrDec, radius in ((0.1, 0.2, 0.05), (3.0, -1.5, 0.2), (5.0, 1.0, 0.5)):
+            ranges = indexer.getIntersectingRanges(ctrRa, ctrDec, radius)
+            coord = afwCoord.IcrsCoord(ctrRa*afwGeom.radians, ctrDec*afwGeom.radians)
+            for r, d, htmId in zip(ra, dec, ids):
+                sep = coord.angularSeparation(afwCoord.IcrsCoord(r*afwGeom.radians, d*afwGeom.radians))
+                if sep.asRadians() <= radius:
+                    self.assertTrue(any(begin <= htmId < end for begin, end in ranges))
+
+def suite():
+    """Returns a suite containing all the test cases in this module."""
+    utilsTests.init()
+
+    suites = []
+    suites += unittest.makeSuite(ShardedReferenceObjectsTestCase)
+    suites += unittest.makeSuite(utilsTests.MemoryTestCase)
+
+    return unittest.TestSuite(suites)
+
+def run(exit=False):
+    """Run the tests"""
+    utilsTests.run(suite(), exit)
+
+if __name__ == "__main__":
+    run(True)
@@ -0,0 +1,139 @@
+#!/usr/bin/env python
+#
+# LSST Data Management System
+# Copyright 2008-2016 AURA/LSST.
+#
+# This product includes software developed by the
+# LSST Project (http://www.lsst.org/).
+#
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU General Public License as published by
+# the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU General Public License for more details.
+#
+# You should have received a copy of the LSST License Statement and
+# the GNU General Public License along with this program.  If not,
+# see <https://www.lsstcorp.org/LegalNotices/>.
+#
+"""
+Tests for TabulatedPsf
+
+Run with:
+   python testTabulatedPsf.py
+or
+   python
+   >>> import testTabulatedPsf; testTabulatedPsf.run()
+"""
+import os
+import unittest
+
+import numpy
+
+import lsst.utils.tests as utilsTests
+import lsst.pex.exceptions as pexExceptions
+import lsst.afw.geom as afwGeom
+import lsst.afw.image as afwImage
+import lsst.afw.math as afwMath
+import lsst.meas.algorithms as measAlg
+
+class TabulatedPsfTestCase(unittest.TestCase):
+
+    def setUp(self):
+        # A PcaPsf whose kernel images vary linearly across the image, and so can be interpolated exactly
+        ksize = 21
+        basisKernelList = afwMath.KernelList()
+        for sigma in (1.5, 3.0):
+            basisKernel = afwMath.AnalyticKernel(ksize, ksize, afwMath.GaussianFunction2D(sigma, sigma))
+            basisImage = afwImage.ImageD(basisKernel.getDimensions())
+            basisKernel.computeImage(basisImage, True)
+            basisImage /= numpy.sum(basisImage.getArray())
+            if sigma == 1.5:
+                basisImage0 = basisImage
+            else:
+                basisImage -= basisImage0
+            basisKernelList.append(afwMath.FixedKernel(basisImage))
+        kernel = afwMath.LinearCombinationKernel(basisKernelList, afwMath.PolynomialFunction2D(1))
+        kernel.setSpatialParameters([[1.0, 0.0, 0.0],
+                                     [0.0, 0.5*1e-2, 0.2e-2]])
+        self.psf = measAlg.PcaPsf(kernel, afwGeom.Point2D(60.0, 40.0))
+        self.bbox = afwGeom.Box2I(afwGeom.Point2I(-10, 20), afwGeom.Extent2I(150, 120))
+        self.tabulated = measAlg.TabulatedPsf(self.psf, self.bbox, afwGeom.Extent2I(4, 3))
+
+    def tearDown(self):
+        del self.psf
+        del self.tabulated
+
+    def assertImagesClose(self, image1, image2, tol):
+        self.assertEqual(image1.getBBox(afwImage.PARENT), image2.getBBox(afwImage.PARENT))
+        array1, array2 = image1.getArray(), image2.getArray()
+        self.assertLess(numpy.abs(array1 - array2).max(), tol*numpy.abs(array1).max())
+
+    def testNodes(self):
+        self.assertEqual(self.tabulated.getBBox(), self.bbox)
+        self.assertEqual(self.tabulated.getGridDimensions(), afwGeom.Extent2I(4, 3))
+        self.assertEqual(self.tabulated.getAveragePosition(), self.psf.getAveragePosition())
+        for iy in range(3):
+            for ix in range(4):
+                position = self.tabulated.getNodePosition(ix, iy)
+                self.assertAlmostEqual(position.getX(), -10.5 + (ix + 0.5)*150/4.0)
+                self.assertAlmostEqual(position.getY(), 19.5 + (iy + 0.5)*120/3.0)
+                self.assertImagesClose(self.tabulated.getNodeImage(ix, iy),
+                                       self.psf.computeKernelImage(position), 1e-12)
+        self.assertRaises(pexExceptions.OutOfRangeError, self.tabulated.getNodeImage, 4, 0)
+
+    def testInterpolation(self):
+        """Test that a linearly-varying PSF is reproduced exactly between the nodes"""
+        for x, y in ((20.0, 50.0), (55.3, 91.7), (112.0, 108.5)):
+            position = afwGeom.Point2D(x, y)
+            self.assertImagesClose(self.tabulated.computeKernelImage(position),
+                                   self.psf.computeKernelImage(position), 1e-10)
+            self.assertImagesClose(self.tabulated.computeImage(position),
+                                   self.psf.computeImage(position), 1e-6)
+        # beyond the outermost nodes we use the nearest one
+        self.assertImagesClose(self.tabulated.computeKernelImage(afwGeom.Point2D(-50.0, 200.0)),
+                               self.tabulated.getNodeImage(0, 2), 1e-12)
+
+    def testPersistence(self):
+        filename = "TabulatedPsf.fits"
+        self.tabulated.writeFits(filename)
+        try:
+            psf = measAlg.TabulatedPsf.readFits(filename)
+        finally:
+            os.remove(filename)
+        self.assertEqual(psf.getBBox(), self.bbox)
+        self.assertEqual(psf.getGridDimensions(), self.tabulated.getGridDimensions())
+        self.assertEqual(psf.getAveragePosition(), self.tabulated.getAveragePosition())
+        # the images are persisted in single precision
+        for x, y in ((0.0, 20.0), (55.3, 91.7)):
+            position = afwGeom.Point2D(x, y)
+            self.assertImagesClose(psf.computeKernelImage(position),
+                                   self.tabulated.computeKernelImage(position), 1e-6)
+
+    def testErrors(self):
+        self.assertRaises(pexExceptions.InvalidParameterError, measAlg.TabulatedPsf,
+                          self.psf, self.bbox, afwGeom.Extent2I(0, 3))
+        self.assertRaises(pexExceptions.InvalidParameterError, measAlg.TabulatedPsf,
+                          self.psf, afwGeom.Box2I(), afwGeom.Extent2I(2, 2))
+
+#-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+
+def suite():
+    """Returns a suite containing all the test cases in this module."""
+    utilsTests.init()
+
+    suites = []
+    suites += unittest.makeSuite(TabulatedPsfTestCase)
+    suites += unittest.makeSuite(utilsTests.MemoryTestCase)
+    return unittest.TestSuite(suites)
+
+def run(exit = False):
+    """Run the utilsTests"""
+    utilsTests.run(suite(), exit)
+
+if __name__ == "__main__":
+    run(True)
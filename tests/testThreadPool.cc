@@ -0,0 +1,129 @@
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE ThreadPool
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wunused-variable"
+#include "boost/test/unit_test.hpp"
+#pragma clang diagnostic pop
+
+#include <cmath>
+#include <vector>
+
+#include "lsst/pex/exceptions.h"
+#include "lsst/meas/algorithms/ThreadPool.h"
+
+namespace {
+
+using lsst::meas::algorithms::ParallelTask;
+
+// Sum of sqrt(i) over each chunk, stored per chunk so that the total does not depend on scheduling
+class ChunkSums : public ParallelTask {
+public:
+    ChunkSums(int n, int grainSize) : grainSize(grainSize), sums((n + grainSize - 1)/grainSize, 0.0),
+                                      visits(n, 0) {}
+
+    virtual void operator()(int begin, int end) {
+        double sum = 0.0;
+        for (int i = begin; i < end; ++i) {
+            sum += std::sqrt(static_cast<double>(i));
+            ++visits[i];
+        }
+        sums[begin/grainSize] = sum;
+    }
+
+    double total() const {
+        double sum = 0.0;
+        for (std::size_t i = 0; i < sums.size(); ++i) {
+            sum += sums[i];
+        }
+        return sum;
+    }
+
+    int grainSize;
+    std::vector<double> sums;
+    std::vector<int> visits;
+};
+
+// Runs a nested parallelFor in each chunk
+class Nested : public ParallelTask {
+public:
+    explicit Nested(int n) : results(n, 0.0), nested(n, 0) {}
+
+    virtual void operator()(int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            nested[i] = lsst::meas::algorithms::isInParallelRegion();
+            ChunkSums inner(100, 7);
+            lsst::meas::algorithms::parallelFor(100, inner, 7);
+            results[i] = inner.total();
+        }
+    }
+
+    std::vector<double> results;
+    std::vector<int> nested;            // not vector<bool>, whose elements share words between threads
+};
+
+class Thrower : public ParallelTask {
+public:
+    virtual void operator()(int begin, int end) {
+        if (begin <= 50 && 50 < end) {
+            throw LSST_EXCEPT(lsst::pex::exceptions::RangeError, "bad chunk");
+        }
+    }
+};
+
+class NumThreadsGuard {
+public:
+    NumThreadsGuard() : _numThreads(lsst::meas::algorithms::getNumThreads()) {}
+    ~NumThreadsGuard() { lsst::meas::algorithms::setNumThreads(_numThreads); }
+private:
+    int _numThreads;
+};
+
+} // anonymous namespace
+
+BOOST_AUTO_TEST_CASE(ParallelForCoversRange) {
+    using namespace lsst::meas::algorithms;
+    NumThreadsGuard guard;
+    setNumThreads(1);
+    ChunkSums serial(10007, 64);
+    parallelFor(10007, serial, 64);
+    for (int numThreads = 2; numThreads <= 8; numThreads *= 2) {
+        setNumThreads(numThreads);
+        BOOST_CHECK_EQUAL(getNumThreads(), numThreads);
+        ChunkSums parallel(10007, 64);
+        parallelFor(10007, parallel, 64);
+        for (std::size_t i = 0; i < parallel.visits.size(); ++i) {
+            BOOST_CHECK_EQUAL(parallel.visits[i], 1);
+        }
+        // bit-identical to serial execution
+        BOOST_CHECK_EQUAL(parallel.total(), serial.total());
+    }
+    BOOST_CHECK(!isInParallelRegion());
+}
+
+BOOST_AUTO_TEST_CASE(NestedParallelFor) {
+    using namespace lsst::meas::algorithms;
+    NumThreadsGuard guard;
+    setNumThreads(4);
+    Nested nested(20);
+    parallelFor(20, nested, 1);
+    ChunkSums expected(100, 7);
+    setNumThreads(1);
+    parallelFor(100, expected, 7);
+    for (int i = 0; i < 20; ++i) {
+        BOOST_CHECK(nested.nested[i]);
+        BOOST_CHECK_EQUAL(nested.results[i], expected.total());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(ParallelForExceptions) {
+    using namespace lsst::meas::algorithms;
+    NumThreadsGuard guard;
+    Thrower thrower;
+    setNumThreads(1);
+    BOOST_CHECK_THROW(parallelFor(100, thrower, 10), lsst::pex::exceptions::RangeError);
+    setNumThreads(4);
+    BOOST_CHECK_THROW(parallelFor(100, thrower, 10), lsst::pex::exceptions::RuntimeError);
+    BOOST_CHECK(!isInParallelRegion());
+    BOOST_CHECK_THROW(parallelFor(100, thrower, 0), lsst::pex::exceptions::InvalidParameterError);
+    BOOST_CHECK_THROW(setNumThreads(-1), lsst::pex::exceptions::InvalidParameterError);
+}
@@ -5,6 +5,7 @@
 #include <boost/random.hpp>
 #include <boost/make_shared.hpp>
 
+#include "lsst/meas/algorithms/SingleGaussianPsf.h"
 #include "lsst/meas/algorithms/WarpedPsf.h"
 
 using namespace std;
@@ -294,3 +295,49 @@ BOOST_AUTO_TEST_CASE(warpedPsf)
     BOOST_CHECK(compare(*im,*im2) < 0.005);
 }
 
+
+
+//
+// Forwards to another Psf, hiding that it is spatially constant
+//
+struct ForwardingPsf : public ImagePsf
+{
+    PTR(Psf const) _psf;
+
+    explicit ForwardingPsf(PTR(Psf const) psf) : _psf(psf) { }
+
+    virtual ~ForwardingPsf() { }
+
+    virtual PTR(Psf) clone() const
+    {
+        return boost::make_shared<ForwardingPsf>(_psf);
+    }
+
+    virtual PTR(Image) doComputeKernelImage(Point2D const &ccdXY, Color const &color) const {
+        return _psf->computeKernelImage(ccdXY, color);
+    }
+};
+
+
+BOOST_AUTO_TEST_CASE(warpedConstantPsf)
+{
+    PTR(XYTransform) distortion = ToyXYTransform::makeRandom();
+
+    PTR(Psf) unwarped_psf = boost::make_shared<SingleGaussianPsf>(31, 31, 2.5);
+    WarpedPsf warped_psf(unwarped_psf, distortion);
+    WarpedPsf forwarded_psf(boost::make_shared<ForwardingPsf>(unwarped_psf), distortion);
+
+    BOOST_CHECK(warped_psf.isUndistortedPsfConstant());
+    BOOST_CHECK(!forwarded_psf.isUndistortedPsfConstant());
+    BOOST_CHECK(!WarpedPsf(ToyPsf::makeRandom(), distortion).isUndistortedPsfConstant());
+
+    // the remembered image must give the same results as computing it every time
+    for (int i = 0; i < 5; i++) {
+        Point2D p = randpt();
+        PTR(Image<double>) im = warped_psf.computeKernelImage(p);
+        PTR(Image<double>) im2 = forwarded_psf.computeKernelImage(p);
+
+        BOOST_CHECK_EQUAL(im->getBBox(), im2->getBBox());
+        BOOST_CHECK(compare(*im,*im2) < 1.0e-10);
+    }
+}